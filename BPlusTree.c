@@ -0,0 +1,458 @@
+/*****************************************************
+ * @file   BPlusTree.c                                *
+ *                                                   *
+ * @brief Implementation for BPlusTree.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+#define BPTREE_MAX_HEIGHT 16		/* Internal nodes are split in halves, so 11 levels hold every int */
+
+
+/**
+ * @brief Counts the keys of a node below key. The padding past the last key is never below it
+ * @return returns the count, the slot of key in a leaf
+*/
+static inline int bpCountBelow(const int *keys, int key)
+{
+#ifdef __SSE2__
+	__m128i k = _mm_set1_epi32(key);
+	int mask = 0;
+	for(int i=0; i < BPTREE_KEYS; i += 4)
+	{
+		__m128i below = _mm_cmplt_epi32(_mm_load_si128((const __m128i*)&keys[i]), k);
+		mask |= _mm_movemask_ps(_mm_castsi128_ps(below)) << i;
+	}
+	return __builtin_popcount(mask);
+#else
+	int count = 0;
+	for(int i=0; i < BPTREE_KEYS; i++) count += keys[i] < key;
+	return count;
+#endif
+}
+
+
+/**
+ * @brief Picks the child of an internal node that holds key
+ * @return returns the index of the child
+*/
+static inline int bpChild(const bpNode_t *node, int key)
+{
+	if(key == INT_MAX) return node->n <= BPTREE_KEYS ? node->n : BPTREE_KEYS;
+	return bpCountBelow(node->keys, key + 1);
+}
+
+
+/**
+ * @brief Waits until the writer isn't changing the node behind a version
+ * @return returns the version to validate the reads against
+*/
+static inline uint32_t bpReadBegin(const uint32_t *version)
+{
+	uint32_t v;
+	while((v = __atomic_load_n(version, __ATOMIC_ACQUIRE)) & 1);
+	return v;
+}
+
+
+/**
+ * @brief Checks that the writer didn't change the node since bpReadBegin() returned v
+ * @return returns 1 if the reads in between are consistent, 0 otherwise
+*/
+static inline int bpReadCheck(const uint32_t *version, uint32_t v)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(version, __ATOMIC_RELAXED) == v;
+}
+
+
+/**
+ * @brief Marks a node as being changed, before any of its fields is written
+ * @return returns void
+*/
+static inline void bpWriteBegin(uint32_t *version)
+{
+	__atomic_store_n(version, *version + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Publishes the changes made to a node since bpWriteBegin()
+ * @return returns void
+*/
+static inline void bpWriteEnd(uint32_t *version)
+{
+	__atomic_store_n(version, *version + 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Makes an empty node
+ * @return returns the node, NULL on malloc failure
+*/
+static bpNode_t *bpNewNode(int leaf)
+{
+	bpNode_t *node = (bpNode_t*)aligned_alloc(BPTREE_CACHE_LINE, sizeof(bpNode_t));
+	if(node == NULL) return NULL;
+	memset(node, 0, sizeof(bpNode_t));
+	for(int i=0; i < BPTREE_KEYS; i++) node->keys[i] = INT_MAX;
+	node->leaf = leaf;
+	return node;
+}
+
+
+/**
+ * @brief Makes an empty tree
+ * @return returns the tree, NULL on malloc failure
+*/
+bpTree_t *makeBpTree(void)
+{
+	bpTree_t *tree = (bpTree_t*)malloc(sizeof(bpTree_t));
+	if(tree == NULL) return NULL;
+	tree->root = bpNewNode(1);
+	if(tree->root == NULL || pthread_mutex_init(&tree->lock, NULL) != 0)
+	{
+		free(tree->root);
+		free(tree);
+		return NULL;
+	}
+	tree->version = 0;
+	return tree;
+}
+
+
+/**
+ * @brief Walks down to the leaf that holds key, validating each node against its parent
+ * @return returns the leaf, and its version in leafVersion
+*/
+static bpNode_t *bpTreeLeaf(bpTree_t *tree, int key, uint32_t *leafVersion)
+{
+restart:;
+	uint32_t v = bpReadBegin(&tree->version);
+	bpNode_t *node = __atomic_load_n(&tree->root, __ATOMIC_ACQUIRE);
+	uint32_t nodeVersion = bpReadBegin(&node->version);
+	if(!bpReadCheck(&tree->version, v)) goto restart;
+	while(!node->leaf)
+	{
+		// Nodes are never freed and unused slots are NULL, so a child read mid-change is safe to look at
+		bpNode_t *child = node->children[bpChild(node, key)];
+		if(child == NULL) goto restart;
+		uint32_t childVersion = bpReadBegin(&child->version);
+		if(!bpReadCheck(&node->version, nodeVersion)) goto restart;
+		node = child;
+		nodeVersion = childVersion;
+	}
+	*leafVersion = nodeVersion;
+	return node;
+}
+
+
+/**
+ * @brief Looks movieID up
+ * @return returns the movie info, NULL if it isn't indexed
+*/
+movieInfo_t *bpTreeFind(bpTree_t *tree, int movieID)
+{
+	for(;;)
+	{
+		uint32_t v;
+		bpNode_t *leaf = bpTreeLeaf(tree, movieID, &v);
+		int pos = bpCountBelow(leaf->keys, movieID);
+		movieInfo_t *Info = NULL;
+		if(pos < leaf->n && leaf->keys[pos] == movieID) Info = leaf->infos[pos];
+		if(bpReadCheck(&leaf->version, v)) return Info;
+	}
+}
+
+
+/**
+ * @brief Puts a key in a leaf with room for it, at its slot pos
+ * @return returns void
+*/
+static void bpLeafPut(bpNode_t *leaf, int pos, int key, movieInfo_t *Info)
+{
+	for(int i=leaf->n; i > pos; i--)
+	{
+		leaf->keys[i] = leaf->keys[i - 1];
+		leaf->infos[i] = leaf->infos[i - 1];
+	}
+	leaf->keys[pos] = key;
+	leaf->infos[pos] = Info;
+	leaf->n++;
+}
+
+
+/**
+ * @brief Puts a separator and the child to its right in an internal node with room for them, right of children[c]
+ * @return returns void
+*/
+static void bpInnerPut(bpNode_t *node, int c, int key, bpNode_t *right)
+{
+	for(int i=node->n; i > c; i--)
+	{
+		node->keys[i] = node->keys[i - 1];
+		node->children[i + 1] = node->children[i];
+	}
+	node->keys[c] = key;
+	node->children[c + 1] = right;
+	node->n++;
+}
+
+
+/**
+ * @brief Splits a full leaf around the new key into leaf and right. An append to the last leaf keeps the leaf
+ * full, so that ascending inserts fill the leaves
+ * @return returns the first key of right, the separator of the two
+*/
+static int bpLeafSplit(bpNode_t *leaf, int pos, int key, movieInfo_t *Info, bpNode_t *right)
+{
+	int keys[BPTREE_KEYS + 1];
+	movieInfo_t *infos[BPTREE_KEYS + 1];
+	for(int i=0, j=0; i <= BPTREE_KEYS; i++)
+	{
+		if(i == pos)
+		{
+			keys[i] = key;
+			infos[i] = Info;
+		}
+		else
+		{
+			keys[i] = leaf->keys[j];
+			infos[i] = leaf->infos[j++];
+		}
+	}
+	int left = (pos == BPTREE_KEYS && leaf->next == NULL) ? BPTREE_KEYS : (BPTREE_KEYS + 2) / 2;
+
+	// right isn't reachable yet, only the leaf needs its version odd
+	right->n = BPTREE_KEYS + 1 - left;
+	for(int i=0; i < right->n; i++)
+	{
+		right->keys[i] = keys[left + i];
+		right->infos[i] = infos[left + i];
+	}
+	right->next = leaf->next;
+	for(int i=0; i < BPTREE_KEYS; i++)
+	{
+		leaf->keys[i] = i < left ? keys[i] : INT_MAX;
+		leaf->infos[i] = i < left ? infos[i] : NULL;
+	}
+	leaf->n = left;
+	leaf->next = right;
+	return right->keys[0];
+}
+
+
+/**
+ * @brief Splits a full internal node in halves around the new separator, which goes right of children[c]
+ * @return returns the middle separator, which moves up to the parent
+*/
+static int bpInnerSplit(bpNode_t *node, int c, int key, bpNode_t *child, bpNode_t *right)
+{
+	int keys[BPTREE_KEYS + 1];
+	bpNode_t *children[BPTREE_KEYS + 2];
+	children[0] = node->children[0];
+	for(int i=0, j=0; i <= BPTREE_KEYS; i++)
+	{
+		if(i == c)
+		{
+			keys[i] = key;
+			children[i + 1] = child;
+		}
+		else
+		{
+			keys[i] = node->keys[j];
+			children[i + 1] = node->children[++j];
+		}
+	}
+	int left = BPTREE_KEYS / 2;
+
+	right->n = BPTREE_KEYS - left;
+	for(int i=0; i < right->n; i++) right->keys[i] = keys[left + 1 + i];
+	for(int i=0; i <= right->n; i++) right->children[i] = children[left + 1 + i];
+	for(int i=0; i < BPTREE_KEYS; i++) node->keys[i] = i < left ? keys[i] : INT_MAX;
+	for(int i=0; i <= BPTREE_KEYS; i++) node->children[i] = i <= left ? children[i] : NULL;
+	node->n = left;
+	return keys[left];
+}
+
+
+/**
+ * @brief Inserts the movie with the given info. Safe to call concurrently with other inserts and searches
+ * @return returns 1 on success, 0 on malloc failure or if movieID is already indexed
+*/
+int bpTreeInsert(bpTree_t *tree, movieInfo_t *Info)
+{
+	int key = Info->movieID;
+	bpNode_t *path[BPTREE_MAX_HEIGHT];
+	int slots[BPTREE_MAX_HEIGHT];
+	int depth = 0;
+
+	pthread_mutex_lock(&tree->lock);
+	bpNode_t *leaf = tree->root;
+	while(!leaf->leaf)
+	{
+		path[depth] = leaf;
+		slots[depth] = bpChild(leaf, key);
+		leaf = leaf->children[slots[depth++]];
+	}
+	int pos = bpCountBelow(leaf->keys, key);
+	if(pos < leaf->n && leaf->keys[pos] == key)
+	{
+		pthread_mutex_unlock(&tree->lock);
+		return 0;
+	}
+
+	// Most inserts only change the leaf
+	if(leaf->n < BPTREE_KEYS)
+	{
+		bpWriteBegin(&leaf->version);
+		bpLeafPut(leaf, pos, key, Info);
+		bpWriteEnd(&leaf->version);
+		pthread_mutex_unlock(&tree->lock);
+		return 1;
+	}
+
+	// path[top..depth-1] are full and split too, path[top-1] takes a separator. With top 0 the tree grows a root.
+	// Every node is allocated before any is changed, so a malloc failure leaves the tree as it was
+	int top = depth;
+	while(top > 0 && path[top - 1]->n == BPTREE_KEYS) top--;
+	bpNode_t *fresh[BPTREE_MAX_HEIGHT + 2];
+	int n_fresh = depth - top + 1 + (top == 0);
+	for(int i=0; i < n_fresh; i++)
+	{
+		fresh[i] = bpNewNode(i == 0);
+		if(fresh[i] == NULL)
+		{
+			while(i > 0) free(fresh[--i]);
+			pthread_mutex_unlock(&tree->lock);
+			return 0;
+		}
+	}
+
+	// Mark top down, so that a reader that validated a parent before it was marked finds its child marked
+	int first = top > 0 ? top - 1 : 0;
+	if(top == 0) bpWriteBegin(&tree->version);
+	for(int i=first; i < depth; i++) bpWriteBegin(&path[i]->version);
+	bpWriteBegin(&leaf->version);
+
+	bpNode_t *right = fresh[0];
+	int separator = bpLeafSplit(leaf, pos, key, Info, right);
+	int used = 1;
+	for(int i=depth - 1; i >= 0 && right != NULL; i--)
+	{
+		if(path[i]->n < BPTREE_KEYS)
+		{
+			bpInnerPut(path[i], slots[i], separator, right);
+			right = NULL;
+		}
+		else
+		{
+			bpNode_t *split = fresh[used++];
+			split->leaf = 0;
+			separator = bpInnerSplit(path[i], slots[i], separator, right, split);
+			right = split;
+		}
+	}
+	if(right != NULL)
+	{
+		bpNode_t *root = fresh[used];
+		root->leaf = 0;
+		root->n = 1;
+		root->keys[0] = separator;
+		root->children[0] = tree->root;
+		root->children[1] = right;
+		__atomic_store_n(&tree->root, root, __ATOMIC_RELEASE);
+	}
+
+	bpWriteEnd(&leaf->version);
+	for(int i=depth - 1; i >= first; i--) bpWriteEnd(&path[i]->version);
+	if(top == 0) bpWriteEnd(&tree->version);
+	pthread_mutex_unlock(&tree->lock);
+	return 1;
+}
+
+
+/**
+ * @brief Positions the iterator on the first movie whose movieID is at least movieID
+ * @return returns void
+*/
+void bpTreeSeek(bpTree_t *tree, bpIter_t *iter, int movieID)
+{
+	// Splits only move keys to leaves further right, which the walk reaches through the links
+	uint32_t v;
+	iter->leaf = bpTreeLeaf(tree, movieID, &v);
+	iter->n = 0;
+	iter->pos = 0;
+	iter->from = movieID;
+}
+
+
+/**
+ * @brief Returns the movie under the iterator and moves it to the next one in ascending movieID
+ * @return returns the movie info, NULL past the last movie
+*/
+movieInfo_t *bpIterNext(bpIter_t *iter)
+{
+	while(iter->pos == iter->n)
+	{
+		if(iter->leaf == NULL) return NULL;
+
+		// Copy the leaf whole, so that the walk doesn't read it again while an insert changes it
+		bpNode_t *leaf = iter->leaf;
+		bpNode_t *next;
+		int n;
+		for(;;)
+		{
+			uint32_t v = bpReadBegin(&leaf->version);
+			n = leaf->n;
+			if(n > BPTREE_KEYS) n = BPTREE_KEYS;
+			memcpy(iter->keys, leaf->keys, sizeof(iter->keys));
+			memcpy(iter->infos, leaf->infos, sizeof(iter->infos));
+			next = leaf->next;
+			if(bpReadCheck(&leaf->version, v)) break;
+		}
+		iter->leaf = next;
+		iter->n = n;
+		iter->pos = 0;
+		while(iter->pos < n && iter->keys[iter->pos] < iter->from) iter->pos++;
+	}
+	iter->from = (int64_t)iter->keys[iter->pos] + 1;
+	return iter->infos[iter->pos++];
+}
+
+
+/**
+ * @brief Frees a subtree and the movie info of its leaves
+ * @return returns void
+*/
+static void bpFreeNode(bpNode_t *node)
+{
+	if(node->leaf)
+	{
+		for(int i=0; i < node->n; i++) freeMovieInfo(node->infos[i]);
+	}
+	else
+	{
+		for(int i=0; i <= node->n; i++) bpFreeNode(node->children[i]);
+	}
+	free(node);
+}
+
+
+/**
+ * @brief Frees the tree and the movie info of every leaf slot. Only valid once no other thread uses the tree
+ * @return returns void
+*/
+void deleteBpTree(bpTree_t *tree)
+{
+	if(tree == NULL) return;
+	bpFreeNode(tree->root);
+	pthread_mutex_destroy(&tree->lock);
+	free(tree);
+}
@@ -0,0 +1,125 @@
+/*****************************************************
+ * @file   BPlusTree.h                                *
+ *                                                   *
+ * @brief Cache-line B+ tree category index          *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef BPLUSTREE_FILE
+#define BPLUSTREE_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+
+
+/*
+ * With CATEGORY_BPTREE defined every category is indexed by a B+ tree keyed by movieID
+ * instead of the sentinel BST. A node keeps its sixteen keys in its first cache line, padded
+ * with INT_MAX past the last one, so that finding the child or the slot of a key is one
+ * compare of all sixteen keys (four SSE2 compares when built for it) and a population count,
+ * and a lookup touches about one line per level. The records hang off the leaves, which are
+ * linked left to right, so print, filter and range walks read the leaves in order.
+ *
+ * Movies are never removed from a category, so the tree only grows. Inserts are serialized
+ * by the lock of the tree. Readers never take it: every node has a version the writer makes
+ * odd before it changes the node and even again afterwards. A reader notes the version of a
+ * node, reads it and checks the version again before it trusts what it read, and starts over
+ * from the root if it changed. Nodes are never freed while the tree is in use, so a reader
+ * that loses the race only ever reads a stale node. A split marks every node it changes,
+ * from the top down, before it changes any of them.
+ */
+
+#define BPTREE_KEYS 16				/* Keys per node, one cache line of them */
+#define BPTREE_CACHE_LINE 64
+
+struct movie_info;
+
+
+/**
+ * Structure defining a node of the tree. Leaves hold records, internal nodes children
+*/
+typedef struct bp_node
+{
+	int keys[BPTREE_KEYS];			/* Ascending, INT_MAX past the last key */
+	uint32_t version;				/* Odd while the writer changes the node */
+	int n;							/* Number of keys */
+	int leaf;						/* Set for the leaves */
+	struct bp_node *next;			/* The leaf to the right, NULL for the last leaf and the internal nodes */
+	union
+	{
+		struct bp_node *children[BPTREE_KEYS + 1];	/* children[i] holds the keys below keys[i], children[n] the rest */
+		struct movie_info *infos[BPTREE_KEYS];		/* infos[i] is the record of keys[i] */
+	};
+}__attribute__((aligned(BPTREE_CACHE_LINE))) bpNode_t;
+
+
+/**
+ * Structure defining a tree
+*/
+typedef struct bp_tree
+{
+	bpNode_t *root;					/* A leaf while the tree holds at most BPTREE_KEYS movies */
+	uint32_t version;				/* Odd while the writer replaces the root */
+	pthread_mutex_t lock;			/* Serializes the inserts */
+}bpTree_t;
+
+
+/**
+ * Structure defining an in-order walk over the leaves
+*/
+typedef struct bp_iter
+{
+	bpNode_t *leaf;					/* The leaf to copy next, NULL once the last one was copied */
+	int keys[BPTREE_KEYS];			/* The keys of the copied leaf */
+	struct movie_info *infos[BPTREE_KEYS];
+	int n;
+	int pos;						/* The slot of the copy to return next */
+	int64_t from;					/* Keys below it were returned already or are before the walk */
+}bpIter_t;
+
+
+/**
+ * @brief Makes an empty tree
+ * @return returns the tree, NULL on malloc failure
+*/
+bpTree_t *makeBpTree(void);
+
+
+/**
+ * @brief Inserts the movie with the given info. Safe to call concurrently with other inserts and searches
+ * @return returns 1 on success, 0 on malloc failure or if movieID is already indexed
+*/
+int bpTreeInsert(bpTree_t *tree, struct movie_info *Info);
+
+
+/**
+ * @brief Looks movieID up
+ * @return returns the movie info, NULL if it isn't indexed
+*/
+struct movie_info *bpTreeFind(bpTree_t *tree, int movieID);
+
+
+/**
+ * @brief Positions the iterator on the first movie whose movieID is at least movieID
+ * @return returns void
+*/
+void bpTreeSeek(bpTree_t *tree, bpIter_t *iter, int movieID);
+
+
+/**
+ * @brief Returns the movie under the iterator and moves it to the next one in ascending movieID
+ * @return returns the movie info, NULL past the last movie
+*/
+struct movie_info *bpIterNext(bpIter_t *iter);
+
+
+/**
+ * @brief Frees the tree and the movie info of every leaf slot. Only valid once no other thread uses the tree
+ * @return returns void
+*/
+void deleteBpTree(bpTree_t *tree);
+
+
+#endif
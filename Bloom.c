@@ -0,0 +1,122 @@
+/*****************************************************
+ * @file   Bloom.c                                    *
+ *                                                   *
+ * @brief Implementation for Bloom.h 				 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Mixes a key into 64 well spread bits (the splitmix64 finalizer)
+ * @return returns the hash
+*/
+static uint64_t bloomHash(int key)
+{
+	uint64_t h = (uint64_t)(uint32_t)key + 0x9e3779b97f4a7c15ull;
+	h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ull;
+	h = (h ^ (h >> 27)) * 0x94d049bb133111ebull;
+	return h ^ (h >> 31);
+}
+
+
+/**
+ * @brief Finds the block of a hash. The high half picks the block, the low bits the counters in it
+ * @return returns the block
+*/
+static bloomBlock_t *bloomBlock(const bloom_t *bloom, uint64_t h)
+{
+	return (bloomBlock_t*)&bloom->blocks[((h >> 32) * bloom->n_blocks) >> 32];
+}
+
+
+/**
+ * @brief Makes an empty filter sized for capacity keys
+ * @return returns the filter, NULL on malloc failure
+*/
+bloom_t *makeBloom(int capacity)
+{
+	if(capacity < 1) capacity = 1;
+	uint64_t n_blocks = ((uint64_t)capacity * BLOOM_COUNTERS_PER_KEY + BLOOM_BLOCK_COUNTERS - 1) / BLOOM_BLOCK_COUNTERS;
+	size_t size = sizeof(bloom_t) + n_blocks * sizeof(bloomBlock_t);
+	bloom_t *bloom = (bloom_t*)aligned_alloc(EPOCH_CACHE_LINE, size);
+	if(bloom == NULL) return NULL;
+	memset(bloom, 0, size);
+	bloom->n_blocks = (uint32_t)n_blocks;
+	bloom->capacity = capacity;
+	bloom->count = 0;
+	return bloom;
+}
+
+
+/**
+ * @brief Adds a key. A key may be added more than once, and must then be removed as many times
+ * @return returns void
+*/
+void bloomAdd(bloom_t *bloom, int key)
+{
+	uint64_t h = bloomHash(key);
+	bloomBlock_t *block = bloomBlock(bloom, h);
+	for(int i=0; i < BLOOM_PROBES; i++, h >>= 6)
+	{
+		uint8_t *counter = &block->counters[h % BLOOM_BLOCK_COUNTERS];
+		uint8_t value = __atomic_load_n(counter, __ATOMIC_RELAXED);
+		while(value != UINT8_MAX && !__atomic_compare_exchange_n(counter, &value, value + 1, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+	__atomic_add_fetch(&bloom->count, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Removes a key that was added
+ * @return returns void
+*/
+void bloomRemove(bloom_t *bloom, int key)
+{
+	uint64_t h = bloomHash(key);
+	bloomBlock_t *block = bloomBlock(bloom, h);
+	for(int i=0; i < BLOOM_PROBES; i++, h >>= 6)
+	{
+		// A saturated counter no longer knows how many keys it counts, so it stays set
+		uint8_t *counter = &block->counters[h % BLOOM_BLOCK_COUNTERS];
+		uint8_t value = __atomic_load_n(counter, __ATOMIC_RELAXED);
+		while(value != UINT8_MAX && value != 0 && !__atomic_compare_exchange_n(counter, &value, value - 1, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+	}
+	__atomic_sub_fetch(&bloom->count, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Checks whether a key may have been added
+ * @return returns 0 if the key was certainly not added, 1 if it may have been
+*/
+int bloomMayContain(const bloom_t *bloom, int key)
+{
+	uint64_t h = bloomHash(key);
+	const bloomBlock_t *block = bloomBlock(bloom, h);
+	for(int i=0; i < BLOOM_PROBES; i++, h >>= 6)
+	{
+		if(__atomic_load_n(&block->counters[h % BLOOM_BLOCK_COUNTERS], __ATOMIC_ACQUIRE) == 0) return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Checks whether the keys outnumber the capacity the filter was sized for
+ * @return returns 1 if True, 0 if False
+*/
+int bloomFull(const bloom_t *bloom)
+{
+	return __atomic_load_n(&bloom->count, __ATOMIC_RELAXED) > bloom->capacity;
+}
+
+
+/**
+ * @brief Frees a filter
+ * @return returns void
+*/
+void deleteBloom(bloom_t *bloom)
+{
+	free(bloom);
+}
@@ -0,0 +1,100 @@
+/*****************************************************
+ * @file   Bloom.h                                    *
+ *                                                   *
+ * @brief Blocked counting bloom filters             *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef BLOOM_FILE
+#define BLOOM_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Epoch.h"
+
+
+/*
+ * A bloom filter answers "certainly absent" or "maybe present" for an integer key. Lookups
+ * that are certainly absent skip the hash chain or the tree walk they would otherwise need.
+ *
+ * The filter is blocked: a key hashes to one cache line and sets BLOOM_PROBES counters inside
+ * it, so a lookup reads a single line. Counters are 8 bits wide so that keys can be removed
+ * again (U). A counter that reaches 255 sticks there, since it can no longer tell how many
+ * keys share it. Adds and removes are atomic and may run concurrently with each other and
+ * with lookups. A key must be added before it becomes reachable and removed after it stops
+ * being reachable, so that the filter never denies a key a reader could find.
+ *
+ * A filter does not grow: it is sized for a capacity, and its owner builds a bigger one once
+ * the keys outnumber it.
+ */
+
+#define BLOOM_BLOCK_COUNTERS EPOCH_CACHE_LINE	/* Counters per block, one byte each */
+#define BLOOM_PROBES 3							/* Counters a key sets in its block */
+#define BLOOM_COUNTERS_PER_KEY 16				/* About 1% false positives at capacity */
+
+
+/**
+ * Structure defining a block of counters in its own cache line
+*/
+typedef struct bloom_block
+{
+	uint8_t counters[BLOOM_BLOCK_COUNTERS];
+}__attribute__((aligned(EPOCH_CACHE_LINE))) bloomBlock_t;
+
+
+/**
+ * Structure defining a filter
+*/
+typedef struct bloom
+{
+	uint32_t n_blocks;			/* Number of blocks */
+	int capacity;				/* The number of keys the filter is sized for */
+	int count;					/* Keys added minus keys removed */
+	bloomBlock_t blocks[];
+}bloom_t;
+
+
+/**
+ * @brief Makes an empty filter sized for capacity keys
+ * @return returns the filter, NULL on malloc failure
+*/
+bloom_t *makeBloom(int capacity);
+
+
+/**
+ * @brief Adds a key. A key may be added more than once, and must then be removed as many times
+ * @return returns void
+*/
+void bloomAdd(bloom_t *bloom, int key);
+
+
+/**
+ * @brief Removes a key that was added
+ * @return returns void
+*/
+void bloomRemove(bloom_t *bloom, int key);
+
+
+/**
+ * @brief Checks whether a key may have been added
+ * @return returns 0 if the key was certainly not added, 1 if it may have been
+*/
+int bloomMayContain(const bloom_t *bloom, int key);
+
+
+/**
+ * @brief Checks whether the keys outnumber the capacity the filter was sized for
+ * @return returns 1 if True, 0 if False
+*/
+int bloomFull(const bloom_t *bloom);
+
+
+/**
+ * @brief Frees a filter
+ * @return returns void
+*/
+void deleteBloom(bloom_t *bloom);
+
+
+#endif
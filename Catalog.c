@@ -0,0 +1,171 @@
+/*****************************************************
+ * @file   Catalog.c                                  *
+ *                                                   *
+ * @brief Creation and selection of the catalogs     *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+_Thread_local catalog_t *catalog = NULL;	/* The catalog the calling thread works on */
+
+
+/**
+ * @brief Makes a catalog the one the calling thread works on
+ * @return returns the thread's previous catalog
+*/
+catalog_t *catalogUse(catalog_t *instance)
+{
+	catalog_t *previous = catalog;
+	catalog = instance;
+	return previous;
+}
+
+
+/**
+ * @brief Unwinds a catalogCreate() that failed midway: frees whatever was made and gives the calling thread its previous catalog back
+ * @return returns NULL
+*/
+static catalog_t *catalogCreateFailed(catalog_t *instance, catalog_t *previous)
+{
+	catalogDestroy(instance);
+	catalogUse(previous);
+	return NULL;
+}
+
+
+/**
+ * @brief Creates an empty catalog, or one restored from the snapshot at loadPath. The new catalog becomes the calling thread's catalog.
+ * On failure the calling thread keeps its previous catalog
+ * @return returns the catalog, NULL on failure
+*/
+catalog_t *catalogCreate(const char *loadPath)
+{
+	catalog_t *instance = (catalog_t*)calloc(1, sizeof(catalog_t));
+	if(instance == NULL)
+	{
+		fprintf(stderr, "\n Could not allocate the catalog structures\n");
+		return NULL;
+	}
+	instance->a = 3;
+	instance->b = 7;
+	instance->m = 101;
+	instance->p = 1000003;
+	pthread_mutex_init(&instance->queryCache.lock, NULL);
+	epochInit(&instance->epoch);
+	catalog_t *previous = catalogUse(instance);
+
+	// The snapshot is mapped first, it decides the size of the users hashtable
+	instance->hashtable_size = instance->m;
+	if(loadPath != NULL)
+	{
+		if(!snapshotOpen(&instance->snapshot, loadPath))
+		{
+			fprintf(stderr, "\n Could not load snapshot: %s\n", loadPath);
+			return catalogCreateFailed(instance, previous);
+		}
+		instance->hashtable_size = instance->snapshot.header->hashtable_size;
+	}
+
+	// The users hashtable, the new releases tree and the categories array
+	if(!makeHashTable() || !initMovieCategoryArray())
+	{
+		fprintf(stderr, "\n Could not allocate the catalog structures\n");
+		return catalogCreateFailed(instance, previous);
+	}
+	initHashTable();
+	initNewMoviesTree();
+	if(loadPath != NULL && !snapshotRestore(&instance->snapshot))
+	{
+		fprintf(stderr, "\n Could not restore snapshot: %s\n", loadPath);
+		return catalogCreateFailed(instance, previous);
+	}
+#ifdef CATALOG_VERSIONS
+	if(!versionsInit(&instance->versions, &instance->epoch))
+	{
+		fprintf(stderr, "\n Could not allocate the first catalog version\n");
+		return catalogCreateFailed(instance, previous);
+	}
+#endif
+	return instance;
+}
+
+
+/**
+ * @brief Frees a catalog and everything in it, also one that failed to initialize. No other thread may use it
+ * @return returns void
+*/
+void catalogDestroy(catalog_t *instance)
+{
+	if(instance == NULL) return;
+	catalog_t *previous = catalogUse(instance);
+
+	// Reclaim everything retired by the writers
+	epochBarrier(&instance->epoch);
+	queryCacheClear(&instance->queryCache);
+	pthread_mutex_destroy(&instance->queryCache.lock);
+
+	deleteNewMoviesTree();
+	deleteHashTable();
+#ifdef CATALOG_VERSIONS
+	deleteVersions(&instance->versions);
+#endif
+	deleteMovieCategoryArray();
+	epochDestroy(&instance->epoch);
+
+	// The records restored from the snapshot and the pooled users live in these mappings
+	snapshotClose(&instance->snapshot);
+	poolRegionUnmap(&instance->userPools.region);
+	free(instance);
+
+	catalogUse(previous == instance ? NULL : previous);
+}
+
+
+/**
+ * @brief Sets the maximum number of registrations and preallocates the users and their histories for them
+ * @return returns 1 on success, 0 if the users could not be preallocated
+*/
+int catalogSetMaxUsers(catalog_t *instance, int maxUsers)
+{
+	catalogUse(instance);
+	instance->max_users = maxUsers;
+	return reserveUsers(maxUsers);
+}
+
+
+/**
+ * @brief Sets the maximum account ID, which the users hashtable indexes directly if it is small enough
+ * @return returns void
+*/
+void catalogSetMaxID(catalog_t *instance, int maxID)
+{
+	catalogUse(instance);
+	instance->max_id = maxID;
+	userTableDirect(&instance->userTable, maxID);
+}
+
+
+/**
+ * @brief Returns the LSN of the first event after the snapshot the catalog was restored from
+ * @return returns the LSN, 0 without a snapshot
+*/
+uint64_t catalogSnapshotLsn(catalog_t *instance)
+{
+	return instance->snapshot.header != NULL ? instance->snapshot.header->lsn : 0;
+}
+
+
+/**
+ * @brief Publishes the changes to the category trees since the last version, if built with CATALOG_VERSIONS
+ * @return returns void
+*/
+void catalogPublish(catalog_t *instance)
+{
+#ifdef CATALOG_VERSIONS
+	catalogUse(instance);
+	versionPublish(&instance->versions);
+#else
+	(void)instance;
+#endif
+}
@@ -0,0 +1,122 @@
+/*****************************************************
+ * @file   Checkpoint.c                               *
+ *                                                   *
+ * @brief Implementation for Checkpoint.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+
+static volatile sig_atomic_t checkpointExited = 0;	/* Set by SIGCHLD, so that polling costs nothing until a child exits */
+
+
+/**
+ * @brief SIGCHLD handler
+ * @return returns void
+*/
+static void checkpointSignal(int signo)
+{
+	(void)signo;
+	checkpointExited = 1;
+}
+
+
+/**
+ * @brief Milliseconds elapsed between two times
+ * @return returns the milliseconds
+*/
+static double checkpointElapsed(const struct timespec *from, const struct timespec *to)
+{
+	return (to->tv_sec - from->tv_sec) * 1e3 + (to->tv_nsec - from->tv_nsec) / 1e6;
+}
+
+
+/**
+ * @brief Forks a child that writes a snapshot of the current state to path, unless a checkpoint is still running
+ * @return returns 1 if the checkpoint started, 0 if one is still running or fork failed
+*/
+int checkpointBegin(checkpoint_t *checkpoint, const char *path, uint64_t lsn)
+{
+	if(checkpoint->pid != 0)
+	{
+		checkpoint->skipped++;
+		return 0;
+	}
+
+	// Interrupted reads resume, the handler only raises the flag
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = checkpointSignal;
+	action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGCHLD, &action, NULL);
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	checkpoint->minflt = usage.ru_minflt;
+
+	// Whatever stdout holds would be printed twice otherwise
+	fflush(stdout);
+	fflush(stderr);
+	struct timespec forked;
+	clock_gettime(CLOCK_MONOTONIC, &checkpoint->started);
+	checkpointExited = 0;
+	pid_t pid = fork();
+	clock_gettime(CLOCK_MONOTONIC, &forked);
+
+	if(pid == 0)
+	{
+		// Only this thread lives on in the child. Writing a snapshot takes no lock that another thread may have held
+		_exit(snapshotWrite(path, lsn) ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+	if(pid < 0)
+	{
+		checkpoint->failed++;
+		return 0;
+	}
+
+	checkpoint->pid = pid;
+	checkpoint->path = path;
+	checkpoint->lsn = lsn;
+	checkpoint->stall_ms = checkpointElapsed(&checkpoint->started, &forked);
+	return 1;
+}
+
+
+/**
+ * @brief Reaps the running checkpoint if its child has exited, waiting for it when wait is set, and reports it on stderr
+ * @return returns 1 if a checkpoint finished, 0 otherwise
+*/
+int checkpointPoll(checkpoint_t *checkpoint, int wait)
+{
+	if(checkpoint->pid == 0 || (!wait && !checkpointExited)) return 0;
+
+	// Lower the flag first, so that an exit right after the wait below raises it again
+	checkpointExited = 0;
+	int status;
+	struct rusage child;
+	pid_t pid;
+	do pid = wait4(checkpoint->pid, &status, wait ? 0 : WNOHANG, &child);
+	while(pid < 0 && errno == EINTR);
+	if(pid == 0) return 0; // Some other child exited
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+
+	int ok = pid == checkpoint->pid && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+	if(ok) checkpoint->taken++;
+	else checkpoint->failed++;
+	fprintf(stderr, "Checkpoint %s at event %llu %s in %.3f ms: %ld pages copied by the parent, %ld faulted in by the child, parent stalled %.3f ms\n",
+		checkpoint->path, (unsigned long long)checkpoint->lsn, ok ? "written" : "FAILED", checkpointElapsed(&checkpoint->started, &now),
+		usage.ru_minflt - checkpoint->minflt, pid > 0 ? child.ru_minflt : 0L, checkpoint->stall_ms);
+	checkpoint->pid = 0;
+	return 1;
+}
@@ -0,0 +1,60 @@
+/*****************************************************
+ * @file   Checkpoint.h                               *
+ *                                                   *
+ * @brief Background checkpoints in a forked child   *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef CHECKPOINT_FILE
+#define CHECKPOINT_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+
+/*
+ * A checkpoint is a snapshot (see Snapshot.h) written by a forked child. fork() gives the
+ * child a copy-on-write image of the whole state as it was at a consistent point, right after
+ * a D event, and the child serializes that image while the parent keeps handling events.
+ * The parent only stalls for the fork itself, and afterwards pays one page copy for every
+ * page it writes to while the child still shares it.
+ *
+ * Only one checkpoint runs at a time. A finished child is reaped by checkpointPoll(), which
+ * reports how long it took, the page faults of both processes and the stall of the parent.
+ */
+
+
+/**
+ * Structure defining the state of the background checkpoints
+*/
+typedef struct checkpoint
+{
+	pid_t pid;					/* The child writing the running checkpoint, 0 if none */
+	const char *path;			/* Where the checkpoints are written */
+	uint64_t lsn;				/* LSN of the next logged event when the running checkpoint forked */
+	struct timespec started;	/* When the running checkpoint forked */
+	double stall_ms;			/* How long the parent spent in fork() */
+	long minflt;				/* Minor faults of the parent before the fork */
+	int taken;					/* Checkpoints written */
+	int skipped;				/* D events that found a checkpoint still running */
+	int failed;					/* Checkpoints that could not be written */
+}checkpoint_t;
+
+
+/**
+ * @brief Forks a child that writes a snapshot of the current state to path, unless a checkpoint is still running
+ * @return returns 1 if the checkpoint started, 0 if one is still running or fork failed
+*/
+int checkpointBegin(checkpoint_t *checkpoint, const char *path, uint64_t lsn);
+
+
+/**
+ * @brief Reaps the running checkpoint if its child has exited, waiting for it when wait is set, and reports it on stderr
+ * @return returns 1 if a checkpoint finished, 0 otherwise
+*/
+int checkpointPoll(checkpoint_t *checkpoint, int wait);
+
+
+#endif
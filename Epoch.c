@@ -0,0 +1,234 @@
+/*****************************************************
+ * @file   Epoch.c                                    *
+ *                                                   *
+ * @brief Implementation for Epoch.h 				 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include <sched.h>
+#include <assert.h>
+
+#include "Epoch.h"
+
+
+static int epochThreadCount = 0;				/* Highest thread index handed out so far, plus one */
+static _Thread_local int epochThreadIndex = -1;	/* The index of the calling thread in every domain */
+static char epochThreadUsed[EPOCH_MAX_THREADS];	/* Set for the indices held by live threads */
+static pthread_mutex_t epochThreadLock = PTHREAD_MUTEX_INITIALIZER;	/* Guards epochThreadUsed */
+static pthread_key_t epochThreadKey;			/* Gives the index of a thread back when it exits */
+static pthread_once_t epochThreadOnce = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief Thread exit destructor of epochThreadKey, makes the index of the exiting thread free for the next thread
+ * @return returns void
+*/
+static void epochThreadRelease(void *value)
+{
+	int index = (int)(intptr_t)value - 1;
+
+	// Its reader records are all outside a read section by now, so the next thread finds them as a new thread would
+	pthread_mutex_lock(&epochThreadLock);
+	epochThreadUsed[index] = 0;
+	pthread_mutex_unlock(&epochThreadLock);
+	epochThreadIndex = -1;
+}
+
+
+/**
+ * @brief Creates epochThreadKey, once per process
+ * @return returns void
+*/
+static void epochThreadKeyCreate(void)
+{
+	pthread_key_create(&epochThreadKey, epochThreadRelease);
+}
+
+
+/**
+ * @brief Returns the reader record of the calling thread, assigning it the lowest free thread index on first use
+ * @return returns the reader record
+*/
+static epochReader_t *epochSelf(epochDomain_t *domain)
+{
+	if(epochThreadIndex < 0)
+	{
+		pthread_once(&epochThreadOnce, epochThreadKeyCreate);
+		pthread_mutex_lock(&epochThreadLock);
+		int index = 0;
+		while(index < EPOCH_MAX_THREADS && epochThreadUsed[index]) index++;
+		if(index == EPOCH_MAX_THREADS)
+		{
+			fprintf(stderr, "More than %d threads are in epoch domains at once\n", EPOCH_MAX_THREADS);
+			abort();
+		}
+		epochThreadUsed[index] = 1;
+		if(index >= epochThreadCount) __atomic_store_n(&epochThreadCount, index + 1, __ATOMIC_RELEASE);
+		pthread_mutex_unlock(&epochThreadLock);
+		pthread_setspecific(epochThreadKey, (void*)(intptr_t)(index + 1));
+		epochThreadIndex = index;
+	}
+	return &domain->readers[epochThreadIndex];
+}
+
+
+/**
+ * @brief Calls the reclaim function of every object of a detached limbo list
+ * @return returns void
+*/
+static void epochReclaimList(epochRetired_t *retired)
+{
+	while(retired != NULL)
+	{
+		epochRetired_t *next = retired->next;
+		retired->reclaim(retired->object);
+		free(retired);
+		retired = next;
+	}
+}
+
+
+/**
+ * @brief Initializes an epoch domain with no readers and empty limbo lists
+ * @return returns void
+*/
+void epochInit(epochDomain_t *domain)
+{
+	for(int i=0; i < EPOCH_MAX_THREADS; i++)
+	{
+		domain->readers[i].epoch = 0;
+		domain->readers[i].depth = 0;
+	}
+	domain->global = 1;
+	for(int i=0; i<3; i++) domain->limbo[i] = NULL;
+	domain->pending = 0;
+	pthread_mutex_init(&domain->lock, NULL);
+}
+
+
+/**
+ * @brief Enters a read section. Read sections may nest
+ * @return returns void
+*/
+void epochEnter(epochDomain_t *domain)
+{
+	epochReader_t *self = epochSelf(domain);
+	if(self->depth++ > 0) return;
+
+	// Announce the epoch we are reading in before touching any shared node
+	uint64_t epoch = __atomic_load_n(&domain->global, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&self->epoch, (epoch << 1) | 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+/**
+ * @brief Leaves a read section
+ * @return returns void
+*/
+void epochExit(epochDomain_t *domain)
+{
+	epochReader_t *self = epochSelf(domain);
+	if(--self->depth > 0) return;
+	__atomic_store_n(&self->epoch, 0, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Hands an already unlinked object to the domain. reclaim(object) is called once no reader can still hold it.
+ * Must not be called inside a read section
+ * @return returns void
+*/
+void epochRetire(epochDomain_t *domain, void *object, void (*reclaim)(void *))
+{
+	epochRetired_t *retired = (epochRetired_t*)malloc(sizeof(epochRetired_t));
+	if(retired == NULL)
+	{
+		// Out of memory: wait for a full grace period and reclaim the object directly. A read section
+		// of our own would hold the epoch back forever, which is why writers retire outside of them
+		assert(epochSelf(domain)->depth == 0);
+		epochBarrier(domain);
+		uint64_t epoch = __atomic_load_n(&domain->global, __ATOMIC_ACQUIRE);
+		while(__atomic_load_n(&domain->global, __ATOMIC_ACQUIRE) < epoch + 2)
+		{
+			if(!epochTryAdvance(domain)) sched_yield();
+		}
+		reclaim(object);
+		return;
+	}
+	retired->object = object;
+	retired->reclaim = reclaim;
+
+	pthread_mutex_lock(&domain->lock);
+	int index = domain->global % 3;
+	retired->next = domain->limbo[index];
+	domain->limbo[index] = retired;
+	domain->pending++;
+	pthread_mutex_unlock(&domain->lock);
+
+	epochTryAdvance(domain);
+}
+
+
+/**
+ * @brief Advances the global epoch if every active reader has observed it and reclaims the expired limbo list
+ * @return returns 1 if the epoch advanced, 0 otherwise
+*/
+int epochTryAdvance(epochDomain_t *domain)
+{
+	pthread_mutex_lock(&domain->lock);
+	uint64_t epoch = domain->global;
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	// Every reader inside a read section must have observed the current epoch
+	int n_threads = __atomic_load_n(&epochThreadCount, __ATOMIC_ACQUIRE);
+	if(n_threads > EPOCH_MAX_THREADS) n_threads = EPOCH_MAX_THREADS;
+	for(int i=0; i < n_threads; i++)
+	{
+		uint64_t observed = __atomic_load_n(&domain->readers[i].epoch, __ATOMIC_ACQUIRE);
+		if((observed & 1) && (observed >> 1) != epoch)
+		{
+			pthread_mutex_unlock(&domain->lock);
+			return 0;
+		}
+	}
+
+	// The list we are about to reuse holds objects retired two epochs ago. Nobody can reach them anymore
+	int index = (epoch + 1) % 3;
+	epochRetired_t *expired = domain->limbo[index];
+	domain->limbo[index] = NULL;
+	for(epochRetired_t *retired = expired; retired != NULL; retired = retired->next) domain->pending--;
+	__atomic_store_n(&domain->global, epoch + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&domain->lock);
+
+	epochReclaimList(expired);
+	return 1;
+}
+
+
+/**
+ * @brief Waits until every object retired so far has been reclaimed. Must not be called inside a read section
+ * @return returns void
+*/
+void epochBarrier(epochDomain_t *domain)
+{
+	while(__atomic_load_n(&domain->pending, __ATOMIC_ACQUIRE) > 0)
+	{
+		if(!epochTryAdvance(domain)) sched_yield();
+	}
+}
+
+
+/**
+ * @brief Reclaims everything still pending. Only valid once no other thread uses the domain
+ * @return returns void
+*/
+void epochDestroy(epochDomain_t *domain)
+{
+	for(int i=0; i<3; i++)
+	{
+		epochReclaimList(domain->limbo[i]);
+		domain->limbo[i] = NULL;
+	}
+	domain->pending = 0;
+	pthread_mutex_destroy(&domain->lock);
+}
@@ -0,0 +1,123 @@
+/*****************************************************
+ * @file   Epoch.h                                    *
+ *                                                   *
+ * @brief Epoch based memory reclamation             *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef EPOCH_FILE
+#define EPOCH_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+/*
+ * Readers (I, F, Q, M, P) announce themselves with epochEnter()/epochExit() and traverse
+ * the trees and user chains without taking any lock. Writers unlink nodes first and then
+ * hand them to epochRetire() instead of free(). A retired node is reclaimed only after the
+ * global epoch has advanced twice, which can only happen once every active reader has
+ * observed the epoch in which the node was unlinked.
+ *
+ * Writers are still expected to be serialized among themselves; the domain only protects
+ * readers from writers.
+ */
+
+#define EPOCH_MAX_THREADS 64	/* Maximum number of live threads that may enter a domain. Exited threads give their index back */
+#define EPOCH_CACHE_LINE 64
+
+
+/* Publish a fully initialized node into a shared link so concurrent readers never see it half built */
+#define EPOCH_PUBLISH(link, node) __atomic_store_n(&(link), (node), __ATOMIC_RELEASE)
+
+/* Read a shared link published with EPOCH_PUBLISH */
+#define EPOCH_READ(link) __atomic_load_n(&(link), __ATOMIC_ACQUIRE)
+
+
+/**
+ * Structure defining a retired object waiting for reclamation
+*/
+typedef struct epoch_retired
+{
+	void *object;					/* The unlinked object */
+	void (*reclaim)(void *);		/* The function that frees the object */
+	struct epoch_retired *next;		/* Pointer to the next retired object of the same epoch */
+}epochRetired_t;
+
+
+/**
+ * Structure defining the per thread reader record. Each one lives in its own cache line
+*/
+typedef struct epoch_reader
+{
+	uint64_t epoch;		/* (observed epoch << 1) | 1 while inside a read section, 0 otherwise */
+	int depth;			/* Nesting depth of epochEnter() calls of the owning thread */
+	char pad[EPOCH_CACHE_LINE - sizeof(uint64_t) - sizeof(int)];
+}__attribute__((aligned(EPOCH_CACHE_LINE))) epochReader_t;
+
+
+/**
+ * Structure defining an epoch domain
+*/
+typedef struct epoch_domain
+{
+	epochReader_t readers[EPOCH_MAX_THREADS];	/* The reader records indexed by thread index */
+	uint64_t global;							/* The global epoch */
+	epochRetired_t *limbo[3];					/* Retired objects of the last three epochs */
+	int pending;								/* Number of objects waiting in the limbo lists */
+	pthread_mutex_t lock;						/* Serializes retire and advance */
+}epochDomain_t;
+
+
+/**
+ * @brief Initializes an epoch domain with no readers and empty limbo lists
+ * @return returns void
+*/
+void epochInit(epochDomain_t *domain);
+
+
+/**
+ * @brief Enters a read section. Read sections may nest
+ * @return returns void
+*/
+void epochEnter(epochDomain_t *domain);
+
+
+/**
+ * @brief Leaves a read section
+ * @return returns void
+*/
+void epochExit(epochDomain_t *domain);
+
+
+/**
+ * @brief Hands an already unlinked object to the domain. reclaim(object) is called once no reader can still hold it.
+ * Must not be called inside a read section
+ * @return returns void
+*/
+void epochRetire(epochDomain_t *domain, void *object, void (*reclaim)(void *));
+
+
+/**
+ * @brief Advances the global epoch if every active reader has observed it and reclaims the expired limbo list
+ * @return returns 1 if the epoch advanced, 0 otherwise
+*/
+int epochTryAdvance(epochDomain_t *domain);
+
+
+/**
+ * @brief Waits until every object retired so far has been reclaimed. Must not be called inside a read section
+ * @return returns void
+*/
+void epochBarrier(epochDomain_t *domain);
+
+
+/**
+ * @brief Reclaims everything still pending. Only valid once no other thread uses the domain
+ * @return returns void
+*/
+void epochDestroy(epochDomain_t *domain);
+
+
+#endif
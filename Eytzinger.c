@@ -0,0 +1,85 @@
+/*****************************************************
+ * @file   Eytzinger.c                                *
+ *                                                   *
+ * @brief Implementation for Eytzinger.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Lays out n records sorted by ascending movieID
+ * @return returns the layout, NULL on malloc failure
+*/
+eytzinger_t *makeEytzinger(movieInfo_t **sorted, int n)
+{
+	eytzinger_t *layout = (eytzinger_t*)malloc(sizeof(eytzinger_t));
+	if(layout == NULL) return NULL;
+	size_t bytes = ((size_t)n + 1) * sizeof(int);
+	layout->keys = (int*)aligned_alloc(EYTZINGER_CACHE_LINE, (bytes + EYTZINGER_CACHE_LINE - 1) / EYTZINGER_CACHE_LINE * EYTZINGER_CACHE_LINE);
+	layout->infos = (movieInfo_t**)malloc(((size_t)n + 1) * sizeof(movieInfo_t*));
+	if(layout->keys == NULL || layout->infos == NULL)
+	{
+		deleteEytzinger(layout);
+		return NULL;
+	}
+	layout->n = n;
+	layout->keys[0] = 0;
+	layout->infos[0] = NULL;
+
+	// Visit the implicit tree in order, starting from its leftmost node, and hand each node the next record
+	size_t k = 1;
+	while(2 * k <= (size_t)n) k *= 2;
+	for(int j=0; j < n; j++)
+	{
+		layout->keys[k] = sorted[j]->movieID;
+		layout->infos[k] = sorted[j];
+		if(2 * k + 1 <= (size_t)n)
+		{
+			k = 2 * k + 1;
+			while(2 * k <= (size_t)n) k *= 2;
+		}
+		else
+		{
+			// Climb past the nodes whose right subtree is done, then once more to the first one whose left subtree is
+			while(k & 1) k >>= 1;
+			k >>= 1;
+		}
+	}
+	return layout;
+}
+
+
+/**
+ * @brief Looks a movieID up
+ * @return returns the record of the movie, NULL if it isn't laid out
+*/
+movieInfo_t *eytzingerFind(const eytzinger_t *layout, int movieID)
+{
+	const int *keys = layout->keys;
+	size_t n = (size_t)layout->n;
+	size_t k = 1;
+	while(k <= n)
+	{
+		if(EYTZINGER_PREFETCH * k <= n) __builtin_prefetch(&keys[EYTZINGER_PREFETCH * k]);
+		k = 2 * k + (keys[k] < movieID);
+	}
+
+	// Every right turn after the last left one is undone, which leaves the smallest key not below movieID
+	k >>= __builtin_ffsl((long)~k);
+	if(k == 0 || keys[k] != movieID) return NULL;
+	return layout->infos[k];
+}
+
+
+/**
+ * @brief Frees a layout, not the records it points to
+ * @return returns void
+*/
+void deleteEytzinger(eytzinger_t *layout)
+{
+	if(layout == NULL) return;
+	free(layout->keys);
+	free(layout->infos);
+	free(layout);
+}
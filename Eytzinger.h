@@ -0,0 +1,66 @@
+/*****************************************************
+ * @file   Eytzinger.h                                *
+ *                                                   *
+ * @brief Read-only BFS layout of a category         *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef EYTZINGER_FILE
+#define EYTZINGER_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+
+/*
+ * With CATEGORY_EYTZINGER defined, every D lays the movieIDs of each category out again in
+ * Eytzinger order: the implicit complete tree whose node k has its children at 2k and 2k+1,
+ * stored breadth first. A parallel array holds the record of every key, so a W updates the
+ * same scores the category tree holds.
+ *
+ * A search is a loop without a data-dependent branch: it moves to 2k or 2k+1 by comparing the
+ * key, and prefetches the line holding the node four levels further down, whose sixteen keys
+ * are all descendants of the node. The keys start on a cache line, so each line holds
+ * one whole group of sixteen. The layout isn't updated; D unpublishes it before changing the
+ * tree and builds a new one afterwards.
+ */
+
+#define EYTZINGER_CACHE_LINE 64
+#define EYTZINGER_PREFETCH (EYTZINGER_CACHE_LINE / sizeof(int))	/* Keys per cache line, four levels of the layout */
+
+struct movie_info;
+
+
+/**
+ * Structure defining the layout of a category
+*/
+typedef struct eytzinger
+{
+	int n;								/* The number of keys */
+	int *keys;							/* keys[1..n] in breadth first order, keys[0] unused */
+	struct movie_info **infos;			/* infos[k] is the record of keys[k] */
+}eytzinger_t;
+
+
+/**
+ * @brief Lays out n records sorted by ascending movieID
+ * @return returns the layout, NULL on malloc failure
+*/
+eytzinger_t *makeEytzinger(struct movie_info **sorted, int n);
+
+
+/**
+ * @brief Looks a movieID up
+ * @return returns the record of the movie, NULL if it isn't laid out
+*/
+struct movie_info *eytzingerFind(const eytzinger_t *layout, int movieID);
+
+
+/**
+ * @brief Frees a layout, not the records it points to
+ * @return returns void
+*/
+void deleteEytzinger(eytzinger_t *layout);
+
+
+#endif
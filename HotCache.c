@@ -0,0 +1,118 @@
+/*****************************************************
+ * @file   HotCache.c                                 *
+ *                                                   *
+ * @brief Implementation for HotCache.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Picks the set of a movieID
+ * @return returns the set
+*/
+static hotSet_t *hotCacheSet(hotCache_t *cache, int movieID)
+{
+	return &cache->sets[((uint32_t)movieID * 2654435761u) >> (32 - HOTCACHE_SET_BITS)];
+}
+
+
+/**
+ * @brief Empties the cache and initializes its locks
+ * @return returns 1 on success, 0 if a lock can't be initialized
+*/
+int hotCacheInit(hotCache_t *cache)
+{
+	for(int i=0; i < HOTCACHE_SETS; i++)
+	{
+		hotSet_t *set = &cache->sets[i];
+		if(pthread_mutex_init(&set->lock, NULL) != 0) return 0;
+		set->hand = 0;
+		for(int w=0; w < HOTCACHE_WAYS; w++)
+		{
+			set->movieIDs[w] = 0;
+			set->categories[w] = -1;
+			set->referenced[w] = 0;
+			set->infos[w] = NULL;
+			set->nodes[w] = NULL;
+		}
+	}
+	cache->hits = 0;
+	cache->misses = 0;
+	return 1;
+}
+
+
+/**
+ * @brief Looks the record of a movie up and counts the hit or miss. Sets *node (if node isn't NULL) to the
+ * category node cached with the record, NULL on a miss
+ * @return returns the record, NULL on a miss
+*/
+movieInfo_t *hotCacheFind(hotCache_t *cache, int movieID, int category, movie_t **node)
+{
+	hotSet_t *set = hotCacheSet(cache, movieID);
+	movieInfo_t *info = NULL;
+	if(node != NULL) *node = NULL;
+	pthread_mutex_lock(&set->lock);
+	for(int w=0; w < HOTCACHE_WAYS; w++)
+	{
+		if(set->movieIDs[w] == movieID && set->categories[w] == category)
+		{
+			set->referenced[w] = 1;
+			info = set->infos[w];
+			if(node != NULL) *node = set->nodes[w];
+			break;
+		}
+	}
+	pthread_mutex_unlock(&set->lock);
+	if(info != NULL) __atomic_fetch_add(&cache->hits, 1, __ATOMIC_RELAXED);
+	else __atomic_fetch_add(&cache->misses, 1, __ATOMIC_RELAXED);
+	return info;
+}
+
+
+/**
+ * @brief Caches the record of a movie found in its category, and its category node if node isn't NULL,
+ * evicting a way of its set with CLOCK
+ * @return returns void
+*/
+void hotCacheAdd(hotCache_t *cache, int movieID, int category, movieInfo_t *info, movie_t *node)
+{
+	hotSet_t *set = hotCacheSet(cache, movieID);
+	pthread_mutex_lock(&set->lock);
+	for(int w=0; w < HOTCACHE_WAYS; w++)
+	{
+		// Another thread missed on the same movie and cached it first, maybe without its node
+		if(set->movieIDs[w] == movieID && set->categories[w] == category)
+		{
+			if(set->nodes[w] == NULL) set->nodes[w] = node;
+			pthread_mutex_unlock(&set->lock);
+			return;
+		}
+	}
+	while(set->referenced[set->hand])
+	{
+		set->referenced[set->hand] = 0;
+		set->hand = (set->hand + 1) % HOTCACHE_WAYS;
+	}
+	int w = set->hand;
+	set->movieIDs[w] = movieID;
+	set->categories[w] = category;
+	set->infos[w] = info;
+	set->nodes[w] = node;
+	set->hand = (w + 1) % HOTCACHE_WAYS;
+	pthread_mutex_unlock(&set->lock);
+}
+
+
+/**
+ * @brief Prints the hit and miss counters and the hit ratio
+ * @return returns void
+*/
+void hotCachePrint(hotCache_t *cache)
+{
+	unsigned long long hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+	unsigned long long misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+	double ratio = hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0;
+	printf("   Hot movies: %llu hits, %llu misses, %.2f hit ratio\n", hits, misses, ratio);
+}
@@ -0,0 +1,94 @@
+/*****************************************************
+ * @file   HotCache.h                                 *
+ *                                                   *
+ * @brief CLOCK cache of the most watched movies     *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef HOTCACHE_FILE
+#define HOTCACHE_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+/*
+ * With MOVIE_HOT_CACHE defined, the lookups of I and W that the movie map can't answer go
+ * through a small cache of movie records keyed by (movieID, category) before they walk a
+ * category. Watch traffic is skewed, so a few hundred movies take most of the lookups.
+ *
+ * The cache is set associative: a movieID hashes to one set of eight ways. Each set is
+ * replaced with CLOCK. A hit sets the referenced bit of its way. A miss that finds the movie
+ * in the category puts it at the hand, after the hand has passed the referenced ways and
+ * cleared their bits. A new entry starts unreferenced, so a movie looked up once is the first
+ * to go and a one-off scan doesn't push the popular movies out. Movies are never removed
+ * from the categories and keep their records, so an entry never goes stale. With the sentinel BST
+ * an entry holds the category node of the record too, which W fixes the maxima up from.
+ */
+
+#define HOTCACHE_SET_BITS 8
+#define HOTCACHE_SETS (1 << HOTCACHE_SET_BITS)
+#define HOTCACHE_WAYS 8
+
+struct movie_info;
+struct movie;
+
+
+/**
+ * Structure defining a set of the cache
+*/
+typedef struct hot_set
+{
+	pthread_mutex_t lock;
+	int hand;										/* The way CLOCK looks at next */
+	int movieIDs[HOTCACHE_WAYS];
+	int categories[HOTCACHE_WAYS];					/* -1 while the way is empty */
+	uint8_t referenced[HOTCACHE_WAYS];				/* Set by a hit, cleared as the hand passes */
+	struct movie_info *infos[HOTCACHE_WAYS];
+	struct movie *nodes[HOTCACHE_WAYS];				/* The category nodes of the records, NULL where unknown */
+}__attribute__((aligned(64))) hotSet_t;
+
+
+/**
+ * Structure defining the cache
+*/
+typedef struct hot_cache
+{
+	hotSet_t sets[HOTCACHE_SETS];
+	uint64_t hits;
+	uint64_t misses;
+}hotCache_t;
+
+
+/**
+ * @brief Empties the cache and initializes its locks
+ * @return returns 1 on success, 0 if a lock can't be initialized
+*/
+int hotCacheInit(hotCache_t *cache);
+
+
+/**
+ * @brief Looks the record of a movie up and counts the hit or miss. Sets *node (if node isn't NULL) to the
+ * category node cached with the record, NULL on a miss
+ * @return returns the record, NULL on a miss
+*/
+struct movie_info *hotCacheFind(hotCache_t *cache, int movieID, int category, struct movie **node);
+
+
+/**
+ * @brief Caches the record of a movie found in its category, and its category node if node isn't NULL,
+ * evicting a way of its set with CLOCK
+ * @return returns void
+*/
+void hotCacheAdd(hotCache_t *cache, int movieID, int category, struct movie_info *info, struct movie *node);
+
+
+/**
+ * @brief Prints the hit and miss counters and the hit ratio
+ * @return returns void
+*/
+void hotCachePrint(hotCache_t *cache);
+
+
+#endif
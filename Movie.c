@@ -5,70 +5,68 @@
  * @brief Implementation for Movie.h 				 *
  * Project: Winter 2023						         *
  *****************************************************/
-#include "Movie.h"
+#include "MovieInternal.h"
 
 /**
  * @brief Creates a new user.
  * Creates a new user with userID as its identification.
  *
+ * @param instance The catalog the event goes to
  * @param userID The new user's identification
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int register_user(int userID){
+ int register_user(catalog_t *instance, int userID){
+	catalogUse(instance);
 
 	// Return 0 if userId > max_id
-	if(userID > max_id)
+	if(userID > catalog->max_id)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
 		return 0;
 	} 
 
-	//Check if the User Already Exists
-	if(existsUser(userID))
+	// Return 0 if max_users users are registered already, before anything is allocated. The registration is reserved
+	// first, so that concurrent R events can't all pass the check. A refused, failed or duplicate R gives it back
+	int registered = __atomic_fetch_add(&catalog->registrations, 1, __ATOMIC_RELAXED);
+	if(catalog->max_users > 0 && registered >= catalog->max_users)
 	{
-		printf("User with userID: %d Already exists\n", userID);
-		return -1;
+		__atomic_fetch_sub(&catalog->registrations, 1, __ATOMIC_RELAXED);
+		printf("UserID: %d can't register, max_users: %d are registered\n", userID, catalog->max_users);
+		return 0;
 	}
 
 	user_t *newUser = makeNewUser(userID);
 	if(!newUser)
 	{
+		__atomic_fetch_sub(&catalog->registrations, 1, __ATOMIC_RELAXED);
 		printf("Malloc failed upon user memory allocation\n");
 		return -2;
 	} 
 
-	// Generate Key using a call to the hash function
-	int key = hash_function(a, b, userID, m, p);
-
-	// Access Last User on appropriate Hash Table cell chain and add newUser
-	user_t *user;
-
-	// Check if Hash Table cell is empty
-	if(user_hashtable_p[key] == NULL)
+	// Append newUser to the tail of its chain, found by the same walk that looks for the User Already Existing
+	userSlot_t slot;
+	if(!userTableInsert(&catalog->userTable, newUser, &slot))
 	{
-		user_hashtable_p[key] = newUser;
-
-		// Print statements
-		printf("R %d\n", userID);
-		printf("Chain %d of Users:\n   %d\n", key, newUser->userID);
-		printf("DONE\n\n");
-		return 1;
+		__atomic_fetch_sub(&catalog->registrations, 1, __ATOMIC_RELAXED);
+		freeUser(newUser);
+		printf("User with userID: %d Already exists\n", userID);
+		return -1;
 	}
 
-	// Otherwise find chain tail
-	for(user = user_hashtable_p[key]; user->next != NULL; user = user->next);
-	user->next = newUser;
-
-	// Print statements
+	// Print statements. The chain is read like any other reader does. Only if the array was resized meanwhile is the user hashed again
+	epochEnter(&catalog->epoch);
+	userChains_t *chains = userTableChains(&catalog->userTable);
+	int key = chains == slot.chains ? slot.key : userTableKey(chains, userID);
 	printf("R %d\n", userID);
 	printf("Chain %d of Users:\n", key);
-	for(user = user_hashtable_p[key]; user != NULL; user = user->next)
+	for(user_t *user = EPOCH_READ(chains->chains[key]); user != NULL; user = EPOCH_READ(user->next))
 	{
 		printf("   %d\n", user->userID);
 	}
+	epochExit(&catalog->epoch);
 	printf("DONE\n\n");
 
 	 return 1; // Success
@@ -78,64 +76,34 @@
  * @brief Deletes a user.
  * Deletes a user with userID from the system, along with users' history tree.
  *
+ * @param instance The catalog the event goes to
  * @param userID The new user's identification
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int unregister_user(int userID){
+ int unregister_user(catalog_t *instance, int userID){
+	catalogUse(instance);
 
 	// Return 0 if userId > max_id
-	if(userID > max_id)
+	if(userID > catalog->max_id)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
 		return 0;
 	} 
 
-	//Check if the User Already Exists
-	if(!existsUser(userID))
+	// Unlink the user so that new readers can't reach it. Readers already on it keep it alive until they leave their epoch
+	user_t *user = userTableRemove(&catalog->userTable, userID);
+	if(user == NULL)
 	{
 		printf("User with userID: %d does not exist. Can't be unregistered\n", userID);
 		return -1;
 	}
+	__atomic_fetch_sub(&catalog->registrations, 1, __ATOMIC_RELAXED);
 
-	// Generate Key using a call to the hash function
-	int key = hash_function(a, b, userID, m, p);
-
-	// Access Last User on appropriate Hash Table cell chain and add newUser
-	user_t *user = user_hashtable_p[key], *prev = user_hashtable_p[key];
-
-	// Identify user
-	while(user->userID != userID)
-	{
-		prev = user;
-		user = user->next;
-	}
-	freeUserHistoryTree(user->history);
-	user->history = NULL;;
-
-	if(user == user_hashtable_p[key]) // User is root
-	{
-		if(user->next == NULL) // User is only score in user chain
-		{
-			free(user);
-			user_hashtable_p[key] = NULL;
-		}
-		else
-		{
-			user_hashtable_p[key] = user->next;
-			free(user);
-		}
-	}
-	else // User is not root
-	{
-		if(user->next == NULL) // User is last in chain
-		{
-			prev->next = NULL;
-			free(user);
-		}
-	}
+	// The user and its history tree are freed once every reader has moved past the current epoch
+	epochRetire(&catalog->epoch, user, reclaimUser);
 	 return 1;
  }
  
@@ -143,6 +111,7 @@
  * @brief Add new movie to new release binary tree.
  * Create a node movie and insert it in 'new release' binary tree.
  *
+ * @param instance The catalog the event goes to
  * @param movieID The new movie identifier
  * @param category The category of the movie
  * @param year The year movie released
@@ -151,7 +120,8 @@
  *         0 on failure
  */
 
- int add_new_movie(int movieID, int category, int year){
+ int add_new_movie(catalog_t *instance, int movieID, int category, int year){
+	catalogUse(instance);
 
 	// Allocate new memory for newMovie and return 0 upon fialure accordingly
 	newMovie_t *newMovie = makeNewMovie(movieID, category, year);
@@ -162,9 +132,11 @@
 	}
 
 	// Check if newMoviesTree is empty
-	if(newMoviesTree.root == NULL)
+	if(catalog->newMoviesTree.root == NULL)
 	{
-		newMoviesTree.root = newMovie;
+		movieFilterAdd(movieID);
+		movieMapAdd(movieID);
+		EPOCH_PUBLISH(catalog->newMoviesTree.root, newMovie);
 		printf("A %d %d %d\n", movieID, category, year);
 		printf("New releases Tree:\n");
 		printf("   new releases: %d\n", movieID);
@@ -172,41 +144,33 @@
 		return 1;
 	}
 
+	// A movieID the map knows, or the filter has never seen, needs neither of the walks below
+	int where = movieMapFind(movieID, NULL, NULL);
+	int mayExist = where == MOVIE_MAP_UNKNOWN && movieMayExist(movieID);
+
 	// Check if the NewMovie Already Exists
-	if(existsNewMovie(movieID))
+	if(where == MOVIE_MAP_NEW || (mayExist && existsNewMovie(movieID)))
 	{
 		printf("Movie with MovieID: %d already exists in newMoviesTree\n", movieID);
 		return -1;
 	}
 
 	// Check if the newMovie Already Exists in the corresponding tree of the category array
-	if(newMovieExistsInCategoryArray(movieID, category))
+	if(where == category || (mayExist && newMovieExistsInCategoryArray(movieID, category)))
 	{
 		printf("Movie with MovieID: %d already exists in Category Array Trees\n", movieID);
 		return -1;
 	}
 
 	// Otherwise add the movie
-	newMovie_t *curr_newMovie = newMoviesTree.root, *prev_newMovie = newMoviesTree.root;
-	while(curr_newMovie != NULL)
-	{
-		if(curr_newMovie->Info->movieID > movieID)
-		{
-			prev_newMovie = curr_newMovie;
-			curr_newMovie = curr_newMovie->lc;
-		}
-		else
-		{
-			prev_newMovie = curr_newMovie;
-			curr_newMovie = curr_newMovie->rc;		
-		}
-	}
-	if(prev_newMovie->Info->movieID > movieID) prev_newMovie->lc = newMovie;
-	else prev_newMovie->rc = newMovie;
+	newMovie_t *parent = newMovieParent(catalog->newMoviesTree.root, movieID);
+	movieFilterAdd(movieID);
+	movieMapAdd(movieID);
+	newMovieLink(parent, newMovie);
 	printf("A %d %d %d\n", movieID, category, year);
 	printf("New releases Tree:\n");
 	printf("   new releases: ");
-	InOrderPrintNewMovieTree(newMoviesTree.root);
+	InOrderPrintNewMovieTree(catalog->newMoviesTree.root);
 	printf("\n");
 	printf("DONE\n\n");
 	return 1;
@@ -216,73 +180,266 @@
  /**
  * @brief Distribute the movies from new release binary tree to the array of categories.
  *
+ * @param instance The catalog the event goes to
+ *
  * @return 0 on success
  *         1 on failure
  */
 
- int distribute_movies(void){
+ int distribute_movies(catalog_t *instance){
+	catalogUse(instance);
 
-	if(newMoviesTree.root == NULL)
+	if(catalog->newMoviesTree.root == NULL)
 	{
 		printf("There are no movies to distribute\n");
 		return 1;
 	}
-	int err = postOrderDistribute(newMoviesTree.root);
+
+	// Detach the tree before walking it, so that the nodes retired by the walk are no longer reachable.
+	// Setting newMoviesTree.root to NULL also signifies it's empty and avoids repeated freeing attempts
+	newMovie_t *releases = catalog->newMoviesTree.root;
+	EPOCH_PUBLISH(catalog->newMoviesTree.root, NULL);
+#ifdef CATEGORY_EYTZINGER
+	// Lookups walk the trees while they change, and find the new movies in the layouts built afterwards
+	for(int i=0; i<6; i++) categoryLayoutDrop(i);
+#endif
+	int err = postOrderDistribute(releases);
+#ifdef CATEGORY_EYTZINGER
+	for(int i=0; i<6; i++) categoryLayoutBuild(i);
+#endif
+#ifdef CATALOG_VERSIONS
+	// Whatever was distributed becomes visible to readers as one version, even if the distribution stopped midway
+	versionPublish(&catalog->versions);
+#endif
+	queryCacheTouchCatalog(&catalog->queryCache);
 	if(err != 1)
 	{
+		// Whatever could not be distributed stays in the new releases tree
+		EPOCH_PUBLISH(catalog->newMoviesTree.root, releases);
 		printf("An error occured while distributing the movies\n");
 		return 0;
 	}
-	// Set newMoviesTree.root to NULL to signify it's empty and not get repeated freeing attempts
-	newMoviesTree.root = NULL;
 
 	// Print results upon success
 	printf("D\nMovie Category Array:\n");
 	printf("   HORROR: ");
-	inOrderMoviePrint(categoryArray[0]->movie);
+	categoryPrint(0, catalog->categoryArray[0]->movie);
 	printf("\n   SCIENCE-FICTION: ");
-	inOrderMoviePrint(categoryArray[1]->movie);
+	categoryPrint(1, catalog->categoryArray[1]->movie);
 	printf("\n   DRAMA: ");
-	inOrderMoviePrint(categoryArray[2]->movie);
+	categoryPrint(2, catalog->categoryArray[2]->movie);
 	printf("\n   ROMANCE: ");
-	inOrderMoviePrint(categoryArray[3]->movie);
+	categoryPrint(3, catalog->categoryArray[3]->movie);
 	printf("\n   DOCUMENTARY: ");
-	inOrderMoviePrint(categoryArray[4]->movie);
+	categoryPrint(4, catalog->categoryArray[4]->movie);
 	printf("\n   COMEDY: ");
-	inOrderMoviePrint(categoryArray[5]->movie);
+	categoryPrint(5, catalog->categoryArray[5]->movie);
 	printf("\nDONE\n\n");
 	return 1;
  }
  
- /**
- * @brief User rates the movie with identification movieID with score
- *
- * @param userID The identifier of the user
- * @param category The Category of the movie
- * @param movieID The identifier of the movie
- * @param score The score that user rates the movie with id movieID
- *
- * @return 1 on success
- *         0 on failure
- */
 
- int watch_movie(int userID,int category, int movieID, int score){
+#define WATCH_PROBE_ROOT 0		/* Read the root of the history from the user */
+#define WATCH_PROBE_NODE 1		/* Read the children and info of a history node */
+#define WATCH_PROBE_INFO 2		/* Read the key of a history node */
+#define WATCH_PROBE_DONE 3
+
+// The lookups of a W event in flight in watch_movies(). Every field that holds a node holds one that was prefetched
+typedef struct watch_probe
+{
+	userProbe_t user;		/* The lookup of the user */
+	int historyStage;		/* WATCH_PROBE_ROOT, _NODE or _INFO for what the next step of the history reads, _DONE at the end */
+	uint64_t version;		/* The version of the user when its history was read */
+	userMovie_t *history;	/* The history node the next step reads */
+	userMovie_t *leaf;		/* The last history node read, the leaf the movie goes next to once done */
+#ifdef CATEGORY_PARENTS
+	movieSlot_t *slot;		/* The movie map slot the next step reads, NULL once read or if the map doesn't cover the movie */
+#endif
+	movie_t *movie;			/* The category node the next step reads, NULL once the path to the movie is fetched */
+	int movieInfo;			/* Set if the next step reads the info of movie */
+	int walked;				/* Set if the path to the movie is walked, so that found is the answer */
+	movie_t *found;			/* The category node of the movie, NULL if the category doesn't hold it */
+	int category;
+	int movieID;
+}watchProbe_t;
+
+
+#ifdef CATEGORY_PARENTS
+/**
+ * @brief Finds the category node of the movie of a W event in the hot movie cache, or else starts the walk down to it
+ * @return returns void
+*/
+static void watchProbeCategory(watchProbe_t *probe)
+{
+	probe->walked = 1;
+	if(movieHotFind(probe->movieID, probe->category, &probe->found) != NULL && probe->found != NULL) return;
+	probe->movie = EPOCH_READ(catalog->categoryArray[probe->category]->movie);
+	__builtin_prefetch(probe->movie);
+}
+#endif
+
+
+/**
+ * @brief Starts the lookups of a W event
+ * @return returns void
+*/
+static void watchProbeStart(watchProbe_t *probe, const watchEvent_t *event)
+{
+	probe->movieID = event->movieID;
+	probe->historyStage = WATCH_PROBE_ROOT;
+	probe->history = NULL;
+	probe->leaf = NULL;
+	probe->movie = NULL;
+	probe->movieInfo = 0;
+	probe->walked = 0;
+	probe->found = NULL;
+	probe->category = event->category;
+#ifdef CATEGORY_PARENTS
+	probe->slot = NULL;
+#endif
+	userTableProbeStart(&catalog->userTable, &probe->user, event->userID);
+	if(event->category < 0 || event->category >= 6 || catalog->categoryArray[event->category] == NULL) return;
+
+	movieMap_t *map = EPOCH_READ(catalog->movieMap);
+#ifdef CATEGORY_PARENTS
+	// The map slot of the movie holds its node, and the maxima are fixed up from the node, so a movie the map
+	// knows needs no walk. The hot cache answers for the others before the path is walked
+	if(map != NULL && event->movieID >= 0 && event->movieID < map->size)
+	{
+		probe->slot = &map->slots[event->movieID];
+		__builtin_prefetch(probe->slot);
+	}
+	else watchProbeCategory(probe);
+#else
+	if(map != NULL && event->movieID >= 0 && event->movieID < map->size) __builtin_prefetch(&map->slots[event->movieID]);
+#endif
+#if !defined(CATEGORY_PARENTS) && !defined(CATEGORY_INDEX)
+	// CATALOG_VERSIONS drafts the path to the movie even when the map holds its record, so the path is always walked
+	probe->movie = EPOCH_READ(catalog->categoryArray[event->category]->movie);
+	probe->walked = 1;
+	__builtin_prefetch(probe->movie);
+#endif
+}
+
+
+/**
+ * @brief Advances each lookup of a W event by one read: the user, then the path to the movie in the history,
+ * and the path to the movie in its category alongside
+ * @return returns 1 while a lookup needs more steps, 0 once every node they need is fetched
+*/
+static int watchProbeStep(watchProbe_t *probe)
+{
+	if(probe->user.stage != USER_PROBE_DONE)
+	{
+		userTableProbeStep(&probe->user);
+		if(probe->user.stage == USER_PROBE_DONE && probe->user.user == NULL) probe->historyStage = WATCH_PROBE_DONE;
+	}
+	else if(probe->historyStage == WATCH_PROBE_ROOT)
+	{
+		// A W of the user changes its version after its history, so a history read after the version is at least as new
+		probe->version = __atomic_load_n(&probe->user.user->version, __ATOMIC_ACQUIRE);
+		probe->history = EPOCH_READ(probe->user.user->history);
+		probe->historyStage = WATCH_PROBE_NODE;
+	}
+	else if(probe->historyStage == WATCH_PROBE_NODE)
+	{
+		__builtin_prefetch(probe->history->Info);
+		probe->historyStage = WATCH_PROBE_INFO;
+	}
+	else if(probe->historyStage == WATCH_PROBE_INFO)
+	{
+		// The history routes keys <= a node's key to the left, as addMovieToUser() does
+		probe->history = probe->history->Info->movieID >= probe->movieID ? EPOCH_READ(probe->history->lc) : EPOCH_READ(probe->history->rc);
+		probe->historyStage = WATCH_PROBE_NODE;
+	}
+	if(probe->historyStage == WATCH_PROBE_NODE)
+	{
+		if(probe->history == NULL) probe->historyStage = WATCH_PROBE_DONE;
+		else
+		{
+			probe->leaf = probe->history;
+			__builtin_prefetch(probe->history);
+		}
+	}
+	int busy = probe->historyStage != WATCH_PROBE_DONE;
+
+#ifdef CATEGORY_PARENTS
+	if(probe->slot != NULL)
+	{
+		// A movie mapped to another category, or not yet distributed, isn't in the category
+		int where = __atomic_load_n(&probe->slot->where, __ATOMIC_ACQUIRE) + MOVIE_MAP_ABSENT;
+		if(where == probe->category) probe->found = EPOCH_READ(probe->slot->node);
+		if(where == MOVIE_MAP_UNKNOWN || (where == probe->category && probe->found == NULL)) watchProbeCategory(probe);
+		else probe->walked = 1;
+		probe->slot = NULL;
+		busy = busy || probe->movie != NULL;
+	}
+	else
+#endif
+	if(probe->movie != NULL)
+	{
+		if(!probe->movieInfo) __builtin_prefetch(probe->movie->Info);
+		else
+		{
+			int movieID = probe->movie->Info->movieID;
+			if(movieID == probe->movieID) probe->found = probe->movie;
+			if(movieID == -1 || movieID == probe->movieID) probe->movie = NULL;
+			else
+			{
+				probe->movie = movieID > probe->movieID ? EPOCH_READ(probe->movie->lc) : EPOCH_READ(probe->movie->rc);
+				__builtin_prefetch(probe->movie);
+			}
+		}
+		probe->movieInfo = !probe->movieInfo;
+		busy = busy || probe->movie != NULL;
+	}
+	return busy;
+}
+
 
+/**
+ * @brief Applies a W event. With a finished probe of it, the user, the category node and the history leaf it found
+ * are used instead of being looked up again, as long as nothing changed them since
+ * @return returns what watch_movie() returns
+*/
+static int watchApply(int userID, int category, int movieID, int score, const watchProbe_t *probe)
+{
 	// return -3 if score is not in range [1, 10]
 	if(score < 1 || score > 10) return -3;
 	
-	// First call userTreeRoot(userID) to return the root of the tree corresponding to the particular user
-	user_t *user;
-	int succ = userFind(userID, &user);
-	if(!succ) return 0; //return 0 when failing to find user
+	// One probe locks the stripe of the user and finds it. The stripe serializes the edits of its history and keeps it from being unregistered meanwhile
+	userSlot_t slot;
+	user_t *user = userLocateProbed(userID, probe != NULL ? &probe->user : NULL, &slot);
+	if(user == NULL) return 0; //return 0 when failing to find user
+	int stripe = slot.stripe;
+
+	// Having asserted that both the user exists and having gotten the user tree root edit the existing Movie to account for the new score.
+	// W events don't reshape the category trees, so the node a probe found is still the movie's
+	int exists;
+#ifndef CATEGORY_INDEX
+	if(probe != NULL && probe->walked) exists = probe->found != NULL && editeMovieNode(probe->found, score, category);
+	else
+#endif
+	exists = editeMovie(movieID, score, category);
+	if(!exists)
+	{
+		userTableUnlock(&catalog->userTable, stripe);
+		return -1; // Return -1 if movie does not exist in categoryArray Trees
+	}
 
-	// Having asserted that both the user exists and having gotten the user tree root edit the existing Movie to account for the new score
-	int exists = editeMovie(movieID, score, category);
-	if(!exists) return -1; // Return -1 if movie does not exist in categoryArray Trees
+	// Movie Edited. Now create new usermovie to add to user history Tree. The leaf a probe found stands unless
+	// a W of the user, an earlier one of the same batch included, changed the version since
+	userMovie_t *leaf = NULL;
+	if(probe != NULL && user == probe->user.user && __atomic_load_n(&user->version, __ATOMIC_ACQUIRE) == probe->version) leaf = probe->leaf;
+	int succ = addMovieToUserAt(&user, leaf, category, movieID, score);
+	if(!succ)
+	{
+		userTableUnlock(&catalog->userTable, stripe);
+		return -2; // Return -2 if error occured while adding Movie to User History Tree
+	}
 
-	// Movie Edited. Now create new usermovie to add to user history Tree
-	succ = addMovieToUser(&user, category, movieID, score);
-	if(!succ) return -2; // Return -2 if error occured while adding Movie to User History Tree
+	// Cached Q results of the user are stale from now on
+	__atomic_store_n(&user->version, queryCacheNextVersion(&catalog->queryCache), __ATOMIC_RELEASE);
 
 	// Print Statements upon success
 	printf("W %d ", userID);
@@ -311,1034 +468,2815 @@
 	printf("History Tree of User %d:\n", userID);
 	InOrderPrintHistoryTreeLeaves(user->history);
 	printf("DONE\n\n");
+	userTableUnlock(&catalog->userTable, stripe);
 
 
 	return 1;
- }
- 
-/**
- * @brief Identify the best rating score movie and cluster all the movies of a category.
+}
+
+
+ /**
+ * @brief User rates the movie with identification movieID with score
  *
+ * @param instance The catalog the event goes to
  * @param userID The identifier of the user
- * @param score The minimum score of a movie
+ * @param category The Category of the movie
+ * @param movieID The identifier of the movie
+ * @param score The score that user rates the movie with id movieID
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int filter_movies(int userID, float score){
+ int watch_movie(catalog_t *instance, int userID,int category, int movieID, int score){
+	catalogUse(instance);
+	return watchApply(userID, category, movieID, score, NULL);
+ }
 
-	movie_t **helperMovieArray;
-	int n_movies = getNumberOfMovies();
-	if(n_movies == 0)
-	{
-		printf("Movie Category Array is empty");
-		return 0;
-	}
 
-	// Allocate memory for helperMovieArray
-	helperMovieArray = (movie_t**)malloc(n_movies * sizeof(movie_t*));
-	if(!helperMovieArray) return 0; // Return 0 upon failure to allocate helperMovieArray
+/**
+ * @brief Handles a run of W events as watch_movie() would one after the other. The lookups of all of them
+ * are first advanced together, a cache miss at a time, so that their misses overlap, and each event is then
+ * applied to the user, category node and history leaf its lookups found
+ *
+ * @param instance The catalog the event goes to
+ * @param events The events, whose results are stored in them
+ * @param n The number of events, at most WATCH_BATCH
+ *
+ * @return void
+ */
 
-	int max_index = 0;
-	for(int categ = 0; categ < 6; categ++)
+ void watch_movies(catalog_t *instance, watchEvent_t *events, int n){
+	catalogUse(instance);
+
+	// Each round reads one line per event that the previous round prefetched, and prefetches the next
+	watchProbe_t probes[WATCH_BATCH];
+	int busy[WATCH_BATCH];
+	int active = n;
+	epochEnter(&catalog->epoch);
+	for(int i=0; i < n; i++)
+	{
+		watchProbeStart(&probes[i], &events[i]);
+		busy[i] = 1;
+	}
+	while(active > 0)
 	{
-		if(categoryArray[categ] != NULL)
+		for(int i=0; i < n; i++)
 		{
-			inOrderAddBasedOnScore(categoryArray[categ]->movie, score, helperMovieArray, &max_index);
+			if(busy[i] && !watchProbeStep(&probes[i]))
+			{
+				busy[i] = 0;
+				active--;
+			}
 		}
 	}
 
-	// Having filled the helperMovieArray in up until the max_index, sort it using HeapSort
-	heapSort(helperMovieArray, max_index);
+	// The events are applied in order. The read section lasts until the last one, so every node a probe holds
+	// stays alive, which W events allow since they retire nothing. A result an earlier event may have changed is
+	// checked by watchApply() before it is used
+	for(int i=0; i < n; i++) events[i].result = watchApply(events[i].userID, events[i].category, events[i].movieID, events[i].score, &probes[i]);
+	epochExit(&catalog->epoch);
+ }
 
-	// Print Statements
-	printf("F %d %f\n   ", userID, score);
-	if(max_index == 0)
-	{
-		printf("  EMPTY\nDONE\n\n");
-		free(helperMovieArray);
-		return 1;
-	}
-	float mvScore;
-	int mvID;
-	for(int i=0; i < max_index; i++)
+
+// A rating of watch_bulk() at its place in the order the ratings are applied in
+typedef struct watch_order
+{
+	int key;		/* The userID or the category the ratings are grouped by */
+	int movieID;
+	int index;		/* The event of the rating */
+}watchOrder_t;
+
+
+/**
+ * @brief qsort() comparator of ratings by key, then movieID, then the order they were given in
+ * @return returns <0, 0 or >0
+*/
+static int watchOrderCompare(const void *a, const void *b)
+{
+	const watchOrder_t *x = (const watchOrder_t*)a;
+	const watchOrder_t *y = (const watchOrder_t*)b;
+	if(x->key != y->key) return x->key < y->key ? -1 : 1;
+	if(x->movieID != y->movieID) return x->movieID < y->movieID ? -1 : 1;
+	return x->index - y->index;
+}
+
+
+/**
+ * @brief Lists the ratings still pending (result 1) in order, grouped by userID or by category
+ * @return returns the number of ratings listed
+*/
+static int watchOrderBuild(watchOrder_t *order, const watchEvent_t *events, int n, int byUser)
+{
+	int count = 0;
+	for(int i=0; i < n; i++)
 	{
-		mvScore = (float)helperMovieArray[i]->Info->sumScore / (float)helperMovieArray[i]->Info->watchedCounter;
-		mvID = helperMovieArray[i]->Info->movieID;
-		printf("{%d %f}, ", mvID, mvScore);
+		if(events[i].result != 1) continue;
+		order[count].key = byUser ? events[i].userID : events[i].category;
+		order[count].movieID = events[i].movieID;
+		order[count].index = i;
+		count++;
 	}
-	printf("\nDONE\n\n");
-	free(helperMovieArray);
+	qsort(order, count, sizeof(watchOrder_t), watchOrderCompare);
+	return count;
+}
 
-	return 1;
- }
- 
-/**
- * @brief Find movies from categories withn median_score >= score t
- *
- * @param userID The identifier of the user
- * @param category Array with the categories to search.
- * @param score The minimum score the movies we want to have
- *
- * @return 1 on success
- *         0 on failure
- */
 
- int user_stats(int userID){
+#if !defined(CATEGORY_INDEX) && !defined(CATALOG_VERSIONS)
+// A subtree movieMergeRatings() is still in
+typedef struct merge_frame
+{
+	movie_t *movie;
+	int lo, hi;			/* The ratings that fall in the subtree */
+	int first, last;	/* The node's own ratings. The ones before first go left, the ones from last on go right */
+	int state;			/* 0 before the node, 1 after its left subtree, 2 after its right one */
+}mergeFrame_t;
+
 
-	// Return 0 if userId > max_id
-	if(userID > max_id)
+/**
+ * @brief Applies the ratings order[lo, hi), ascending in movieID, to the tree of movie. It descends once into
+ * each subtree some of them fall in and recomputes the maxima of the nodes it passed on the way back up.
+ * Ratings of movies the tree doesn't hold are marked -1, and so are those of a subtree there was no memory to go into
+ * @return returns 1 if a score in the tree changed, 0 otherwise
+*/
+static int movieMergeRatings(movie_t *movie, const watchOrder_t *order, int lo, int hi, watchEvent_t *events)
+{
+	// The frames are kept on the heap, a chain of a tree is as deep as it is big
+	int depth = 0, size = TREE_WALK_INLINE, changed = 0;
+	mergeFrame_t *frames = (mergeFrame_t*)malloc(size * sizeof(mergeFrame_t));
+	if(frames == NULL)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
+		for(int i=lo; i < hi; i++) events[order[i].index].result = -1;
 		return 0;
-	} 
+	}
 
-	//Check if the User Already Exists
-	if(!existsUser(userID))
+	while(movie != NULL || depth > 0)
 	{
-		printf("User with userID: %d does not exist\n", userID);
-		return -1;
-	}
+		// Go into the subtree of movie, unless no rating falls in it
+		if(movie != NULL)
+		{
+			if(lo < hi && movie->Info->movieID != -1 && depth == size)
+			{
+				mergeFrame_t *grown = (mergeFrame_t*)realloc(frames, 2 * size * sizeof(mergeFrame_t));
+				if(grown != NULL)
+				{
+					frames = grown;
+					size = 2 * size;
+				}
+			}
+			if(lo < hi && (movie->Info->movieID == -1 || depth == size))
+			{
+				for(int i=lo; i < hi; i++) events[order[i].index].result = -1;
+			}
+			else if(lo < hi)
+			{
+				mergeFrame_t *frame = &frames[depth++];
+				frame->movie = movie;
+				frame->lo = lo;
+				frame->hi = hi;
+				frame->state = 0;
+			}
+			movie = NULL;
+			continue;
+		}
 
-	// Generate Key using a call to the hash function
-	int key = hash_function(a, b, userID, m, p);
+		mergeFrame_t *frame = &frames[depth - 1];
+		if(frame->state == 0)
+		{
+			int movieID = frame->movie->Info->movieID;
+			int first = frame->lo, last = frame->hi;
+			while(first < last)
+			{
+				int mid = first + (last - first) / 2;
+				if(order[mid].movieID < movieID) first = mid + 1;
+				else last = mid;
+			}
+			for(last = first; last < frame->hi && order[last].movieID == movieID; last++)
+			{
+				frame->movie->Info->sumScore += events[order[last].index].score;
+				frame->movie->Info->watchedCounter += 1;
+				changed = 1;
+			}
+			frame->first = first;
+			frame->last = last;
+			frame->state = 1;
+			movie = frame->movie->lc;
+			lo = frame->lo;
+			hi = first;
+		}
+		else if(frame->state == 1)
+		{
+			frame->state = 2;
+			movie = frame->movie->rc;
+			lo = frame->last;
+			hi = frame->hi;
+		}
+		else
+		{
+			// Both subtrees are done, so the maxima below are right again
+			movieUpdateMaxScore(frame->movie);
+			depth--;
+		}
+	}
+	free(frames);
+	return changed;
+}
+#endif
 
-	user_t *user;
-	int succ = userFind(userID, &user);
 
-	int scoreSum = 0, counter = 0;
-	inOrderFindStats(user->history, &scoreSum, &counter);
-	if(counter == 0)
+/**
+ * @brief Applies the ratings order[lo, hi) of one category, ascending in movieID, in one sweep of it.
+ * Ratings of movies the category doesn't hold are marked -1
+ * @return returns 1 if a score changed, 0 otherwise
+*/
+static int categoryMergeRatings(int category, const watchOrder_t *order, int lo, int hi, watchEvent_t *events)
+{
+#ifdef CATEGORY_INDEX
+	// The walk steps from one rated movie to the next, and seeks instead past gaps of more than WATCH_BULK_SKIP movies
+	categoryIter_t iter;
+	movieInfo_t *info = NULL;
+	int seeked = 0, changed = 0;
+	for(int i=lo; i < hi; i++)
 	{
-		printf("User with UserID: %d has not watched any movies\n", userID);
-		return -2;
+		int movieID = order[i].movieID;
+		for(int steps=0; info != NULL && info->movieID < movieID && steps < WATCH_BULK_SKIP; steps++) info = categoryIterNext(&iter);
+		if(!seeked || (info != NULL && info->movieID < movieID))
+		{
+			if(seeked) categoryIterEnd(&iter);
+			categoryIterSeek(&iter, category, NULL, movieID);
+			seeked = 1;
+			info = categoryIterNext(&iter);
+		}
+		if(info == NULL || info->movieID != movieID)
+		{
+			events[order[i].index].result = -1;
+			continue;
+		}
+		__atomic_fetch_add(&info->sumScore, events[order[i].index].score, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&info->watchedCounter, 1, __ATOMIC_RELAXED);
+		changed = 1;
 	}
+	if(seeked) categoryIterEnd(&iter);
+	return changed;
+#elif defined(CATALOG_VERSIONS)
+	// Published versions keep the old scores, so each movie is copied into the draft as W does
+	int changed = 0;
+	for(int i=lo; i < hi; i++)
+	{
+		if(editeMovie(order[i].movieID, events[order[i].index].score, category)) changed = 1;
+		else events[order[i].index].result = -1;
+	}
+	return changed;
+#else
+	return movieMergeRatings(catalog->categoryArray[category]->movie, order, lo, hi, events);
+#endif
+}
+
 
-	float m_score = (float)scoreSum / (float)counter;
-	printf("Q %d %f\nDONE\n\n", userID, m_score);
-	return 1;
- }
- 
 /**
- * @brief Search for a movie with identification movieID in a specific category.
- *
- * @param movieID The identifier of the movie
- * @param category The category of the movie
- *
- * @return 1 on success
- *         0 on failure
- */
+ * @brief Epoch reclaim function for the internal nodes of a History tree that watch_bulk() replaced
+ * @return returns void
+*/
+static void reclaimUserMovie(void *object)
+{
+	poolFree(&catalog->userPools.history, object);
+}
 
- int search_movie(int movieID, int category){
 
-	// Assert that the passed in category is within the limits
-	if(category >= 6 || category < 0) return -1;  // Return -1 for invalid category input argument
+/**
+ * @brief Retires the internal nodes of a replaced History tree using PostOrder Tree Traversal. Its leaves live on in the new tree
+ * @return returns void
+*/
+static void postOrderRetireHistory(userMovie_t *movie)
+{
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_POST, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(node->lc != NULL) epochRetire(&catalog->epoch, node, reclaimUserMovie);
+	}
+	treeWalkEnd(&walk);
+}
 
-	// Check if associated Tree is empty or NULL
-	if(categoryArray[category] == NULL) return 0;
-	if(categoryArray[category]->movie->Info->movieID == -1) return 0;
 
-	// Otherwise Traverse the Tree to find the movie
-	movie_t *curr = categoryArray[category]->movie;
-	while(curr->Info->movieID != -1 && curr->Info->movieID != movieID) // While the node is not the sentinel
+/**
+ * @brief Collects the leaves of a History Tree InOrder
+ * @return returns void
+*/
+static void inOrderCollectLeaves(userMovie_t *movie, userMovie_t **leaves, int *n)
+{
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
 	{
-		if(curr->Info->movieID > movieID) curr = curr->lc; // Move Left
-		else curr = curr->rc; // Move Right
+		if(node->lc == NULL) leaves[(*n)++] = node;
 	}
+	treeWalkEnd(&walk);
+}
 
-	if(curr->Info->movieID != -1)
-	{
-		printf("I %d ", curr->Info->movieID);
-		// Print Genre according to int category
-		switch (category) {
-			case 0:
-				printf("HORROR");
-				break;
-			case 1:
-				printf("SCIENCE-FICTION");
-				break;
-			case 2:
-				printf("DRAMA");
-				break;
-			case 3:
-				printf("ROMANCE");
-				break;
-			case 4:
-				printf("DOCUMENTARY");
-				break;
-			case 5:
-				printf("COMEDY");
-				break;
+
+/**
+ * @brief Links leaves[lo, hi) into a balanced History subtree, taking its internal nodes from inner[lo, hi-1).
+ * Every internal node becomes a copy of the largest leaf on its left, like the ones addMovieToUser() makes
+ * @return returns the root
+*/
+static userMovie_t *historyLinkLeaves(userMovie_t **leaves, userMovie_t **inner, int lo, int hi)
+{
+	if(hi - lo == 1) return leaves[lo];
+
+	int mid = lo + (hi - lo) / 2;
+	userMovie_t *node = inner[mid-1];
+	node->Info->movieID = leaves[mid-1]->Info->movieID;
+	node->Info->category = leaves[mid-1]->Info->category;
+	node->Info->sumScore = leaves[mid-1]->Info->sumScore;
+	node->lc = historyLinkLeaves(leaves, inner, lo, mid);
+	node->rc = historyLinkLeaves(leaves, inner, mid, hi);
+	node->lc->parent = node;
+	node->rc->parent = node;
+	return node;
+}
+
+
+/**
+ * @brief Applies the ratings order[lo, hi) of one user, ascending in movieID, to its History tree in one pass.
+ * The leaves are merged with the ratings and a balanced tree is built over them, which replaces the old one.
+ * Only call with the user's stripe locked
+ * @return returns 1 on success, 0 on malloc failure with the history unchanged
+*/
+static int historyMergeRatings(user_t *user, const watchOrder_t *order, int lo, int hi, const watchEvent_t *events)
+{
+	// A history still in the loaded snapshot is built before it is edited
+	userMovie_t *root = userHistory(user);
+	if(root == NULL && user->n_snapshot > 0) return 0;
+
+	int scoreSum = 0, watched = 0;
+	inOrderFindStats(root, &scoreSum, &watched);
+	int size = watched + (hi - lo);
+	userMovie_t **nodes = (userMovie_t**)malloc(((size_t)watched + 3 * (size_t)size) * sizeof(userMovie_t*));
+	int *scores = (int*)malloc((size_t)size * sizeof(int));
+	if(nodes == NULL || scores == NULL)
+	{
+		free(nodes);
+		free(scores);
+		return 0;
+	}
+	userMovie_t **old = nodes, **leaves = nodes + watched, **inner = leaves + size, **made = inner + size;
+	int n_old = 0, n = 0, n_made = 0, n_inner = 0, failed = 0;
+	inOrderCollectLeaves(root, old, &n_old);
+
+	// Both are ascending. A rated movie already watched keeps its leaf, and the last of its ratings sets its score
+	for(int i=lo, j=0; !failed && (i < hi || j < n_old); )
+	{
+		if(i == hi || (j < n_old && old[j]->Info->movieID < order[i].movieID))
+		{
+			scores[n] = old[j]->Info->sumScore;
+			leaves[n++] = old[j++];
+			continue;
 		}
-		printf(" %d\nDONE\n\n", curr->Info->year);
-		return 1;
+		while(i + 1 < hi && order[i+1].movieID == order[i].movieID) i++;
+		const watchEvent_t *rating = &events[order[i++].index];
+		if(j < n_old && old[j]->Info->movieID == rating->movieID) leaves[n] = old[j++];
+		else
+		{
+			leaves[n] = makeNewUserMovie(rating->movieID, rating->category, rating->score);
+			if(leaves[n] == NULL) failed = 1;
+			else made[n_made++] = leaves[n];
+		}
+		scores[n++] = rating->score;
+	}
+	for(; !failed && n_inner < n - 1; n_inner++)
+	{
+		inner[n_inner] = makeNewUserMovie(0, 0, 0);
+		if(inner[n_inner] == NULL) failed = 1;
+	}
+	if(failed)
+	{
+		for(int k=0; k < n_made; k++) poolFree(&catalog->userPools.history, made[k]);
+		for(int k=0; k < n_inner; k++) if(inner[k] != NULL) poolFree(&catalog->userPools.history, inner[k]);
+		free(nodes);
+		free(scores);
+		return 0;
+	}
+
+	// Nothing can fail from here on. Readers see either the old tree or the complete new one, and both share the leaves
+	for(int k=0; k < n; k++)
+	{
+		if(leaves[k]->Info->sumScore != scores[k]) leaves[k]->Info->sumScore = scores[k];
+	}
+	userMovie_t *history = historyLinkLeaves(leaves, inner, 0, n);
+	history->parent = NULL;
+	EPOCH_PUBLISH(user->history, history);
+	postOrderRetireHistory(root);
+	free(nodes);
+	free(scores);
+	return 1;
+}
+
+
+/**
+ * @brief Applies a bulk of ratings, leaving the catalog and the histories as the W events of them would one after
+ * the other, and storing in each what watch_movie() would have returned for it. The ratings are sorted by
+ * (category, movieID) and each category is updated in one merged walk, then sorted by (userID, movieID)
+ * and each history is rebuilt in one pass. Nothing is printed but what userLocate() reports of missing users
+ *
+ * @param instance The catalog the event goes to
+ * @param events The ratings, whose results are stored in them
+ * @param n The number of ratings
+ *
+ * @return 1 on success
+ *         0 on malloc failure, before any rating is applied
+ */
+
+ int watch_bulk(catalog_t *instance, watchEvent_t *events, int n){
+	catalogUse(instance);
+
+	watchOrder_t *order = (watchOrder_t*)malloc(((size_t)n + 1) * sizeof(watchOrder_t));
+	if(order == NULL) return 0;
+
+	// The ratings left at 1 are still pending. Checks fail in the order watch_movie() makes them
+	for(int i=0; i < n; i++) events[i].result = events[i].score < 1 || events[i].score > 10 ? -3 : 1;
+
+	// Users first: a rating of a user who isn't registered edits no movie
+	int count = watchOrderBuild(order, events, n, 1);
+	for(int lo=0, hi; lo < count; lo = hi)
+	{
+		for(hi = lo + 1; hi < count && order[hi].key == order[lo].key; hi++);
+		userSlot_t slot;
+		if(userLocate(order[lo].key, &slot) != NULL) userTableUnlock(&catalog->userTable, slot.stripe);
+		else
+		{
+			for(int i=lo; i < hi; i++) events[order[i].index].result = 0;
+		}
+	}
+
+	// Then the movies, one sweep per category
+	int changed = 0;
+	count = watchOrderBuild(order, events, n, 0);
+	for(int lo=0, hi; lo < count; lo = hi)
+	{
+		int category = order[lo].key;
+		for(hi = lo + 1; hi < count && order[hi].key == category; hi++);
+		if(category < 0 || category >= 6 || catalog->categoryArray[category] == NULL)
+		{
+			for(int i=lo; i < hi; i++) events[order[i].index].result = -1;
+			continue;
+		}
+		if(categoryMergeRatings(category, order, lo, hi, events)) changed = 1;
+	}
+	if(changed) queryCacheTouchCatalog(&catalog->queryCache);
+
+	// Then the histories, one pass per user
+	count = watchOrderBuild(order, events, n, 1);
+	for(int lo=0, hi; lo < count; lo = hi)
+	{
+		for(hi = lo + 1; hi < count && order[hi].key == order[lo].key; hi++);
+		userSlot_t slot;
+		user_t *user = userTableLocate(&catalog->userTable, order[lo].key, &slot, 0);
+		if(user == NULL || !historyMergeRatings(user, order, lo, hi, events))
+		{
+			for(int i=lo; i < hi; i++) events[order[i].index].result = -2;
+		}
+		else __atomic_store_n(&user->version, queryCacheNextVersion(&catalog->queryCache), __ATOMIC_RELEASE);
+		userTableUnlock(&catalog->userTable, slot.stripe);
 	}
-	else return 0;
+
+	free(order);
+	return 1;
  }
  
- /**
- * @brief Prints the movies in movies categories array.
+/**
+ * @brief Identify the best rating score movie and cluster all the movies of a category.
+ *
+ * @param instance The catalog the event goes to
+ * @param userID The identifier of the user
+ * @param score The minimum score of a movie
+ *
  * @return 1 on success
  *         0 on failure
  */
 
- int print_movies(void){
-	printf("M\n");
-	printf("Movie Category Array:\n");
-	for(int i=0; i<6; i++)
+ int filter_movies(catalog_t *instance, int userID, float score){
+	catalogUse(instance);
+
+	return filter_movies_in(instance, userID, score, ALL_CATEGORIES, INT_MIN, INT_MAX, 0);
+ }
+ 
+/**
+ * @brief Heapifies movieHelperArray with size d from index i
+ * @return returns void
+*/
+static void heapify(movieInfo_t **helperMovieArray, int d, int i)
+{
+    // Given the specific parent index extract the associated children indices
+    int largest_parent = i;
+    int left_child = 2*i + 1;
+    int right_child = 2*i + 2;
+	int score_left, score_right;
+    if (left_child < d) score_left = (float)helperMovieArray[left_child]->sumScore / (float)helperMovieArray[left_child]->watchedCounter;
+    if(right_child < d) score_right = (float)helperMovieArray[right_child]->sumScore / (float)helperMovieArray[right_child]->watchedCounter;
+	int score_largest_parent = (float)helperMovieArray[largest_parent]->sumScore / (float)helperMovieArray[largest_parent]->watchedCounter;
+	
+    // If the left child index is not out of array boundaries and the associated left child score is larger than the parent score make it largest
+    if(left_child < d && score_left > score_largest_parent)
+    {
+        largest_parent = left_child;
+		score_largest_parent = score_left;
+    }
+
+    // If the left child index is not out of array boundaries and the associated left child  is larger than the previous largest
+    // score make it largest
+    if(right_child < d && score_right > score_largest_parent)
+    {
+        largest_parent = right_child;
+		score_largest_parent = score_right;
+    }
+
+    if(largest_parent != i) // If any swapping occured, recursively perfrom heapifications begining from the swapped child index
+    {
+        movieInfo_t *temp = helperMovieArray[i];
+        helperMovieArray[i] = helperMovieArray[largest_parent];
+        helperMovieArray[largest_parent] = temp;
+
+        // Recursive heapification call
+        heapify(helperMovieArray, d, largest_parent);
+    }
+}
+
+
+/**
+ * @brief heapSorts a given movie_t pointer Array based on their scores
+ * @return returns void
+*/
+static void heapSort(movieInfo_t **helperMovieArray, int d)
+{
+    // Begin by heapifying the entire array
+    for(int i = d/2 -1; i >= 0; i--)
+    {
+        heapify(helperMovieArray, d, i);
+    }
+
+    // Then the associated tree Root gets swapped with the last array score and heapification is repeated for the reduced heap
+     for(int i = d-1; i>0; i--)
+     {
+        movieInfo_t *temp = helperMovieArray[0];
+        helperMovieArray[0] = helperMovieArray[i];
+        helperMovieArray[i] = temp;
+
+        // Reheapification of reduced heap 
+        heapify(helperMovieArray, i, 0);
+     }
+}
+
+/**
+ * @brief Prints the line of an F or X event, with the arguments that were given
+ * @return returns void
+*/
+static void filterPrintEvent(int unwatched, int userID, float score, int categories, int fromYear, int toYear)
+{
+	printf("%c %d %f", unwatched ? 'X' : 'F', userID, score);
+	if(categories != ALL_CATEGORIES) printf(" %d", categories);
+	if(fromYear != INT_MIN || toYear != INT_MAX) printf(" %d %d", fromYear, toYear);
+	printf("\n");
+}
+
+/**
+ * @brief Like filter_movies(), only for the movies of some categories released from fromYear to toYear.
+ *
+ * @param instance The catalog the event goes to
+ * @param userID The identifier of the user
+ * @param score The minimum score of a movie
+ * @param categories Bitmask of the categories to search, bit i for category i
+ * @param fromYear The first year of release
+ * @param toYear The last year of release
+ * @param unwatched Set to leave out the movies the user has watched
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int filter_movies_in(catalog_t *instance, int userID, float score, int categories, int fromYear, int toYear, int unwatched){
+	catalogUse(instance);
+
+	// Return -1 if the bitmask selects no category or one that doesn't exist
+	if(categories <= 0 || (categories & ~ALL_CATEGORIES) != 0) return -1;
+
+	// A repeat of the query since the last change of the catalog prints the cached output.
+	// Results that leave out a history depend on the user too, and are not cached
+	uint64_t stamp = queryCacheCatalog(&catalog->queryCache);
+	if(!unwatched)
 	{
-		switch (i)
+		char *cached = queryCacheFilterGet(&catalog->queryCache, score, categories, fromYear, toYear);
+		if(cached != NULL)
 		{
-			case 0:
-				printf("   HORROR: ");
-				break;
-			case 1:
-				printf("   SCIENCE-FICTION:");
-				break;
-			case 2:
-				printf("   DRAMA: ");
-				break;
-			case 3:
-				printf("   ROMANCE: ");
-				break;
-			case 4:
-				printf("   DOCUMENTARY: ");
-				break;
-			case 5:
-				printf("   COMEDY: ");
-				break;
+			filterPrintEvent(unwatched, userID, score, categories, fromYear, toYear);
+			fputs(cached, stdout);
+			free(cached);
+			return 1;
 		}
+	}
 
-		if(categoryArray[i] != NULL) inOrderMoviePrint(categoryArray[i]->movie);
-		printf("\n");
+	// The history is copied out sorted once, and every category merges its candidates against it
+	watchedSet_t watchedSet = {NULL, 0, 0};
+	watchedSet_t *watched = NULL;
+	if(unwatched)
+	{
+		epochEnter(&catalog->epoch);
+		user_t *user;
+		if(!userFind(userID, &user))
+		{
+			epochExit(&catalog->epoch);
+			return -1;
+		}
+		int built = watchedSetBuild(&watchedSet, user);
+		epochExit(&catalog->epoch);
+		if(!built) return 0;
+		watched = &watchedSet;
 	}
-	printf("DONE\n\n");
+
+	movieInfo_t **helperMovieArray;
+	movie_t *roots[6];
+	catalogVersion_t *version = catalogReadBegin(roots);
+
+	// The year indexes hold every movie a reader can find, so their counts bound the matches without a traversal
+	int n_movies = 0, n_candidates = 0;
+	for(int categ = 0; categ < 6; categ++)
+	{
+		yearIndex_t *years = &catalog->categoryArray[categ]->years;
+		if(!(categories & (1 << categ))) continue;
+		yearIndexLock(years);
+		n_movies += yearIndexSize(years);
+		n_candidates += yearIndexCount(years, fromYear, toYear);
+		yearIndexUnlock(years);
+	}
+	if(n_movies == 0)
+	{
+		catalogReadEnd(version);
+		watchedSetFree(&watchedSet);
+		printf("Movie Category Array is empty");
+		return 0;
+	}
+	if(n_candidates == 0) n_candidates = 1;
+
+	// Allocate memory for helperMovieArray
+	helperMovieArray = (movieInfo_t**)malloc(n_candidates * sizeof(movieInfo_t*));
+	if(!helperMovieArray) // Return 0 upon failure to allocate helperMovieArray
+	{
+		catalogReadEnd(version);
+		watchedSetFree(&watchedSet);
+		return 0;
+	}
+
+	// Movies distributed after counting are simply not reported, so the array can't overflow
+	int max_index = 0;
+	for(int categ = 0; categ < 6; categ++)
+	{
+		if(!(categories & (1 << categ))) continue;
+		if(roots[categ] != NULL && !categoryAddInYears(categ, roots[categ], score, fromYear, toYear, watched, helperMovieArray, &max_index, n_candidates))
+		{
+			catalogReadEnd(version);
+			free(helperMovieArray);
+			watchedSetFree(&watchedSet);
+			return 0;
+		}
+	}
+	watchedSetFree(&watchedSet);
+
+	// Having filled the helperMovieArray in up until the max_index, sort it using HeapSort
+	heapSort(helperMovieArray, max_index);
+
+	// Format the output once, so that a repeat of the query can print it from the cache
+	char *text = NULL;
+	size_t size = 0;
+	FILE *out = open_memstream(&text, &size);
+	if(out == NULL)
+	{
+		catalogReadEnd(version);
+		free(helperMovieArray);
+		return 0;
+	}
+	fprintf(out, "   ");
+	if(max_index == 0) fprintf(out, "  EMPTY\nDONE\n\n");
+	else
+	{
+		float mvScore;
+		int mvID;
+		for(int i=0; i < max_index; i++)
+		{
+			mvScore = (float)helperMovieArray[i]->sumScore / (float)helperMovieArray[i]->watchedCounter;
+			mvID = helperMovieArray[i]->movieID;
+			fprintf(out, "{%d %f}, ", mvID, mvScore);
+		}
+		fprintf(out, "\nDONE\n\n");
+	}
+	catalogReadEnd(version);
+	free(helperMovieArray);
+	if(fclose(out) != 0)
+	{
+		free(text);
+		return 0;
+	}
+
+	// Print Statements
+	filterPrintEvent(unwatched, userID, score, categories, fromYear, toYear);
+	fputs(text, stdout);
+	if(unwatched) free(text);
+	else queryCacheFilterPut(&catalog->queryCache, score, categories, fromYear, toYear, stamp, text);
 
 	return 1;
  }
  
-  /**
- * @brief Prints the users hashtable.
+/**
+ * @brief Find movies from categories withn median_score >= score t
+ *
+ * @param instance The catalog the event goes to
+ * @param userID The identifier of the user
+ * @param category Array with the categories to search.
+ * @param score The minimum score the movies we want to have
+ *
  * @return 1 on success
  *         0 on failure
  */
 
- int print_users(void){
+ int user_stats(catalog_t *instance, int userID){
+	catalogUse(instance);
 
-	printf("P\n");
-	for(int key=0; key < m; key++)
+	// Return 0 if userId > max_id
+	if(userID > catalog->max_id)
+	{
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
+		return 0;
+	} 
+
+	//Check if the User Already Exists
+	epochEnter(&catalog->epoch);
+	user_t *user;
+	if(!userFind(userID, &user))
+	{
+		epochExit(&catalog->epoch);
+		return -1;
+	}
+
+	// A repeat of the query since the last W of the user prints the cached output
+	uint64_t userVersion = __atomic_load_n(&user->version, __ATOMIC_ACQUIRE);
+	char *cached = queryCacheStatsGet(&catalog->queryCache, userID, userVersion);
+	if(cached != NULL)
+	{
+		epochExit(&catalog->epoch);
+		fputs(cached, stdout);
+		free(cached);
+		return 1;
+	}
+
+	int scoreSum = 0, counter = 0;
+	userMovie_t *history = EPOCH_READ(user->history);
+	if(history != NULL) inOrderFindStats(history, &scoreSum, &counter);
+	else for(int i=0; i < user->n_snapshot; i++) // History still in the loaded snapshot
+	{
+		scoreSum += user->snapshot[i].sumScore;
+		counter++;
+	}
+	epochExit(&catalog->epoch);
+	if(counter == 0)
+	{
+		printf("User with UserID: %d has not watched any movies\n", userID);
+		return -2;
+	}
+
+	float m_score = (float)scoreSum / (float)counter;
+	char *text = NULL;
+	size_t size = 0;
+	FILE *out = open_memstream(&text, &size);
+	if(out == NULL) return 0;
+	fprintf(out, "Q %d %f\nDONE\n\n", userID, m_score);
+	if(fclose(out) != 0)
+	{
+		free(text);
+		return 0;
+	}
+	fputs(text, stdout);
+	queryCacheStatsPut(&catalog->queryCache, userID, userVersion, text);
+	return 1;
+ }
+ 
+/**
+ * @brief Search for a movie with identification movieID in a specific category.
+ *
+ * @param instance The catalog the event goes to
+ * @param movieID The identifier of the movie
+ * @param category The category of the movie
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int search_movie(catalog_t *instance, int movieID, int category){
+	catalogUse(instance);
+
+	// Assert that the passed in category is within the limits
+	if(category >= 6 || category < 0) return -1;  // Return -1 for invalid category input argument
+
+	// Check if associated Tree is empty or NULL
+	if(catalog->categoryArray[category] == NULL) return 0;
+
+	// The movie map answers for the movieIDs it knows, and holds the record of the movie unless versions have their own
+	movieInfo_t *info;
+	int where = movieMapFind(movieID, &info, NULL);
+	if(where != MOVIE_MAP_UNKNOWN && where != category) return 0;
+	if(where == MOVIE_MAP_UNKNOWN && !movieMayExist(movieID)) return 0;
+	if(where == MOVIE_MAP_UNKNOWN) info = movieHotFind(movieID, category, NULL);
+	int year = 0;
+	if(info != NULL) year = info->year;
+	else
+	{
+		movie_t *roots[6];
+		catalogVersion_t *version = catalogReadBegin(roots);
+#ifndef CATEGORY_INDEX
+		if(roots[category]->Info->movieID == -1)
+		{
+			catalogReadEnd(version);
+			return 0;
+		}
+#endif
+
+		// Otherwise Traverse the Tree to find the movie
+		info = categoryFind(category, roots[category], movieID);
+		if(info != NULL)
+		{
+			year = info->year;
+			movieHotAdd(movieID, category, info, NULL);
+		}
+		catalogReadEnd(version);
+	}
+
+	if(info != NULL)
+	{
+		printf("I %d ", movieID);
+		// Print Genre according to int category
+		switch (category) {
+			case 0:
+				printf("HORROR");
+				break;
+			case 1:
+				printf("SCIENCE-FICTION");
+				break;
+			case 2:
+				printf("DRAMA");
+				break;
+			case 3:
+				printf("ROMANCE");
+				break;
+			case 4:
+				printf("DOCUMENTARY");
+				break;
+			case 5:
+				printf("COMEDY");
+				break;
+		}
+		printf(" %d\nDONE\n\n", year);
+		return 1;
+	}
+	return 0;
+ }
+ 
+ /**
+ * @brief Prints the movies in movies categories array.
+ * @param instance The catalog the event goes to
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int print_movies(catalog_t *instance){
+	catalogUse(instance);
+	printf("M\n");
+	printf("Movie Category Array:\n");
+	movie_t *roots[6];
+	catalogVersion_t *version = catalogReadBegin(roots);
+	for(int i=0; i<6; i++)
+	{
+		switch (i)
+		{
+			case 0:
+				printf("   HORROR: ");
+				break;
+			case 1:
+				printf("   SCIENCE-FICTION:");
+				break;
+			case 2:
+				printf("   DRAMA: ");
+				break;
+			case 3:
+				printf("   ROMANCE: ");
+				break;
+			case 4:
+				printf("   DOCUMENTARY: ");
+				break;
+			case 5:
+				printf("   COMEDY: ");
+				break;
+		}
+
+		if(roots[i] != NULL) categoryPrint(i, roots[i]);
+		printf("\n");
+	}
+	catalogReadEnd(version);
+	printf("DONE\n\n");
+
+	return 1;
+ }
+ 
+  /**
+ * @brief Prints the users hashtable.
+ * @param instance The catalog the event goes to
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int print_users(catalog_t *instance){
+	catalogUse(instance);
+
+	printf("P\n");
+	epochEnter(&catalog->epoch);
+	userChains_t *chains = userTableChains(&catalog->userTable);
+	for(int key=0; key < chains->size; key++)
+	{
+		printf("Chain %d of Users:\n", key);
+		if(chains->chains[key] != NULL)
+		{
+			for(user_t *user = EPOCH_READ(chains->chains[key]); user != NULL; user = EPOCH_READ(user->next))
+			{
+				printf("   %d\n   History Tree:\n", user->userID);
+				userMovie_t *history = EPOCH_READ(user->history);
+				if(history != NULL) InOrderPrintUserMoviesEd2(history);
+				else for(int i=0; i < user->n_snapshot; i++) printf("      %d %d\n", user->snapshot[i].movieID, user->snapshot[i].sumScore);
+			}
+		}
+	}
+	epochExit(&catalog->epoch);
+	printf("DONE\n\n");
+	return 1;
+ }
+ 
+ /**
+ * @brief Prints the hits and misses of the F and Q result cache.
+ * @param instance The catalog the event goes to
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int cache_stats(catalog_t *instance){
+	catalogUse(instance);
+
+	printf("S\n");
+	queryCachePrint(&catalog->queryCache);
+#ifdef MOVIE_HOT_CACHE
+	hotCachePrint(&catalog->movieHotCache);
+#endif
+	printf("DONE\n\n");
+	return 1;
+ }
+ 
+ /**
+ * @brief Prints the movies of a category released from fromYear to toYear, by ascending year.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param fromYear The first year to print
+ * @param toYear The last year to print
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int year_movies(catalog_t *instance, int category, int fromYear, int toYear){
+	catalogUse(instance);
+
+	// Assert that the passed in category is within the limits
+	if(category >= 6 || category < 0) return -1;  // Return -1 for invalid category input argument
+
+	yearIndex_t *years = &catalog->categoryArray[category]->years;
+	yearIter_t iter;
+	yearNode_t *node;
+	printf("Y %s %d %d\n   ", categoryName(category), fromYear, toYear);
+	yearIndexLock(years);
+	yearIndexSeek(years, &iter, fromYear);
+	while((node = yearIndexNext(&iter)) != NULL && node->year <= toYear)
+	{
+		printf("{%d %d}, ", node->movieID, node->year);
+	}
+	yearIndexUnlock(years);
+	printf("\nDONE\n\n");
+	return 1;
+ }
+ 
+ /**
+ * @brief Counts the movies of a category released from fromYear to toYear, in buckets of width years.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param fromYear The first year to count
+ * @param toYear The last year to count
+ * @param width The number of years of every bucket, 0 for a single bucket
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int count_movies_by_year(catalog_t *instance, int category, int fromYear, int toYear, int width){
+	catalogUse(instance);
+
+	// Assert that the passed in category is within the limits
+	if(category >= 6 || category < 0) return -1;  // Return -1 for invalid category input argument
+	if(fromYear > toYear) return 0;
+	long long span = (long long)toYear - fromYear + 1;
+	if(width <= 0 || width > span) width = (int)(span > INT_MAX ? INT_MAX : span);
+
+	// Each bucket is two rank lookups, whatever the number of movies in it
+	yearIndex_t *years = &catalog->categoryArray[category]->years;
+	printf("K %s %d %d %d\n   ", categoryName(category), fromYear, toYear, width);
+	yearIndexLock(years);
+	for(long long first = fromYear; first <= toYear; first += width)
+	{
+		long long last = first + width - 1;
+		if(last > toYear) last = toYear;
+		printf("%lld-%lld: %d, ", first, last, yearIndexCount(years, (int)first, (int)last));
+	}
+	yearIndexUnlock(years);
+	printf("\nDONE\n\n");
+	return 1;
+ }
+ 
+ /**
+ * @brief Prints the movies of a category whose movieID lies in [lo, hi], in ascending order.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param lo The smallest movieID to print
+ * @param hi The largest movieID to print
+ * @param limit The maximum number of movies to print, 0 for no limit
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
+
+ int range_movies(catalog_t *instance, int category, int lo, int hi, int limit){
+	catalogUse(instance);
+
+	// Assert that the passed in category is within the limits
+	if(category >= 6 || category < 0) return -1;  // Return -1 for invalid category input argument
+
+	// Descend straight to lo. Only the path to it and the movies printed are visited
+	movie_t *roots[6];
+	catalogVersion_t *version = catalogReadBegin(roots);
+	categoryIter_t iter;
+	if(!categoryIterSeek(&iter, category, roots[category], lo))
+	{
+		catalogReadEnd(version);
+		return 0;
+	}
+
+	printf("N %s %d %d %d\n   ", categoryName(category), lo, hi, limit);
+	int printed = 0;
+	movieInfo_t *info;
+	while((limit <= 0 || printed < limit) && (info = categoryIterNext(&iter)) != NULL && info->movieID <= hi)
+	{
+		printf("%d, ", info->movieID);
+		printed++;
+	}
+	int failed = iter.failed;
+	categoryIterEnd(&iter);
+	catalogReadEnd(version);
+	printf("\nDONE\n\n");
+
+	return !failed;
+ }
+ 
+
+/* Extra functions */
+
+/**
+ * @brief Implements the universal hash function given all parameters
+ * @return int: the key
+*/
+int hash_function(int a, int b, int x, int m, int p)
+{
+	 int k = (int)((((long long)a*x + b) % p) % m);
+	 return k;
+}
+
+
+/**
+ * @brief Makes a new user of userID
+ * @return user_t*: a pointer to the new user struct
+*/
+user_t* makeNewUser(int userID)
+{
+	user_t *newUser = (user_t*)poolAlloc(&catalog->userPools.users);
+	if(newUser == NULL) return NULL;
+	newUser->userID = userID;
+	newUser->history = NULL;
+	newUser->next = NULL;
+	newUser->snapshot = NULL;
+	newUser->n_snapshot = 0;
+	newUser->version = queryCacheNextVersion(&catalog->queryCache);
+	return newUser;
+}
+
+
+/**
+ * @brief Frees a user record made by makeNewUser(), but not its history
+ * @return void
+*/
+void freeUser(user_t *user)
+{
+	poolFree(&catalog->userPools.users, user);
+}
+
+
+/**
+ * @brief Maps the user pools for maxUsers users, once max_users is known. Later calls keep the first pools
+ * @return 1 on Success 0 if the pools can't be mapped, in which case users are malloc'd
+*/
+int reserveUsers(int maxUsers)
+{
+	if(catalog->userPools.region.base != NULL) return 1;
+	if(maxUsers <= 0) return 0;
+
+	// Objects handed out before this call came from malloc(), the new pools tell them apart by address
+	size_t users = 2 * (size_t)maxUsers;
+	size_t history = USER_POOL_HISTORY * (size_t)maxUsers;
+	if(!poolRegionMap(&catalog->userPools.region, poolLength(sizeof(user_t), users) + poolLength(sizeof(userMovieRecord_t), history))) return 0;
+	poolInit(&catalog->userPools.users, &catalog->userPools.region, sizeof(user_t), users);
+	poolInit(&catalog->userPools.history, &catalog->userPools.region, sizeof(userMovieRecord_t), history);
+	return 1;
+}
+
+
+/**
+ * @brief Initializes Hash Table with null Pointers
+ * @return 1 on Success 0 on malloc failure
+*/
+int makeHashTable()
+{
+	// Until max_users is known the pools have nothing reserved and hand out malloc'd objects
+	poolInit(&catalog->userPools.users, NULL, sizeof(user_t), 0);
+	poolInit(&catalog->userPools.history, NULL, sizeof(userMovieRecord_t), 0);
+	return userTableInit(&catalog->userTable, catalog->hashtable_size, &catalog->epoch);
+}
+
+
+/**
+ * @brief Initializes Hash Table with null Pointers
+ * @return void
+*/
+void initHashTable()
+{
+	for(int i=0; i < catalog->userTable.current->size; i++) catalog->userTable.current->chains[i] = NULL;
+	return;
+}
+
+
+/**
+ * @brief Deletes Hash Table
+ * @return void
+*/
+void deleteHashTable()
+{
+	deleteUserTable(&catalog->userTable);
+	return;
+}
+
+
+/**
+ * @brief Deletes Hash Table cell chain
+ * @return void
+*/
+void deleteUserChainIter(user_t *user)
+{
+	while(user != NULL)
+	{
+		user_t *next = user->next;
+		if(user->history != NULL)
+		{
+			freeUserHistoryTree(user->history);
+			user->history = NULL;
+		}
+		freeUser(user);
+		user = next;
+	}
+}
+
+
+/**
+ * @brief Checks if a given User exists
+ * @return returns 1 if True, 0 if False
+*/
+int existsUser(int userID)
+{
+	// Return 0 if userId > max_id
+	if(userID > catalog->max_id)
+	{
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
+		return 0;
+	} 
+
+	// Iterate through the chain untill you either reach NULL or user with identical userID
+	epochEnter(&catalog->epoch);
+	user_t *user = userTableFind(&catalog->userTable, userID);
+	epochExit(&catalog->epoch);
+
+	// Return True or False Accordingly
+	if(user == NULL) return 0;
+	return 1;
+}
+
+
+
+/**
+ * @brief Initialize newMoviesTree with NULL root
+ * @return returns void
+*/
+void initNewMoviesTree()
+{
+	catalog->newMoviesTree.root = NULL;
+}
+
+
+/**
+ * @brief Create New Movie for NewMovies Tree
+ * @return returns newMovie_t struct pointer
+*/
+newMovie_t* makeNewMovie(int movieID, int category, int year)
+{
+	// Allocate newMovie memory
+	newMovie_t *newMovie = (newMovie_t *)malloc(sizeof(newMovie_t));
+	if(!newMovie) return NULL; // Return NULL upon failure
+
+	// Fill in parameters
+	newMovie->category = category;
+	newMovie->Info = (movieInfo_t *)malloc(sizeof(movieInfo_t));
+	if(!newMovie->Info) return NULL;
+	newMovie->Info->movieID = movieID;
+	newMovie->Info->year = year;
+	newMovie->Info->sumScore = 0;
+	newMovie->Info->watchedCounter = 0;
+	newMovie->lc = NULL;
+	newMovie->rc = NULL;
+	return newMovie;
+}
+
+
+
+/**
+ * @brief Checks whether the given movie exists or not (using the MovieID)
+ * @return returns 1 if True, 0 otherwise
+*/
+int existsNewMovie(int movieID)
+{
+	return newMovieFind(EPOCH_READ(catalog->newMoviesTree.root), movieID) != NULL;
+}
+
+
+/**
+ * @brief InOrder Traversal of newMovieTree that prints the movieIDs
+ * @return returns 1 if Movie is found, 0 otherwise
+*/
+void InOrderPrintNewMovieTree(newMovie_t *newMovieNode)
+{
+	treeWalk_t walk;
+	newMovieWalkBegin(&walk, TREE_WALK_IN, newMovieNode);
+	for(newMovie_t *node; (node = treeWalkNext(&walk)) != NULL; ) printf(" %d,", node->Info->movieID);
+	treeWalkEnd(&walk);
+}
+
+
+
+/**
+ * @brief delete the newMoviesTree
+ * @return returns void
+*/
+void deleteNewMoviesTree()
+{
+	if(catalog->newMoviesTree.root == NULL) return;
+	deleteNewMoviesTreeIter(catalog->newMoviesTree.root);
+	catalog->newMoviesTree.root = NULL;
+}
+
+
+/**
+ * @brief delete the newMoviesTree recursive PostOrder function
+ * @return returns void
+*/
+void deleteNewMoviesTreeIter(newMovie_t *newMovieNode)
+{
+	treeWalk_t walk;
+	newMovieWalkBegin(&walk, TREE_WALK_POST, newMovieNode);
+	for(newMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(node->Info != NULL)
+		{
+			free(node->Info);
+			node->Info = NULL;
+		}
+		free(node);
+	}
+	treeWalkEnd(&walk);
+}
+
+
+
+/**
+ * @brief Initializes the movie Category Array with sentinel nodes
+ * @return returns void
+*/
+int initMovieCategoryArray()
+{
+	movie_t *sent = makeMovie(-1, 0);
+	if(sent == NULL)
+	{
+		printf("Failure upon movie_t object memory allocation\n");
+		return 0;
+	}
+
+	// The categories hold the sentinel before anything else can fail, so that deleteMovieCategoryArray() frees whatever was made
+	for(int  i=0; i<6; i++)
+	{
+		catalog->categoryArray[i] = (movieCategoryArray_t*)calloc(1, sizeof(movieCategoryArray_t));
+		if(catalog->categoryArray[i] == NULL)
+		{
+			if(i == 0)
+			{
+				free(sent->Info);
+				free(sent);
+			}
+			printf("Failure upon movieCategory_t object memory allocation\n");
+			return 0;
+		}
+		catalog->categoryArray[i]->sentinel = sent;
+		catalog->categoryArray[i]->movie = sent;
+	}
+	catalog->movieFilter = makeBloom(MOVIE_FILTER_CAPACITY);
+	if(catalog->movieFilter == NULL)
+	{
+		printf("Failure upon movie filter memory allocation\n");
+		return 0;
+	}
+	catalog->movieMap = makeMovieMap(MOVIE_MAP_SIZE < MOVIE_MAP_MAX ? MOVIE_MAP_SIZE : MOVIE_MAP_MAX);
+#ifdef MOVIE_HOT_CACHE
+	if(!hotCacheInit(&catalog->movieHotCache))
+	{
+		printf("Failure upon hot movie cache initialization\n");
+		return 0;
+	}
+#endif
+	if(catalog->movieMap == NULL)
+	{
+		printf("Failure upon movie map memory allocation\n");
+		return 0;
+	}
+
+	for(int  i=0; i<6; i++)
+	{
+		if(!yearIndexInit(&catalog->categoryArray[i]->years))
+		{
+			printf("Failure upon year index initialization\n");
+			return 0;
+		}
+#ifdef CATEGORY_SKIPLIST
+		catalog->categoryArray[i]->index = makeSkipList();
+		if(catalog->categoryArray[i]->index == NULL)
+		{
+			printf("Failure upon skip list memory allocation\n");
+			return 0;
+		}
+#elif defined(CATEGORY_BPTREE)
+		catalog->categoryArray[i]->index = makeBpTree();
+		if(catalog->categoryArray[i]->index == NULL)
+		{
+			printf("Failure upon B+ tree memory allocation\n");
+			return 0;
+		}
+#endif
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Makes a regular movie_t struct object
+ * @return returns 1 upon success, 0 upon malloc failure
+*/
+movie_t* makeMovie(int movieID, int year)
+{
+	movie_t *movie = (movie_t*)malloc(sizeof(movie_t));
+	if(movie == NULL) return NULL;
+	movieInfo_t *m_info = (movieInfo_t*)malloc(sizeof(movieInfo_t));
+	if(m_info == NULL)
+	{
+		free(movie);
+		return NULL;
+	}
+	movie->Info = m_info;
+	movie->Info->movieID = movieID;
+	movie->Info->sumScore = 0;
+	movie->Info->watchedCounter = 0;
+	movie->Info->year = year;
+	movie->lc = NULL;
+	movie->rc = NULL;
+	movie->maxScore = MOVIE_NO_SCORE;
+#ifdef CATEGORY_PARENTS
+	movie->parent = NULL;
+#endif
+#ifdef CATALOG_VERSIONS
+	movie->version = catalog->versions.draft;
+#endif
+
+	return movie;
+}
+
+
+/**
+ * @brief Performs inOrder newMovieTree traversal and for each node it visits it calls the function distsributeMovie()
+ * that is responsible for creating and placing the corresponding movie in the appropriate BST of the movieCategoryArray
+ * @note: IF A MOVIE TRANSFER FAILS WE HAVE TO STOP THE PROCESS. OTHERWISE WE MIGHT END UP WITH A CORRUPTED TREE 
+ * @return returns void
+*/
+int postOrderDistribute(newMovie_t *newMovie)
+{
+	if(newMovie == NULL) return 1;
+
+	treeWalk_t walk;
+	int distributed = 0;
+	newMovieWalkBegin(&walk, TREE_WALK_POST, newMovie);
+	for(newMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		// A movie is only distributed once both its subtrees were, which dropped the links to them
+		if(node->lc != NULL || node->rc != NULL) continue;
+		if(!DistributeMovie(node))
+		{
+			printf("Movie Distributing Process has stopped at the node with MovieID: %d\n", node->Info->movieID);
+			continue;
+		}
+
+		// A fully distributed subtree has already been retired, so drop the link to it. The walk never reads it again
+		newMovie_t *parent = treeWalkParent(&walk);
+		if(parent == NULL) distributed = 1;
+		else if(parent->lc == node) parent->lc = NULL;
+		else parent->rc = NULL;
+		epochRetire(&catalog->epoch, node, reclaimNewMovie);
+	}
+	return treeWalkEnd(&walk) && distributed;
+}
+
+
+
+/**
+ * @brief Distributes the given movie to the appropriate place and tree of the movieCategoryArray
+ * @return returns 1 upon success, 0 upon failure
+*/
+int DistributeMovie(newMovie_t *newMovie)
+{
+	int category = newMovie->category;
+	int movieID = newMovie->Info->movieID;
+	int year = newMovie->Info->year;
+
+	// Index the year first, so that the year index covers every movie of the category at all times.
+	// Should linking the movie fail, it stays indexed until a later D distributes it again
+	if(!yearIndexInsert(&catalog->categoryArray[category]->years, year, movieID)) return 0;
+#ifdef CATEGORY_INDEX
+	// The index links its own nodes to a fresh copy of the info
+	movieInfo_t *Info = (movieInfo_t*)malloc(sizeof(movieInfo_t));
+	if(!Info) return 0;
+	Info->movieID = movieID;
+	Info->year = year;
+	Info->watchedCounter = 0;
+	Info->sumScore = 0;
+#ifdef CATEGORY_SKIPLIST
+	if(!skipListInsert(catalog->categoryArray[category]->index, Info))
+#else
+	if(!bpTreeInsert(catalog->categoryArray[category]->index, Info))
+#endif
+	{
+		free(Info);
+		return 0;
+	}
+	movieMapDistribute(movieID, category, Info, NULL);
+	return 1;
+#else
+	movie_t *temp = makeMovie(movieID, year);
+	if(!temp) return 0;
+	movie_t *root = catalog->categoryArray[category]->movie;
+	movie_t *sentinel = catalog->categoryArray[category]->sentinel;
+
+	// the BST for this category is empty. Create movie_t node and assign it to BST root
+	if(root == sentinel)
+	{
+		temp->lc = sentinel;
+		temp->rc = sentinel;
+		EPOCH_PUBLISH(catalog->categoryArray[category]->movie, temp);
+		movieMapDistribute(movieID, category, temp->Info, temp);
+		return 1;
+	}
+
+	// Otherwise traverse the Tree until you hit a sentinel
+	movie_t *prev = root;
+#ifdef CATALOG_VERSIONS
+	// Copy the path so that the published versions keep seeing the tree without the new movie
+	prev = versionDraftPath(&catalog->versions, category, movieID, 0);
+	if(prev == NULL)
+	{
+		free(temp->Info);
+		free(temp);
+		return 0;
+	}
+#else
+	prev = movieParent(root, movieID);
+#endif
+
+	// Having traversed the tree we place the new Node. Its children are set before it becomes visible to readers
+	temp->lc = sentinel;
+	temp->rc = sentinel;
+#ifdef CATEGORY_PARENTS
+	temp->parent = prev;
+#endif
+	movieLink(prev, temp);
+	movieMapDistribute(movieID, category, temp->Info, temp);
+	return 1;
+#endif
+
+}
+
+
+/**
+ * @brief Checks if the movie already exists in the movie category array trees (Assuming movieID-category pair is correct)
+ * @return returns 1 if True, 0 if False
+*/
+int newMovieExistsInCategoryArray(int movieID, int category)
+{
+#ifdef CATEGORY_SKIPLIST
+	return skipListFind(catalog->categoryArray[category]->index, movieID) != NULL;
+#elif defined(CATEGORY_BPTREE)
+	return bpTreeFind(catalog->categoryArray[category]->index, movieID) != NULL;
+#else
+	return movieFind(EPOCH_READ(catalog->categoryArray[category]->movie), movieID) != NULL;
+#endif
+}
+
+
+/**
+ * @brief Prints the BSTs of the movie category array Inorder
+ * @return returns void
+*/
+void inOrderMoviePrint(movie_t *movie)
+{
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(movie_t *node; (node = treeWalkNext(&walk)) != NULL; ) printf("%d, ", node->Info->movieID);
+	treeWalkEnd(&walk);
+}
+
+
+/**
+ * @brief destroy movieCategoryArray and Subtrees
+ * @return returns void
+*/
+void deleteMovieCategoryArray()
+{
+	for(int i=0; i<6; i++)
+	{
+		// If categoryArra[i] already freed or is empty skip for now
+		if(catalog->categoryArray[i] == NULL) continue;
+
+		// Otherwise
+		PostOrderMovieDelete(catalog->categoryArray[i]->movie);
+		catalog->categoryArray[i]->movie = NULL;
+#ifdef CATEGORY_SKIPLIST
+		deleteSkipList(catalog->categoryArray[i]->index);
+		catalog->categoryArray[i]->index = NULL;
+#elif defined(CATEGORY_BPTREE)
+		deleteBpTree(catalog->categoryArray[i]->index);
+		catalog->categoryArray[i]->index = NULL;
+#endif
+		deleteYearIndex(&catalog->categoryArray[i]->years);
+#ifdef CATEGORY_EYTZINGER
+		deleteEytzinger(catalog->categoryArray[i]->layout);
+		catalog->categoryArray[i]->layout = NULL;
+#endif
+	}
+	deleteBloom(catalog->movieFilter);
+	catalog->movieFilter = NULL;
+	free(catalog->movieMap);
+	catalog->movieMap = NULL;
+
+	// A catalog that failed to initialize may have no categories at all
+	if(catalog->categoryArray[0] != NULL && catalog->categoryArray[0]->sentinel != NULL)
+	{
+		if(catalog->categoryArray[0]->sentinel->Info != NULL)
+		{
+			free(catalog->categoryArray[0]->sentinel->Info);
+			catalog->categoryArray[0]->sentinel->Info = NULL;
+		}
+		free(catalog->categoryArray[0]->sentinel);
+	}
+	for(int i=0; i<6; i++)
+	{
+		if(catalog->categoryArray[i] != NULL)
+		{
+			free(catalog->categoryArray[i]);
+			catalog->categoryArray[i] = NULL;
+		}
+	} 
+}
+
+
+
+/**
+ * @brief Frees BST nodes using PostOrder Traversal
+ * @return returns void
+*/
+void PostOrderMovieDelete(movie_t *movie)
+{
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_POST, movie);
+	for(movie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(node->Info != NULL)
+		{
+			freeMovieInfo(node->Info);
+			node->Info = NULL;
+		}
+		free(node);
+	}
+	treeWalkEnd(&walk);
+}
+
+
+/**
+ * @brief Checks the movie filter for a movieID. Safe to call concurrently with A
+ * @return returns 0 if no movie has movieID, 1 if one may have
+*/
+int movieMayExist(int movieID)
+{
+	epochEnter(&catalog->epoch);
+	int mayExist = bloomMayContain(EPOCH_READ(catalog->movieFilter), movieID);
+	epochExit(&catalog->epoch);
+	return mayExist;
+}
+
+
+/**
+ * @brief Adds a movieID to the movie filter before the movie becomes reachable, growing the filter first if it is full
+ * @return returns void
+*/
+void movieFilterAdd(int movieID)
+{
+	// A filter that can't grow keeps answering correctly, only with more false positives
+	if(catalog->movieFilter->count >= catalog->movieFilter->capacity) movieFilterRebuild(2 * catalog->movieFilter->capacity);
+	bloomAdd(catalog->movieFilter, movieID);
+}
+
+
+#ifdef CATEGORY_EYTZINGER
+/**
+ * @brief Epoch reclaim function for a dropped layout
+ * @return returns void
+*/
+static void reclaimCategoryLayout(void *object)
+{
+	deleteEytzinger((eytzinger_t*)object);
+}
+
+
+/**
+ * @brief Lays the current tree of a category out in Eytzinger order and publishes the layout
+ * @return returns 1 on success, 0 on malloc failure (lookups keep walking the tree)
+*/
+int categoryLayoutBuild(int category)
+{
+	movie_t *root = catalog->categoryArray[category]->movie;
+	int n = categoryCount(category, root);
+	movieInfo_t **sorted = (movieInfo_t**)malloc(((size_t)n + 1) * sizeof(movieInfo_t*));
+	if(sorted == NULL) return 0;
+	categoryIter_t iter;
+	if(!categoryIterSeek(&iter, category, root, INT_MIN))
+	{
+		free(sorted);
+		return 0;
+	}
+	int j = 0;
+	movieInfo_t *info;
+	while(j < n && (info = categoryIterNext(&iter)) != NULL) sorted[j++] = info;
+	int failed = iter.failed;
+	categoryIterEnd(&iter);
+	eytzinger_t *layout = failed ? NULL : makeEytzinger(sorted, j);
+	free(sorted);
+	if(layout == NULL) return 0;
+
+	categoryLayoutDrop(category);
+	EPOCH_PUBLISH(catalog->categoryArray[category]->layout, layout);
+	return 1;
+}
+
+
+/**
+ * @brief Unpublishes the layout of a category before its tree changes
+ * @return returns void
+*/
+void categoryLayoutDrop(int category)
+{
+	eytzinger_t *layout = catalog->categoryArray[category]->layout;
+	if(layout == NULL) return;
+	EPOCH_PUBLISH(catalog->categoryArray[category]->layout, NULL);
+	epochRetire(&catalog->epoch, layout, reclaimCategoryLayout);
+}
+#endif
+
+
+/**
+ * @brief Adds the movieIDs of the newMoviesTree to a filter using PreOrder Traversal
+ * @return returns void
+*/
+static void preOrderFilterNewMovies(newMovie_t *newMovie, bloom_t *filter)
+{
+	treeWalk_t walk;
+	newMovieWalkBegin(&walk, TREE_WALK_PRE, newMovie);
+	for(newMovie_t *node; (node = treeWalkNext(&walk)) != NULL; ) bloomAdd(filter, node->Info->movieID);
+	treeWalkEnd(&walk);
+}
+
+
+/**
+ * @brief Epoch reclaim function for a replaced movie filter
+ * @return returns void
+*/
+static void reclaimMovieFilter(void *object)
+{
+	deleteBloom((bloom_t*)object);
+}
+
+
+/**
+ * @brief Replaces the movie filter with one sized for capacity movies, holding every new release and categorized movie
+ * @return returns 1 on success, 0 on malloc failure (the old filter stays)
+*/
+int movieFilterRebuild(int capacity)
+{
+	bloom_t *filter = makeBloom(capacity);
+	if(filter == NULL) return 0;
+	preOrderFilterNewMovies(catalog->newMoviesTree.root, filter);
+	for(int i=0; i<6; i++)
+	{
+		categoryIter_t iter;
+		movieInfo_t *info;
+		if(!categoryIterSeek(&iter, i, catalog->categoryArray[i]->movie, INT_MIN))
+		{
+			deleteBloom(filter);
+			return 0;
+		}
+		while((info = categoryIterNext(&iter)) != NULL) bloomAdd(filter, info->movieID);
+		int failed = iter.failed;
+		categoryIterEnd(&iter);
+		if(failed)
+		{
+			deleteBloom(filter);
+			return 0;
+		}
+	}
+
+	// Readers still checking the old filter finish with it before it is freed
+	bloom_t *old = catalog->movieFilter;
+	EPOCH_PUBLISH(catalog->movieFilter, filter);
+	if(old != NULL) epochRetire(&catalog->epoch, old, reclaimMovieFilter);
+	return 1;
+}
+
+
+/**
+ * @brief Makes a movie map of size absent slots
+ * @return returns the map, NULL on malloc failure
+*/
+movieMap_t *makeMovieMap(int size)
+{
+	movieMap_t *map = (movieMap_t*)calloc(1, sizeof(movieMap_t) + (size_t)size * sizeof(movieSlot_t));
+	if(map == NULL) return NULL;
+	map->size = size;
+	return map;
+}
+
+
+/**
+ * @brief Looks a movieID up in the movie map. Safe to call concurrently with A and D
+ * @return returns the category of the movie, MOVIE_MAP_NEW, MOVIE_MAP_ABSENT or MOVIE_MAP_UNKNOWN, and sets *info
+ * (if info isn't NULL) to the record of a categorized movie when the backend keeps one record per movie, NULL otherwise,
+ * and *node (if node isn't NULL) to its category node with CATEGORY_PARENTS, NULL otherwise
+*/
+int movieMapFind(int movieID, movieInfo_t **info, movie_t **node)
+{
+	if(info != NULL) *info = NULL;
+	if(node != NULL) *node = NULL;
+	epochEnter(&catalog->epoch);
+	movieMap_t *map = EPOCH_READ(catalog->movieMap);
+	int where = MOVIE_MAP_UNKNOWN;
+	if(map != NULL && movieID >= 0 && movieID < map->size)
+	{
+		// The record is stored before the category, so it is there once the category is
+		where = __atomic_load_n(&map->slots[movieID].where, __ATOMIC_ACQUIRE) + MOVIE_MAP_ABSENT;
+		if(info != NULL && where >= 0) *info = EPOCH_READ(map->slots[movieID].info);
+#ifdef CATEGORY_PARENTS
+		if(node != NULL && where >= 0) *node = EPOCH_READ(map->slots[movieID].node);
+#endif
+	}
+	epochExit(&catalog->epoch);
+	return where;
+}
+
+
+/**
+ * @brief Maps a movieID to the new releases before the movie becomes reachable, growing the map first if it doesn't cover it
+ * @return returns void
+*/
+void movieMapAdd(int movieID)
+{
+	if(catalog->movieMap == NULL || movieID < 0 || movieID >= MOVIE_MAP_MAX) return;
+	if(movieID >= catalog->movieMap->size)
 	{
-		printf("Chain %d of Users:\n", key);
-		if(user_hashtable_p[key] != NULL)
-		{
-			for(user_t *user = user_hashtable_p[key]; user != NULL; user = user->next)
-			{
-				printf("   %d\n   History Tree:\n", user->userID);
-				InOrderPrintUserMoviesEd2(user->history);
-			}
-		}
+		// A map that can't grow leaves the movie to the trees
+		int size = catalog->movieMap->size;
+		while(size <= movieID) size = size > MOVIE_MAP_MAX / 2 ? MOVIE_MAP_MAX : 2 * size;
+		movieMap_t *map = makeMovieMap(size);
+		if(map == NULL) return;
+		memcpy(map->slots, catalog->movieMap->slots, (size_t)catalog->movieMap->size * sizeof(movieSlot_t));
+		movieMap_t *old = catalog->movieMap;
+		EPOCH_PUBLISH(catalog->movieMap, map);
+		epochRetire(&catalog->epoch, old, free);
 	}
-	printf("DONE\n\n");
-	return 1;
- }
- 
 
-/* Extra functions */
+	// A second movie with the same movieID, in another category, makes the slot unknown for good
+	movieSlot_t *slot = &catalog->movieMap->slots[movieID];
+	int where = slot->where == 0 ? MOVIE_MAP_NEW : MOVIE_MAP_UNKNOWN;
+	__atomic_store_n(&slot->where, where - MOVIE_MAP_ABSENT, __ATOMIC_RELEASE);
+}
+
 
 /**
- * @brief Implements the universal hash function given all parameters
- * @return int: the key
+ * @brief Maps a new release to the category it was distributed to, once it is linked there. node is the category
+ * node holding info, NULL for the index backends
+ * @return returns void
 */
-int hash_function(int a, int b, int x, int m, int p)
+void movieMapDistribute(int movieID, int category, movieInfo_t *info, movie_t *node)
 {
-	 int k = ((a*x + b) % p) % m;
-	 return k;
+	if(catalog->movieMap == NULL || movieID < 0 || movieID >= catalog->movieMap->size) return;
+	movieSlot_t *slot = &catalog->movieMap->slots[movieID];
+	if(slot->where + MOVIE_MAP_ABSENT != MOVIE_MAP_NEW) return;
+#ifdef CATALOG_VERSIONS
+	// Every version has its own copy of the record, readers find theirs in the version they pinned
+	info = NULL;
+#endif
+#ifdef CATEGORY_PARENTS
+	EPOCH_PUBLISH(slot->node, node);
+#else
+	(void)node;
+#endif
+	EPOCH_PUBLISH(slot->info, info);
+	__atomic_store_n(&slot->where, category - MOVIE_MAP_ABSENT, __ATOMIC_RELEASE);
 }
 
 
 /**
- * @brief Makes a new user of userID
- * @return user_t*: a pointer to the new user struct
+ * @brief Looks the record of a movie up in the hot movie cache, if built with MOVIE_HOT_CACHE. Sets *node (if node
+ * isn't NULL) to the category node of the record with CATEGORY_PARENTS when the cache has it, NULL otherwise
+ * @return returns the record, NULL on a miss or without the cache
 */
-user_t* makeNewUser(int userID)
+movieInfo_t *movieHotFind(int movieID, int category, movie_t **node)
 {
-	user_t *newUser = (user_t*)malloc(sizeof(user_t));
-	newUser->userID = userID;
-	newUser->history = NULL;
-	newUser->next = NULL;
-	return newUser;
+#ifdef MOVIE_HOT_CACHE
+	return hotCacheFind(&catalog->movieHotCache, movieID, category, node);
+#else
+	if(node != NULL) *node = NULL;
+	(void)movieID;
+	(void)category;
+	return NULL;
+#endif
 }
 
 
 /**
- * @brief Initializes Hash Table with null Pointers
- * @return 1 on Success 0 on malloc failure
+ * @brief Caches the record of a movie just found in its category, with its category node if the caller has it,
+ * if built with MOVIE_HOT_CACHE
+ * @return returns void
 */
-int makeHashTable()
+void movieHotAdd(int movieID, int category, movieInfo_t *info, movie_t *node)
 {
-	user_hashtable_p = (user_t**)malloc(hashtable_size * sizeof(user_t*));
-	if(!user_hashtable_p) return 0;
-	return 1;
+#ifdef MOVIE_HOT_CACHE
+	hotCacheAdd(&catalog->movieHotCache, movieID, category, info, node);
+#else
+	(void)movieID;
+	(void)category;
+	(void)info;
+	(void)node;
+#endif
 }
 
 
 /**
- * @brief Initializes Hash Table with null Pointers
- * @return void
+ * @brief Frees the info of a category movie unless it is a record of the loaded snapshot
+ * @return returns void
 */
-void initHashTable()
+void freeMovieInfo(movieInfo_t *Info)
 {
-	for(int i=0; i < hashtable_size; i++) user_hashtable_p[i] = NULL;
-	return;
+	if(snapshotOwns(Info)) return;
+	free(Info);
 }
 
 
 /**
- * @brief Deletes Hash Table
- * @return void
+ * @brief Assigns the user of UID for the given user  parameter. Call inside a read section or with the user's stripe locked
+ * @return returns 1 if user exists, 0 otherwise
 */
-void deleteHashTable()
+int userFind(int userID, user_t **user)
 {
-	if(user_hashtable_p == NULL) return;
-	for(int i=0; i<hashtable_size; i++)
+	// Return 0 if userId > max_id
+	if(userID > catalog->max_id)
+	{
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
+		return 0;
+	} 
+
+	// One probe: the direct index, or one hash and one walk of the chain
+	(*user) = userTableFind(&catalog->userTable, userID);
+	if((*user) == NULL)
 	{
-		deleteUserChainIter(user_hashtable_p[i]);
+		printf("User with userID: %d does not exist\n", userID);
+		return 0;
 	}
-	free(user_hashtable_p);
-	return;
+	return 1;
 }
 
 
 /**
- * @brief Deletes Hash Table cell chain
- * @return void
+ * @brief Locks the stripe of the user and assigns it to slot->user in the same probe. Reports a missing user as userFind() does
+ * @return returns the user with slot->stripe locked, NULL with nothing locked if it doesn't exist
 */
-void deleteUserChainIter(user_t *user)
+user_t *userLocate(int userID, userSlot_t *slot)
+{
+	return userLocateProbed(userID, NULL, slot);
+}
+
+
+/**
+ * @brief userLocate() for a user a finished probe looked up, whose result is taken unless users were registered
+ * or unregistered or the table was resized since. With probe NULL the user is looked up as userLocate() does
+ * @return returns the user with slot->stripe locked, NULL with nothing locked if it doesn't exist
+*/
+user_t *userLocateProbed(int userID, const userProbe_t *probe, userSlot_t *slot)
 {
-	if(user == NULL) return;
-	deleteUserChainIter(user->next);
-	if(user->history != NULL)
+	// Return NULL if userId > max_id
+	if(userID > catalog->max_id)
+	{
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
+		return NULL;
+	} 
+
+	user_t *user = probe != NULL ? userTableLocateProbed(&catalog->userTable, probe, slot) : userTableLocate(&catalog->userTable, userID, slot, 0);
+	if(user == NULL)
 	{
-		freeUserHistoryTree(user->history);
-		user->history = NULL;
+		userTableUnlock(&catalog->userTable, slot->stripe);
+		printf("User with userID: %d does not exist\n", userID);
 	}
-	free(user);
-	return;
+	return user;
 }
 
 
 /**
- * @brief Checks if a given User exists
- * @return returns 1 if True, 0 if False
+ * @brief edits the Movie with movieID given the user's score
+ * @return returns 1 if movie exists, 0 otherwise
 */
-int existsUser(int userID)
+int editeMovie(int movieID, int score, int category)
 {
-	// Return 0 if userId > max_id
-	if(userID > max_id)
+	movieInfo_t *info;
+	movie_t *node;
+	int where = movieMapFind(movieID, &info, &node);
+	if(where != MOVIE_MAP_UNKNOWN && where != category) return 0;
+	if(where == MOVIE_MAP_UNKNOWN && !movieMayExist(movieID)) return 0;
+
+	// The few movies most W events watch resolve in the hot cache when the map can't tell
+	if(where == MOVIE_MAP_UNKNOWN) info = movieHotFind(movieID, category, &node);
+
+#ifdef CATEGORY_INDEX
+	// W events may run concurrently against the index, so the counters are updated atomically
+	if(info == NULL)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
-		return 0;
-	} 
+		info = categoryFind(category, NULL, movieID);
+		if(info == NULL) return 0;
+		movieHotAdd(movieID, category, info, NULL);
+	}
+	__atomic_fetch_add(&info->sumScore, score, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&info->watchedCounter, 1, __ATOMIC_RELAXED);
+	queryCacheTouchCatalog(&catalog->queryCache);
+	return 1;
+#else
+	// With the node of the movie known the maxima are fixed up from it, without a walk from the root
+	if(node != NULL) return editeMovieNode(node, score, category);
+	movie_t *root = catalog->categoryArray[category]->movie;
+
+#ifdef CATEGORY_EYTZINGER
+	// W runs on the thread that drops and builds the layouts, so the layout can't be retired under it
+	if(info == NULL && catalog->categoryArray[category]->layout != NULL)
+	{
+		info = eytzingerFind(catalog->categoryArray[category]->layout, movieID);
+		if(info == NULL) return 0;
+		movieHotAdd(movieID, category, info, NULL);
+	}
+#endif
 
-	// Generate Hash key
-	int key = hash_function(a, b, userID, m, p);
+	// The record the map holds is the node's own, only the maxima on its path still need the walk below
+	if(info != NULL)
+	{
+		info->sumScore += score;
+		info->watchedCounter += 1;
+		movieFixMaxScore(root, movieID);
+		queryCacheTouchCatalog(&catalog->queryCache);
+		return 1;
+	}
 
-	// If chain associated with key is empty user does not exist.
-	if(user_hashtable_p[key] == NULL) return 0;
+	movie_t *curr = movieFind(root, movieID);
+	if(curr == NULL) return 0; // It does not exist
+	return editeMovieNode(curr, score, category);
+#endif
+}
 
-	// Iterate through the chain untill you either reach NULL or user with identical userID
-	user_t *user;
-	for(user = user_hashtable_p[key]; user != NULL && user->userID != userID; user=user->next);
 
-	// Return True or False Accordingly
-	if(user == NULL) return 0;
+#ifndef CATEGORY_INDEX
+/**
+ * @brief edits the category node of a movie the caller found, as editeMovie() does once it finds it
+ * @return returns 1 on success, 0 if no draft copy could be made
+*/
+int editeMovieNode(movie_t *curr, int score, int category)
+{
+	int movieID = curr->Info->movieID;
+#ifdef CATALOG_VERSIONS
+	// Published versions keep the old scores. Edit a draft copy instead
+	curr = versionDraftPath(&catalog->versions, category, movieID, 1);
+	if(curr == NULL) return 0;
+#endif
+	curr->Info->sumScore += score;
+	curr->Info->watchedCounter += 1;
+	movieHotAdd(movieID, category, curr->Info, curr);
+
+	// Only the maxima on the path to the movie can change. With CATALOG_VERSIONS that path is all draft nodes now
+#ifdef CATEGORY_PARENTS
+	movieFixMaxScoreUp(curr);
+#else
+	movieFixMaxScore(catalog->categoryArray[category]->movie, movieID);
+#endif
+	queryCacheTouchCatalog(&catalog->queryCache);
 	return 1;
 }
-
+#endif
 
 
 /**
- * @brief Initialize newMoviesTree with NULL root
- * @return returns void
+ * @brief adds the given movie to the user History Tree
+ * @return returns 1 on success, 0 otherwise
 */
-void initNewMoviesTree()
+int addMovieToUser(user_t** user, int category, int movieID, int score)
 {
-	newMoviesTree.root = NULL;
+	return addMovieToUserAt(user, NULL, category, movieID, score);
 }
 
 
 /**
- * @brief Create New Movie for NewMovies Tree
- * @return returns newMovie_t struct pointer
+ * @brief addMovieToUser() for a caller that already found the leaf of the history the movie goes next to,
+ * with the user's stripe locked since. With leaf NULL the leaf is searched for
+ * @return returns 1 on success, 0 otherwise
 */
-newMovie_t* makeNewMovie(int movieID, int category, int year)
+int addMovieToUserAt(user_t** user, userMovie_t *leaf, int category, int movieID, int score)
 {
-	// Allocate newMovie memory
-	newMovie_t *newMovie = (newMovie_t *)malloc(sizeof(newMovie_t));
-	if(!newMovie) return NULL; // Return NULL upon failure
+	// A history still in the loaded snapshot is built before it is edited
+	userMovie_t *root = userHistory(*user);
+	if(root == NULL && (*user)->n_snapshot > 0) return 0;
 
-	// Fill in parameters
-	newMovie->category = category;
-	newMovie->Info = (movieInfo_t *)malloc(sizeof(movieInfo_t));
-	if(!newMovie->Info) return NULL;
-	newMovie->Info->movieID = movieID;
-	newMovie->Info->year = year;
-	newMovie->Info->sumScore = 0;
-	newMovie->Info->watchedCounter = 0;
-	newMovie->lc = NULL;
-	newMovie->rc = NULL;
-	return newMovie;
-}
+	// Create new user movie object
+	userMovie_t *movie = makeNewUserMovie(movieID, category, score);
+	if(!movie) return 0;
 
+	// Check if the root is empty in which case add root
+	if(root == NULL)
+	{
+		EPOCH_PUBLISH((*user)->history, movie);
+		return 1;
+	}
+
+	// Otherwise find the leaf the movie goes next to
+	userMovie_t *prev = leaf != NULL ? leaf : historyLeaf(root, movieID);
+	int isLeft = movieID <= prev->Info->movieID;
+    if(prev->Info->movieID != movieID)
+    {
+		// The leaf is replaced by a new internal node holding the leaf and the new movie as children.
+		// The internal node is a copy of its left child, so that searches go left for keys <= its key
+		userMovie_t *left = isLeft ? movie : prev;
+		userMovie_t *right = isLeft ? prev : movie;
+		userMovie_t *inner = userMovieCopy(left);
+		if(!inner)
+		{
+			freeUserHistoryTree(movie);
+			return 0;
+		}
+		userMovie_t *parent = prev->parent;
+		inner->lc = left;
+		inner->rc = right;
+		inner->parent = parent;
+		movie->parent = inner;
+
+		// Readers see either the old leaf or the complete new subtree
+		if(parent == NULL) EPOCH_PUBLISH((*user)->history, inner);
+		else if(parent->lc == prev) EPOCH_PUBLISH(parent->lc, inner);
+		else EPOCH_PUBLISH(parent->rc, inner);
+		prev->parent = inner;
+    }
+	else  // If we hit the same movie on the users watch history just edit the score
+	{
+		prev->Info->sumScore = score;
+		freeUserHistoryTree(movie);
+	}
+	return 1;
+}
 
 
 /**
- * @brief Checks whether the given movie exists or not (using the MovieID)
- * @return returns 1 if True, 0 otherwise
+ * @brief Returns the History Tree of the user, building it first if it is still in the loaded snapshot.
+ * Only call with the user's stripe locked
+ * @return returns the root, NULL if the user has not watched any movies or on malloc failure
 */
-int existsNewMovie(int movieID)
+userMovie_t *userHistory(user_t *user)
 {
-	// If newMoviesTree is empty the movie does not exist
-	if(newMoviesTree.root == NULL) return 0;
+	if(user->history != NULL || user->n_snapshot == 0) return user->history;
 
-	// Perform recursive Tree Traversal to check if the requested movies exists
-	int found = InOrderFoundNewMovieTree(newMoviesTree.root, movieID);
-	if(found) return 1;
-	return 0;
+	// Readers that loaded history as NULL keep reading the snapshot records, which stay valid
+	userMovie_t *history = snapshotBuildHistory(user->snapshot, user->n_snapshot);
+	if(history != NULL) EPOCH_PUBLISH(user->history, history);
+	return history;
 }
 
 
 /**
- * @brief Recursive Function that traverses the newMoviesTree and checks if a given movie exists
- * @return returns 1 if Movie is found, 0 otherwise
+ * @brief makes a new usermovie_t object and fills it in
+ * @return returns 1 on success, 0 otherwise
 */
-int InOrderFoundNewMovieTree(newMovie_t* newMovieNode, int movieID)
+userMovie_t *makeNewUserMovie(int movieID, int category, int score)
 {
-	if(newMovieNode == NULL) return 0;
-	if(newMovieNode->Info->movieID == movieID) return 1;
-	int foundLeft = InOrderFoundNewMovieTree(newMovieNode->lc, movieID);
-	int foundRight = InOrderFoundNewMovieTree(newMovieNode->rc, movieID);
-	return (int)(foundLeft || foundRight);
+	userMovieRecord_t *record = (userMovieRecord_t*)poolAlloc(&catalog->userPools.history);
+	if(!record) return NULL;
+	userMovie_t *userMovie = &record->node;
+	userMovie->Info = &record->info;
+	userMovie->Info->category = category;
+	userMovie->Info->movieID = movieID;
+	userMovie->Info->sumScore = score;
+	userMovie->lc = NULL;
+	userMovie->rc = NULL;
+	userMovie->parent = NULL;
+	return userMovie;
 }
 
 
+
 /**
- * @brief InOrder Traversal of newMovieTree that prints the movieIDs
- * @return returns 1 if Movie is found, 0 otherwise
+ * @brief Makes a copy user movie object from the passed in object
+ * @return returns NULL on failure, userMovie_t* on success
 */
-void InOrderPrintNewMovieTree(newMovie_t *newMovieNode)
+userMovie_t* userMovieCopy(userMovie_t *userMovie)
 {
-	if(newMovieNode == NULL) return;
-	InOrderPrintNewMovieTree(newMovieNode->lc);
-	printf(" %d,", newMovieNode->Info->movieID);
-	InOrderPrintNewMovieTree(newMovieNode->rc);
-	return;
+	userMovie_t *movie = makeNewUserMovie(userMovie->Info->movieID, userMovie->Info->category, userMovie->Info->sumScore);
+	return movie;
 }
 
 
-
 /**
- * @brief delete the newMoviesTree
+ * @brief Epoch reclaim function for unregistered users. Frees the user along with its History tree
  * @return returns void
 */
-void deleteNewMoviesTree()
+void reclaimUser(void *object)
 {
-	if(newMoviesTree.root == NULL) return;
-	deleteNewMoviesTreeIter(newMoviesTree.root);
-	newMoviesTree.root = NULL;
+	user_t *user = (user_t*)object;
+	freeUserHistoryTree(user->history);
+	user->history = NULL;
+	freeUser(user);
 }
 
 
 /**
- * @brief delete the newMoviesTree recursive PostOrder function
+ * @brief Epoch reclaim function for distributed new release nodes
  * @return returns void
 */
-void deleteNewMoviesTreeIter(newMovie_t *newMovieNode)
+void reclaimNewMovie(void *object)
 {
-	if(newMovieNode == NULL) return;
-	deleteNewMoviesTreeIter(newMovieNode->lc);
-	deleteNewMoviesTreeIter(newMovieNode->rc);
-	if(newMovieNode->Info != NULL)
+	newMovie_t *newMovie = (newMovie_t*)object;
+	if(newMovie->Info != NULL)
 	{
-		free(newMovieNode->Info);
-		newMovieNode->Info = NULL;
+		free(newMovie->Info);
+		newMovie->Info = NULL;
 	}
-	free(newMovieNode);
+	free(newMovie);
 }
 
 
-
 /**
- * @brief Initializes the movie Category Array with sentinel nodes
- * @return returns void
+ * @brief Frees the History tree associated with one user using PostOrder Tree Traversal
+ * @return returns NULL on failure, userMovie_t* on success
 */
-int initMovieCategoryArray()
+void freeUserHistoryTree(userMovie_t *userMovie)
 {
-	movie_t *sent = makeMovie(-1, 0);
-	if(sent == NULL)
-	{
-		printf("Failure upon movie_t object memory allocation\n");
-		return 0;
-	}
-
-	for(int  i=0; i<6; i++)
-	{
-		categoryArray[i] = (movieCategoryArray_t*)malloc(sizeof(movieCategoryArray_t));
-		if(categoryArray[i] == NULL)
-		{
-			printf("Failure upon movieCategory_t object memory allocation\n");
-			return 0;
-		}
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_POST, userMovie);
 
-		categoryArray[i]->sentinel = sent;
-		categoryArray[i]->movie = sent;
-	}
-	return 1;
+	// The info is part of the same record
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; ) poolFree(&catalog->userPools.history, node);
+	treeWalkEnd(&walk);
 }
 
 
 /**
- * @brief Makes a regular movie_t struct object
- * @return returns 1 upon success, 0 upon malloc failure
+ * @brief Traverse the History Tree Inorder and prints the leaves
+ * @return returns NULL on failure, userMovie_t* on success
 */
-movie_t* makeMovie(int movieID, int year)
+void InOrderPrintHistoryTreeLeaves(userMovie_t *root)
 {
-	movie_t *movie = (movie_t*)malloc(sizeof(movie_t));
-	if(movie == NULL) return NULL;
-	movieInfo_t *m_info = (movieInfo_t*)malloc(sizeof(movieInfo_t));
-	if(m_info == NULL)
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, root);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
 	{
-		free(movie);
-		return NULL;
+		if(node->lc == NULL && node->rc == NULL) printf("   %d, %d\n", node->Info->movieID, node->Info->sumScore);
 	}
-	movie->Info = m_info;
-	movie->Info->movieID = movieID;
-	movie->Info->sumScore = 0;
-	movie->Info->watchedCounter = 0;
-	movie->Info->year = year;
-	movie->lc = NULL;
-	movie->rc = NULL;
+	treeWalkEnd(&walk);
+}
 
-	return movie;
+
+
+/**
+ * @brief Walk filter of the category trees that keeps the subtrees holding a score of at least *score
+ * @return returns 1 to go into the subtree, 0 to skip it
+*/
+static int movieEntersScore(const void *node, void *score)
+{
+	return ((const movie_t*)node)->maxScore >= *(float*)score;
 }
 
 
 /**
- * @brief Performs inOrder newMovieTree traversal and for each node it visits it calls the function distsributeMovie()
- * that is responsible for creating and placing the corresponding movie in the appropriate BST of the movieCategoryArray
- * @note: IF A MOVIE TRANSFER FAILS WE HAVE TO STOP THE PROCESS. OTHERWISE WE MIGHT END UP WITH A CORRUPTED TREE 
+ * @brief Traverses a movie_t tree PostOrder and adds a movie to helperMovieArray if movie_score exceeds the provided score.
+ * A subtree whose maxScore is below score is skipped before the walk goes into it
  * @return returns void
 */
-int postOrderDistribute(newMovie_t *newMovie)
+void inOrderAddBasedOnScore(movie_t *movie, float score, movieInfo_t **helperMovieArray, int *index, int size)
 {
-	if(newMovie == NULL) return 1;
-	int successLeft = postOrderDistribute(newMovie->lc);
-	int successRight = postOrderDistribute(newMovie->rc);
-	int successful_transfer;
-	if(successLeft && successRight)
+	// The filter checks maxScore before the walk descends, the root included, so nothing in a skipped subtree is visited
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_POST, movie);
+	treeWalkFilter(&walk, movieEntersScore, &score);
+	for(movie_t *node; (*index) < size && (node = treeWalkNext(&walk)) != NULL; )
 	{
-		successful_transfer = DistributeMovie(newMovie);
-		if(!successful_transfer)
-		{
-			printf("Movie Distributing Process has stopped at the node with MovieID: %d\n", newMovie->Info->movieID);
-			newMovie->lc = NULL;
-			newMovie->rc = NULL;
-			return 0;
-		} 
-		else
+		// Check if current movie has a greater score than score parameter 
+		//and add at the helperMovieArray at the given index location while increasing index by 1
+		float mv_score = (float)node->Info->sumScore / (float)node->Info->watchedCounter;
+		if(mv_score >= score)
 		{
-			if(newMovie->Info != NULL)
-			{
-				free(newMovie->Info);
-				newMovie->Info = NULL;
-			}
-			free(newMovie);
-			return 1;
+			helperMovieArray[(*index)] = node->Info;
+			(*index) = (*index) + 1;
 		}
 	}
-	else return 0;
+	treeWalkEnd(&walk);
 }
 
 
-
 /**
- * @brief Distributes the given movie to the appropriate place and tree of the movieCategoryArray
- * @return returns 1 upon success, 0 upon failure
+ * @brief Recomputes the maxScore of a category tree node from its info and its children
+ * @return returns void
 */
-int DistributeMovie(newMovie_t *newMovie)
+void movieUpdateMaxScore(movie_t *movie)
 {
-	int category = newMovie->category;
-	int movieID = newMovie->Info->movieID;
-	int year = newMovie->Info->year;
-	movie_t *temp = makeMovie(movieID, year);
-	if(!temp) return 0;
-	movie_t *root = categoryArray[category]->movie;
-	movie_t *sentinel = categoryArray[category]->sentinel;
+	float best = MOVIE_NO_SCORE;
+	if(movie->Info->watchedCounter > 0) best = (float)movie->Info->sumScore / (float)movie->Info->watchedCounter;
+	if(movie->lc->maxScore > best) best = movie->lc->maxScore;
+	if(movie->rc->maxScore > best) best = movie->rc->maxScore;
+	movie->maxScore = best;
+}
 
-	// the BST for this category is empty. Create movie_t node and assign it to BST root
-	if(root == sentinel)
-	{
-		categoryArray[category]->movie = temp;
-		temp->lc = sentinel;
-		temp->rc = sentinel;
-		return 1;
-	}
 
-	// Otherwise traverse the Tree until you hit a sentinel
-	movie_t *curr = root, *prev = root;
-	while(curr != sentinel)
-	{
-		if(curr->Info->movieID > movieID)
-		{
-			prev = curr;
-			curr = curr->lc;
-		}
-		else
+/**
+ * @brief Recomputes the maxScore of every node on the path down to movieID, bottom-up, after its score changed
+ * @return returns void
+*/
+void movieFixMaxScore(movie_t *movie, int movieID)
+{
+	// The path is kept on a stack and fixed from its bottom up
+	treeStack_t path;
+	treeStackInit(&path);
+	while(movie->Info->movieID != -1)
+	{
+		if(!treeStackPush(&path, movie))
 		{
-			prev = curr;
-			curr = curr->rc;
+			// No memory for the rest of the path. It is fixed a level at a time from the bottom, descending to each again
+			int levels = 0;
+			for(movie_t *curr = movie; curr->Info->movieID != -1 && curr->Info->movieID != movieID; levels++)
+			{
+				curr = curr->Info->movieID > movieID ? curr->lc : curr->rc;
+			}
+			for(int level = levels; level >= 0; level--)
+			{
+				movie_t *curr = movie;
+				for(int i=0; i < level; i++) curr = curr->Info->movieID > movieID ? curr->lc : curr->rc;
+				if(curr->Info->movieID != -1) movieUpdateMaxScore(curr);
+			}
+			break;
 		}
+		if(movie->Info->movieID > movieID) movie = movie->lc;
+		else if(movie->Info->movieID < movieID) movie = movie->rc;
+		else break;
 	}
+	for(movie_t *node; (node = treeStackPop(&path)) != NULL; ) movieUpdateMaxScore(node);
+	treeStackFree(&path);
+}
 
-	// Having traversed the tree we place the new Node
-	if(prev->Info->movieID > movieID) // Place on the left
-	{
-		prev->lc = temp;
-		temp->lc = sentinel;
-		temp->rc = sentinel;
-		return 1;
-	}
-	else // place on the right
+
+#ifdef CATEGORY_PARENTS
+/**
+ * @brief Recomputes the maxScore of a category tree node after its score changed, then of its ancestors up to the
+ * first one whose maxScore stays the same, since the ones above were computed from it
+ * @return returns void
+*/
+void movieFixMaxScoreUp(movie_t *movie)
+{
+	for(; movie != NULL; movie = movie->parent)
 	{
-		prev->rc = temp;
-		temp->rc = sentinel;
-		temp->lc = sentinel;
-		return 1;
+		float before = movie->maxScore;
+		movieUpdateMaxScore(movie);
+		if(movie->maxScore == before) return;
 	}
-
 }
+#endif
 
 
 /**
- * @brief Checks if the movie already exists in the movie category array trees (Assuming movieID-category pair is correct)
- * @return returns 1 if True, 0 if False
+ * @brief Returns the total amount of movies found in the given category trees
+ * @return the number of movies
 */
-int newMovieExistsInCategoryArray(int movieID, int category)
+int getNumberOfMovies(movie_t *roots[6])
 {
-	movie_t *root = categoryArray[category]->movie;
-	movie_t *sentinel = categoryArray[category]->sentinel;
-
-	// If the tree is empty the movie does not exist in it
-	if(root == sentinel) return 0;
-
-	// Otherwise traverse the tree until you either hit a sentinel or a movieID match node
-	movie_t *curr = root;
-	while(curr != NULL && curr->Info->movieID != movieID)
+	int n_movies = 0;
+	for(int categ = 0; categ < 6; categ++)
 	{
-		if(curr->Info->movieID > movieID)
-		{
-			curr = curr->lc;
-		}
-		else
+		if(roots[categ] != NULL)
 		{
-			curr = curr->rc;
+			n_movies += categoryCount(categ, roots[categ]);
 		}
 	}
 
-	// Having traversed the tree check if curr is sentinel or a movieID match
-	if(curr == sentinel) return 0; // It does not exist
-	else return 1;
+	return n_movies;
 }
 
 
 /**
- * @brief Prints the BSTs of the movie category array Inorder
- * @return returns void
+ * @brief Looks a movie up in a category, whichever index backs it. root is the tree to search (unused by the skip list and the B+ tree)
+ * @return returns the movie info, NULL if the movie isn't in the category
 */
-void inOrderMoviePrint(movie_t *movie)
+movieInfo_t *categoryFind(int category, movie_t *root, int movieID)
 {
-	if(movie->Info->movieID == -1) return;
-	inOrderMoviePrint(movie->lc);
-	printf("%d, ", movie->Info->movieID);
-	inOrderMoviePrint(movie->rc);
-	return;
+#ifdef CATEGORY_SKIPLIST
+	(void)root;
+	return skipListFind(catalog->categoryArray[category]->index, movieID);
+#elif defined(CATEGORY_BPTREE)
+	(void)root;
+	return bpTreeFind(catalog->categoryArray[category]->index, movieID);
+#else
+	(void)category;
+#ifdef CATEGORY_EYTZINGER
+	// A layout is only published while its tree doesn't change, so it holds exactly the movies of the tree
+	eytzinger_t *layout = EPOCH_READ(catalog->categoryArray[category]->layout);
+	if(layout != NULL) return eytzingerFind(layout, movieID);
+#endif
+	movie_t *movie = movieFind(root, movieID);
+	return movie != NULL ? movie->Info : NULL;
+#endif
 }
 
 
 /**
- * @brief destroy movieCategoryArray and Subtrees
+ * @brief Prints the movieIDs of a category in ascending order. root is the tree to print (unused by the skip list and the B+ tree)
  * @return returns void
 */
-void deleteMovieCategoryArray()
+void categoryPrint(int category, movie_t *root)
 {
-	for(int i=0; i<6; i++)
-	{
-		// If categoryArra[i] already freed or is empty skip for now
-		if(categoryArray[i] == NULL) continue;
-
-		// Otherwise
-		PostOrderMovieDelete(categoryArray[i]->movie);
-		categoryArray[i]->movie = NULL;
-	}
-
-	if(categoryArray[0]->sentinel != NULL)
+#ifdef CATEGORY_SKIPLIST
+	(void)root;
+	for(skipNode_t *node = skipListFirst(catalog->categoryArray[category]->index); node != NULL; node = skipListNext(node))
 	{
-		if(categoryArray[0]->sentinel->Info != NULL)
-		{
-			free(categoryArray[0]->sentinel->Info);
-			categoryArray[0]->sentinel->Info = NULL;
-		}
-		free(categoryArray[0]->sentinel);
+		printf("%d, ", node->movieID);
 	}
-	for(int i=0; i<6; i++)
-	{
-		categoryArray[i]->sentinel = NULL;
-		if(categoryArray[i] != NULL)
-		{
-			free(categoryArray[i]);
-			categoryArray[i] = NULL;
-		}
-	} 
+#elif defined(CATEGORY_BPTREE)
+	(void)root;
+	bpIter_t iter;
+	movieInfo_t *Info;
+	bpTreeSeek(catalog->categoryArray[category]->index, &iter, INT_MIN);
+	while((Info = bpIterNext(&iter)) != NULL) printf("%d, ", Info->movieID);
+#else
+	(void)category;
+	inOrderMoviePrint(root);
+#endif
 }
 
 
+/**
+ * @brief Counts the movies of a category. root is the tree to count (unused by the skip list and the B+ tree)
+ * @return returns the number of movies
+*/
+int categoryCount(int category, movie_t *root)
+{
+	int n_movies = 0;
+#ifdef CATEGORY_SKIPLIST
+	(void)root;
+	for(skipNode_t *node = skipListFirst(catalog->categoryArray[category]->index); node != NULL; node = skipListNext(node)) n_movies++;
+#elif defined(CATEGORY_BPTREE)
+	(void)root;
+	bpIter_t iter;
+	bpTreeSeek(catalog->categoryArray[category]->index, &iter, INT_MIN);
+	while(bpIterNext(&iter) != NULL) n_movies++;
+#else
+	(void)category;
+	inOrderCountMovies(root, &n_movies);
+#endif
+	return n_movies;
+}
+
 
 /**
- * @brief Recursively Frees BST nodes using PostOrder Traversal
+ * @brief Adds the movies of a category whose score is at least score to helperMovieArray, up to size entries.
+ * root is the tree to scan (unused by the skip list and the B+ tree)
  * @return returns void
 */
-void PostOrderMovieDelete(movie_t *movie)
+void categoryAddBasedOnScore(int category, movie_t *root, float score, movieInfo_t **helperMovieArray, int *index, int size)
 {
-	if(movie->Info->movieID == -1) return;
-	PostOrderMovieDelete(movie->lc);
-	PostOrderMovieDelete(movie->rc);
-	if(movie->Info != NULL)
+#ifdef CATEGORY_SKIPLIST
+	(void)root;
+	for(skipNode_t *node = skipListFirst(catalog->categoryArray[category]->index); node != NULL && (*index) < size; node = skipListNext(node))
 	{
-		free(movie->Info);
-		movie->Info = NULL;
+		float mv_score = (float)node->Info->sumScore / (float)node->Info->watchedCounter;
+		if(mv_score >= score)
+		{
+			helperMovieArray[(*index)] = node->Info;
+			(*index) = (*index) + 1;
+		}
 	}
-	if(movie != NULL)
+#elif defined(CATEGORY_BPTREE)
+	(void)root;
+	bpIter_t iter;
+	movieInfo_t *Info;
+	bpTreeSeek(catalog->categoryArray[category]->index, &iter, INT_MIN);
+	while((*index) < size && (Info = bpIterNext(&iter)) != NULL)
 	{
-		free(movie);
+		float mv_score = (float)Info->sumScore / (float)Info->watchedCounter;
+		if(mv_score >= score)
+		{
+			helperMovieArray[(*index)] = Info;
+			(*index) = (*index) + 1;
+		}
 	}
-	return;
+#else
+	(void)category;
+	inOrderAddBasedOnScore(root, score, helperMovieArray, index, size);
+#endif
 }
 
 
 /**
- * @brief Assigns the user of UID for the given user  parameter.
- * @return returns 1 if user exists, 0 otherwise
+ * @brief Adds the movies of a category released from fromYear to toYear whose score is at least score to helperMovieArray,
+ * up to size entries. Drives the scan with the year index or the category, whichever holds fewer candidates.
+ * root is the tree to scan (unused by the skip list and the B+ tree)
+ * @return returns 1 on success, 0 on malloc failure
 */
-int userFind(int userID, user_t **user)
+int categoryAddInYears(int category, movie_t *root, float score, int fromYear, int toYear, watchedSet_t *watched, movieInfo_t **helperMovieArray, int *index, int size)
 {
-	// Return 0 if userId > max_id
-	if(userID > max_id)
+	yearIndex_t *years = &catalog->categoryArray[category]->years;
+	yearIndexLock(years);
+	int n_movies = yearIndexSize(years);
+	int inYears = yearIndexCount(years, fromYear, toYear);
+	if(inYears == n_movies && watched == NULL)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
-		return 0;
-	} 
+		// Every movie is in range, the year index filters nothing
+		yearIndexUnlock(years);
+		categoryAddBasedOnScore(category, root, score, helperMovieArray, index, size);
+		return 1;
+	}
+#ifndef CATEGORY_INDEX
+	if(inYears == n_movies)
+	{
+		// The pruned scan in ascending movieID merges with the history
+		yearIndexUnlock(years);
+		inOrderAddUnwatched(root, score, watched, helperMovieArray, index, size);
+		return 1;
+	}
+#endif
 
-	//Check if the User Already Exists
-	if(!existsUser(userID))
+	// Each candidate of the year index costs a lookup in the category, about log2(n) steps
+	int lookup = 1;
+	while(lookup < 31 && (1 << lookup) < n_movies) lookup++;
+	if((long long)inYears * lookup < n_movies)
 	{
-		printf("User with userID: %d does not exist\n", userID);
-		return 0;
+		yearIter_t iter;
+		yearNode_t *node;
+		yearIndexSeek(years, &iter, fromYear);
+		while((*index) < size && (node = yearIndexNext(&iter)) != NULL && node->year <= toYear)
+		{
+			// Movies indexed after the version being read was published aren't in it
+			if(watched != NULL && watchedSetHas(watched, node->movieID)) continue;
+			movieInfo_t *info = categoryFind(category, root, node->movieID);
+			if(info == NULL) continue;
+			float mv_score = (float)info->sumScore / (float)info->watchedCounter;
+			if(mv_score >= score)
+			{
+				helperMovieArray[(*index)] = info;
+				(*index) = (*index) + 1;
+			}
+		}
+		yearIndexUnlock(years);
+		return 1;
 	}
+	yearIndexUnlock(years);
 
-	// Generate Key using a call to the hash function
-	int key = hash_function(a, b, userID, m, p);
-	for((*user) = user_hashtable_p[key]; (*user)->userID !=userID; (*user) = (*user)->next)
+	// Too many candidates. Walk the category and check the year of every movie instead
+	categoryIter_t iter;
+	movieInfo_t *info;
+	if(!categoryIterSeek(&iter, category, root, INT_MIN)) return 0;
+	while((*index) < size && (info = categoryIterNext(&iter)) != NULL)
 	{
-		printf("userID: %d, Key: %d\n", (*user)->userID, key);
+		if(info->year < fromYear || info->year > toYear) continue;
+		if(watched != NULL && watchedSetHas(watched, info->movieID)) continue;
+		float mv_score = (float)info->sumScore / (float)info->watchedCounter;
+		if(mv_score >= score)
+		{
+			helperMovieArray[(*index)] = info;
+			(*index) = (*index) + 1;
+		}
 	}
-	return 1;
+	int failed = iter.failed;
+	categoryIterEnd(&iter);
+	return !failed;
 }
 
 
 /**
- * @brief edits the Movie with movieID given the user's score
- * @return returns 1 if movie exists, 0 otherwise
+ * @brief Traverses a movie_t tree InOrder, skipping the subtrees below score, and adds the movies that pass score and are not in watched.
+ * Probing watched in ascending movieID makes the exclusion a merge with the history
+ * @return returns void
 */
-int editeMovie(int movieID, int score, int category)
+void inOrderAddUnwatched(movie_t *movie, float score, watchedSet_t *watched, movieInfo_t **helperMovieArray, int *index, int size)
 {
-	movie_t *root = categoryArray[category]->movie;
-	movie_t *sentinel = categoryArray[category]->sentinel;
-
-	// If the tree is empty the movie does not exist in it
-	if(root == sentinel) return 0;
-
-	// Otherwise traverse the tree until you either hit a sentinel or a movieID match node
-	movie_t *curr = root;
-	while(curr->Info->movieID != -1 && curr->Info->movieID != movieID)
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_IN, movie);
+	treeWalkFilter(&walk, movieEntersScore, &score);
+	for(movie_t *node; (*index) < size && (node = treeWalkNext(&walk)) != NULL; )
 	{
-		if(curr->Info->movieID > movieID)
-		{
-			curr = curr->lc;
-		}
-		else
+		float mv_score = (float)node->Info->sumScore / (float)node->Info->watchedCounter;
+		if(mv_score >= score && !watchedSetHas(watched, node->Info->movieID))
 		{
-			curr = curr->rc;
+			helperMovieArray[(*index)] = node->Info;
+			(*index) = (*index) + 1;
 		}
 	}
-
-	// Having traversed the tree check if curr is sentinel or a movieID match
-	if(curr == sentinel) return 0; // It does not exist
-	else // Edit the movie
-	{
-		curr->Info->sumScore += score;
-		curr->Info->watchedCounter += 1;
-		return 1;
-	}
+	treeWalkEnd(&walk);
 }
 
 
 /**
- * @brief adds the given movie to the user History Tree
- * @return returns 1 on success, 0 otherwise
+ * @brief Fills the set with the movies the user has watched. Only call inside the catalog epoch
+ * @return returns 1 on success, 0 on malloc failure
 */
-int addMovieToUser(user_t** user, int category, int movieID, int score)
+int watchedSetBuild(watchedSet_t *watched, user_t *user)
 {
-	// Create new user movie object
-	userMovie_t *movie = makeNewUserMovie(movieID, category, score);
-	if(!movie) return 0;
+	watched->ids = NULL;
+	watched->n = 0;
+	watched->cursor = 0;
+
+	// A history still in the loaded snapshot is already a sorted array of leaves
+	userMovie_t *history = EPOCH_READ(user->history);
+	int size = 0, scoreSum = 0;
+	if(history != NULL) inOrderFindStats(history, &scoreSum, &size);
+	else size = user->n_snapshot;
+	if(size == 0) return 1;
+
+	watched->ids = (int*)malloc(size * sizeof(int));
+	if(watched->ids == NULL) return 0;
+	if(history != NULL) inOrderCollectHistory(history, watched->ids, &watched->n, size);
+	else for(int i=0; i < size; i++) watched->ids[watched->n++] = user->snapshot[i].movieID;
+	return 1;
+}
 
-	userMovie_t *root = (*user)->history;
 
-	// Check if the root is empty in which case add root
-	if(root == NULL)
+/**
+ * @brief Checks whether movieID is in the set. Probes in ascending movieID cost amortized O(1), others O(log n)
+ * @return returns 1 if True, 0 if False
+*/
+int watchedSetHas(watchedSet_t *watched, int movieID)
+{
+	int lo = 0, hi = watched->n;
+	if(watched->cursor == 0 || watched->ids[watched->cursor - 1] < movieID)
 	{
-		(*user)->history = movie;
-		return 1;
+		// Gallop forward from the last probe, doubling the step until an id at least movieID is passed
+		lo = watched->cursor;
+		int step = 1;
+		while(lo + step <= watched->n && watched->ids[lo + step - 1] < movieID)
+		{
+			lo += step;
+			step *= 2;
+		}
+		if(lo + step < hi) hi = lo + step;
 	}
 
-	// Otherwise
-	userMovie_t *curr = root, *prev = root;
-	int isLeft = 0, isRight = 0;
-	while(curr != NULL)
-    {
-        if(curr->Info->movieID >= movieID)
-        {
-            isLeft = 1;
-            isRight = 0;
-			prev = curr;
-            curr = curr->lc;
-        }
-        else
-        {
-            isRight = 1;
-            isLeft = 0;
-			prev = curr;
-            curr = curr->rc;
-        }
-    }
-    if(prev->Info->movieID != movieID)
-    {
-        if(isLeft)
-        {
-			userMovie_t *parent_copy = userMovieCopy(prev);
-			if(!parent_copy) return 0;
-            prev->lc = movie;
-			movie->parent = prev;
-			prev->rc = parent_copy;
-			parent_copy->parent = prev;
-        }
-        else
-        {
-			userMovie_t *parent_copy = userMovieCopy(prev);
-			if(!parent_copy) return 0;
-            prev->rc = movie;
-			movie->parent = prev;
-			prev->lc = parent_copy;
-			parent_copy->parent = prev;
-        }
-    }
-	else  // If we hit the same movie on the users watch history just edit the score
+	// Binary search for the first id at least movieID in [lo, hi)
+	while(lo < hi)
 	{
-		prev->Info->sumScore = score;
+		int mid = lo + (hi - lo) / 2;
+		if(watched->ids[mid] < movieID) lo = mid + 1;
+		else hi = mid;
 	}
-	return 1;
+	watched->cursor = lo;
+	return lo < watched->n && watched->ids[lo] == movieID;
 }
 
 
 /**
- * @brief makes a new usermovie_t object and fills it in
- * @return returns 1 on success, 0 otherwise
+ * @brief Frees the ids of a set filled by watchedSetBuild()
+ * @return returns void
 */
-userMovie_t *makeNewUserMovie(int movieID, int category, int score)
+void watchedSetFree(watchedSet_t *watched)
+{
+	free(watched->ids);
+	watched->ids = NULL;
+	watched->n = 0;
+	watched->cursor = 0;
+}
+
+
+/**
+ * @brief Collects the movieIDs of the leaves of a History Tree InOrder, up to size of them
+ * @return returns void
+*/
+void inOrderCollectHistory(userMovie_t *movie, int *ids, int *n, int size)
 {
-	userMovie_t *userMovie = (userMovie_t*)malloc(sizeof(userMovie_t));
-	if(!userMovie) return NULL;
-	userMovie->Info = (movieInfoUser_t*)malloc(sizeof(movieInfoUser_t));
-	if(!userMovie->Info)
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (*n) < size && (node = treeWalkNext(&walk)) != NULL; )
 	{
-		free(userMovie);
-		return NULL;
+		// Only the leaves are watched movies. Internal nodes are routing copies
+		if(node->lc == NULL && node->rc == NULL)
+		{
+			ids[(*n)] = node->Info->movieID;
+			(*n) = (*n) + 1;
+		}
 	}
-	userMovie->Info->category = category;
-	userMovie->Info->movieID = movieID;
-	userMovie->Info->sumScore = score;
-	userMovie->lc = NULL;
-	userMovie->rc = NULL;
-	userMovie->parent = NULL;
-	return userMovie;
+	treeWalkEnd(&walk);
 }
 
 
-
+#ifndef CATEGORY_INDEX
 /**
- * @brief Makes a copy user movie object from the passed in object
- * @return returns NULL on failure, userMovie_t* on success
+ * @brief Pushes a node on the stack of an iterator, growing it as needed
+ * @return returns 1 on success, 0 on malloc failure
 */
-userMovie_t* userMovieCopy(userMovie_t *userMovie)
+static int categoryIterPush(categoryIter_t *iter, movie_t *movie)
 {
-	userMovie_t *movie = makeNewUserMovie(userMovie->Info->movieID, userMovie->Info->category, userMovie->Info->sumScore);
-	return movie;
+	if(treeStackPush(&iter->stack, movie)) return 1;
+	iter->failed = 1;
+	return 0;
 }
+#endif
 
 
 /**
- * @brief Frees the History tree associated with one user using PostOrder Tree Traversal
- * @return returns NULL on failure, userMovie_t* on success
+ * @brief Positions the iterator on the first movie of a category whose movieID is at least movieID.
+ * root is the tree to walk (unused by the skip list and the B+ tree)
+ * @return returns 1 on success, 0 on malloc failure
 */
-void freeUserHistoryTree(userMovie_t *userMovie)
+int categoryIterSeek(categoryIter_t *iter, int category, movie_t *root, int movieID)
 {
-	if(userMovie == NULL) return;
-	freeUserHistoryTree(userMovie->lc);
-	freeUserHistoryTree(userMovie->rc);
-	if(userMovie->Info != NULL)
+	iter->failed = 0;
+#ifdef CATEGORY_SKIPLIST
+	(void)root;
+	iter->node = skipListSeek(catalog->categoryArray[category]->index, movieID);
+	return 1;
+#elif defined(CATEGORY_BPTREE)
+	(void)root;
+	bpTreeSeek(catalog->categoryArray[category]->index, &iter->leaves, movieID);
+	return 1;
+#else
+	(void)category;
+	treeStackInit(&iter->stack);
+
+	// Every node at or after movieID on the way down is still to be returned, the ones before it never are
+	movie_t *curr = root;
+	while(curr->Info->movieID != -1)
 	{
-		free(userMovie->Info);
-		userMovie->Info = NULL;
+		if(curr->Info->movieID >= movieID)
+		{
+			if(!categoryIterPush(iter, curr)) return 0;
+			curr = curr->lc;
+		}
+		else curr = curr->rc;
 	}
-	free(userMovie);
-	return;
+	return 1;
+#endif
 }
 
 
 /**
- * @brief Traverse the History Tree Inorder and prints the leaves
- * @return returns NULL on failure, userMovie_t* on success
+ * @brief Returns the movie under the iterator and moves it to the next one in ascending movieID
+ * @return returns the movie info, NULL past the last movie
 */
-void InOrderPrintHistoryTreeLeaves(userMovie_t *root)
+movieInfo_t *categoryIterNext(categoryIter_t *iter)
 {
-	if(root == NULL) return;
-	InOrderPrintHistoryTreeLeaves(root->lc);
-	InOrderPrintHistoryTreeLeaves(root->rc);
-	if(root->lc == NULL && root->rc == NULL)
+#ifdef CATEGORY_SKIPLIST
+	skipNode_t *node = iter->node;
+	if(node == NULL) return NULL;
+	iter->node = skipListNext(node);
+	return node->Info;
+#elif defined(CATEGORY_BPTREE)
+	return bpIterNext(&iter->leaves);
+#else
+	if(iter->failed) return NULL;
+	movie_t *movie = treeStackPop(&iter->stack);
+	if(movie == NULL) return NULL;
+
+	// The successor is the leftmost node of the right subtree, or the deepest node left on the stack
+	for(movie_t *curr = movie->rc; curr->Info->movieID != -1; curr = curr->lc)
 	{
-		printf("   %d, %d\n", root->Info->movieID, root->Info->sumScore);
+		if(!categoryIterPush(iter, curr)) break;
 	}
-	return;
+	return movie->Info;
+#endif
 }
 
 
-
 /**
- * @brief Heapifies movieHelperArray with size d from index i
+ * @brief Releases an iterator positioned with categoryIterSeek()
  * @return returns void
 */
-void heapify(movie_t **helperMovieArray, int d, int i)
+void categoryIterEnd(categoryIter_t *iter)
 {
-    // Given the specific parent index extract the associated children indices
-    int largest_parent = i;
-    int left_child = 2*i + 1;
-    int right_child = 2*i + 2;
-	int score_left, score_right;
-    if (left_child < d) score_left = (float)helperMovieArray[left_child]->Info->sumScore / (float)helperMovieArray[left_child]->Info->watchedCounter;
-    if(right_child < d) score_right = (float)helperMovieArray[right_child]->Info->sumScore / (float)helperMovieArray[right_child]->Info->watchedCounter;
-	int score_largest_parent = (float)helperMovieArray[largest_parent]->Info->sumScore / (float)helperMovieArray[largest_parent]->Info->watchedCounter;
-	
-    // If the left child index is not out of array boundaries and the associated left child score is larger than the parent score make it largest
-    if(left_child < d && score_left > score_largest_parent)
-    {
-        largest_parent = left_child;
-		score_largest_parent = score_left;
-    }
-
-    // If the left child index is not out of array boundaries and the associated left child  is larger than the previous largest
-    // score make it largest
-    if(right_child < d && score_right > score_largest_parent)
-    {
-        largest_parent = right_child;
-		score_largest_parent = score_right;
-    }
-
-    if(largest_parent != i) // If any swapping occured, recursively perfrom heapifications begining from the swapped child index
-    {
-        movie_t *temp = helperMovieArray[i];
-        helperMovieArray[i] = helperMovieArray[largest_parent];
-        helperMovieArray[largest_parent] = temp;
-
-        // Recursive heapification call
-        heapify(helperMovieArray, d, largest_parent);
-    }
+#ifdef CATEGORY_SKIPLIST
+	iter->node = NULL;
+#elif defined(CATEGORY_BPTREE)
+	iter->leaves.leaf = NULL;
+	iter->leaves.n = iter->leaves.pos = 0;
+#else
+	treeStackFree(&iter->stack);
+#endif
 }
 
 
 /**
- * @brief heapSorts a given movie_t pointer Array based on their scores
- * @return returns void
+ * @brief Returns the name of a category as the events print it
+ * @return returns the name
 */
-void heapSort(movie_t **helperMovieArray, int d)
+const char *categoryName(int category)
 {
-    // Begin by heapifying the entire array
-    for(int i = d/2 -1; i >= 0; i--)
-    {
-        heapify(helperMovieArray, d, i);
-    }
-
-    // Then the associated tree Root gets swapped with the last array score and heapification is repeated for the reduced heap
-     for(int i = d-1; i>0; i--)
-     {
-        movie_t *temp = helperMovieArray[0];
-        helperMovieArray[0] = helperMovieArray[i];
-        helperMovieArray[i] = temp;
-
-        // Reheapification of reduced heap 
-        heapify(helperMovieArray, i, 0);
-     }
+	static const char *names[6] = {"HORROR", "SCIENCE-FICTION", "DRAMA", "ROMANCE", "DOCUMENTARY", "COMEDY"};
+	if(category < 0 || category >= 6) return "UNKNOWN";
+	return names[category];
 }
 
 
 /**
- * @brief Traverses a movie_t tree InOrder and adds a movie to helperMovieArray if movie_score exceeds the provided score
- * @return returns void
+ * @brief Starts a read of the category trees and fills roots with the trees to read.
+ * Pins the latest version with CATALOG_VERSIONS, enters the catalog epoch otherwise
+ * @return returns the pinned version to hand to catalogReadEnd(), NULL when reading the live trees
 */
-void inOrderAddBasedOnScore(movie_t *movie, float score, movie_t **helperMovieArray, int *index)
+catalogVersion_t *catalogReadBegin(movie_t *roots[6])
 {
-	if(movie->Info->movieID == -1) return;
-	inOrderAddBasedOnScore(movie->lc, score, helperMovieArray, index);
-	inOrderAddBasedOnScore(movie->rc, score, helperMovieArray, index);
-
-	// Check if current movie has a greater score than score parameter 
-	//and add at the helperMovieArray at the given index location while increasing index by 1
-	float mv_score = (float)movie->Info->sumScore / (float)movie->Info->watchedCounter;
-	if(mv_score >= score)
-	{
-		helperMovieArray[(*index)] = movie;
-		(*index) = (*index) + 1;
-	}
-	return;
+#ifdef CATALOG_VERSIONS
+	catalogVersion_t *version = versionPin(&catalog->versions);
+	for(int i=0; i<6; i++) roots[i] = version->roots[i];
+	return version;
+#else
+	epochEnter(&catalog->epoch);
+	for(int i=0; i<6; i++) roots[i] = catalog->categoryArray[i] != NULL ? EPOCH_READ(catalog->categoryArray[i]->movie) : NULL;
+	return NULL;
+#endif
 }
 
 
 /**
- * @brief Returns the total amount of movies found in the movieCategoryArray Trees
- * @return the number of movies
+ * @brief Ends a read started with catalogReadBegin()
+ * @return returns void
 */
-int getNumberOfMovies(void)
+void catalogReadEnd(catalogVersion_t *version)
 {
-	int n_movies = 0;
-	for(int categ = 0; categ < 6; categ++)
-	{
-		if(categoryArray[categ] != NULL)
-		{
-			inOrderCountMovies(categoryArray[categ]->movie, &n_movies);
-		}
-	}
-
-	return n_movies;
+#ifdef CATALOG_VERSIONS
+	versionUnpin(&catalog->versions, version);
+#else
+	(void)version;
+	epochExit(&catalog->epoch);
+#endif
 }
 
 
@@ -1348,13 +3286,12 @@ int getNumberOfMovies(void)
 */
 void inOrderCountMovies(movie_t *movie, int *n_movies)
 {
-	if(movie->Info->movieID == -1) return;
-	inOrderCountMovies(movie->lc, n_movies);
-	inOrderCountMovies(movie->rc, n_movies);
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_IN, movie);
 
-	// Increase the movie count by 1
-	(*n_movies) = (*n_movies) + 1;
-	return;
+	// Increase the movie count by 1 per node
+	while(treeWalkNext(&walk) != NULL) (*n_movies) = (*n_movies) + 1;
+	treeWalkEnd(&walk);
 }
 
 
@@ -1364,12 +3301,18 @@ void inOrderCountMovies(movie_t *movie, int *n_movies)
 */
 void inOrderFindStats(userMovie_t *movie, int *scoreSum, int *counter)
 {
-	if(movie == NULL) return;
-	inOrderFindStats(movie->lc, scoreSum, counter);
-	inOrderFindStats(movie->rc, scoreSum, counter);
-	(*scoreSum) = (*scoreSum) + movie->Info->sumScore;
-	(*counter) = (*counter) + 1;
-	return;
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		// Only the leaves are watched movies. Internal nodes are routing copies
+		if(node->lc == NULL && node->rc == NULL)
+		{
+			(*scoreSum) = (*scoreSum) + node->Info->sumScore;
+			(*counter) = (*counter) + 1;
+		}
+	}
+	treeWalkEnd(&walk);
 }
 
 
@@ -1380,30 +3323,27 @@ void inOrderFindStats(userMovie_t *movie, int *scoreSum, int *counter)
 int PrintUserMovies(int userID)
 {
 	// Return 0 if userId > max_id
-	if(userID > max_id)
+	if(userID > catalog->max_id)
 	{
-		printf("UserID: %d is larger than max_id: %d\n", userID, max_id);
+		printf("UserID: %d is larger than max_id: %d\n", userID, catalog->max_id);
 		return 0;
 	} 
 
 	//Check if the User Already Exists
-	if(!existsUser(userID))
+	epochEnter(&catalog->epoch);
+	user_t *user = userTableFind(&catalog->userTable, userID);
+	if(user == NULL)
 	{
+		epochExit(&catalog->epoch);
 		printf("User with userID: %d does not exist\n", userID);
 		return -1;
 	}
 
-	// Generate Key using a call to the hash function
-	int key = hash_function(a, b, userID, m, p);
-
-	// Access Last User on appropriate Hash Table cell chain and add newUser
-	user_t *user;
-
-
-	// Otherwise find chain tail
-	for(user = user_hashtable_p[key]; user->next != NULL; user = user->next);
 	printf("User %d: ", user->userID);
-	InOrderPrintUserMovies(user->history);
+	userMovie_t *history = EPOCH_READ(user->history);
+	if(history != NULL) InOrderPrintUserMovies(history);
+	else for(int i=0; i < user->n_snapshot; i++) printf("%d, ", user->snapshot[i].movieID);
+	epochExit(&catalog->epoch);
 	printf("\n\n");
 
 	return 1; // Success
@@ -1416,11 +3356,13 @@ int PrintUserMovies(int userID)
 */
 void InOrderPrintUserMovies(userMovie_t *movie)
 {
-	if(movie == NULL) return;
-	InOrderPrintUserMovies(movie->lc);
-	InOrderPrintUserMovies(movie->rc);
-	if(movie->rc == NULL && movie->lc == NULL) 	printf("%d, ", movie->Info->movieID);
-	return;
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(node->rc == NULL && node->lc == NULL) printf("%d, ", node->Info->movieID);
+	}
+	treeWalkEnd(&walk);
 }
 
 
@@ -1430,9 +3372,11 @@ void InOrderPrintUserMovies(userMovie_t *movie)
 */
 void InOrderPrintUserMoviesEd2(userMovie_t *movie)
 {
-	if(movie == NULL) return;
-	InOrderPrintUserMoviesEd2(movie->lc);
-	InOrderPrintUserMoviesEd2(movie->rc);
-	if(movie->rc == NULL && movie->lc == NULL) 	printf("      %d %d\n", movie->Info->movieID, movie->Info->sumScore);
-	return;
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(node->rc == NULL && node->lc == NULL) printf("      %d %d\n", node->Info->movieID, node->Info->sumScore);
+	}
+	treeWalkEnd(&walk);
 }
@@ -14,6 +14,87 @@
 #include <stdint.h>
 #include <assert.h>
 
+#include "Epoch.h"
+#include "Bloom.h"
+#include "Versions.h"
+#include "SkipList.h"
+#include "BPlusTree.h"
+#include "YearIndex.h"
+#include "UserTable.h"
+#include "Snapshot.h"
+#include "Wal.h"
+#include "Checkpoint.h"
+#include "QueryCache.h"
+#include "Pool.h"
+#include "Eytzinger.h"
+#include "HotCache.h"
+#include "TreeWalk.h"
+#include "Server.h"
+
+/* Uncomment the following line to build the category trees as persistent, path copying
+ * trees whose published versions are pinned by readers (see Versions.h) */
+// #define CATALOG_VERSIONS
+
+/* Uncomment the following line to index the categories with lock-free skip lists instead
+ * of the sentinel BSTs (see SkipList.h) */
+// #define CATEGORY_SKIPLIST
+
+/* Uncomment the following line to index the categories with B+ trees of cache-line nodes and
+ * linked leaves instead of the sentinel BSTs (see BPlusTree.h) */
+// #define CATEGORY_BPTREE
+
+/* Uncomment the following line to lay every category out again in Eytzinger order after each D,
+ * for the lookups of I and W (see Eytzinger.h) */
+// #define CATEGORY_EYTZINGER
+
+/* Uncomment the following line to cache the records of the movies I and W look up most, in front of
+ * the category lookups the movie map can't answer (see HotCache.h) */
+// #define MOVIE_HOT_CACHE
+
+#if defined(CATALOG_VERSIONS) && defined(CATEGORY_SKIPLIST)
+#error "CATALOG_VERSIONS versions the category trees and can't be combined with CATEGORY_SKIPLIST"
+#endif
+
+#if defined(CATEGORY_BPTREE) && (defined(CATALOG_VERSIONS) || defined(CATEGORY_SKIPLIST))
+#error "CATEGORY_BPTREE replaces the category trees and can't be combined with CATALOG_VERSIONS or CATEGORY_SKIPLIST"
+#endif
+
+#if defined(CATEGORY_EYTZINGER) && (defined(CATALOG_VERSIONS) || defined(CATEGORY_SKIPLIST) || defined(CATEGORY_BPTREE))
+#error "CATEGORY_EYTZINGER lays out the records of the sentinel BSTs and can't be combined with CATALOG_VERSIONS, CATEGORY_SKIPLIST or CATEGORY_BPTREE"
+#endif
+
+#if defined(MOVIE_HOT_CACHE) && defined(CATALOG_VERSIONS)
+#error "MOVIE_HOT_CACHE caches the one record of each movie and can't be combined with CATALOG_VERSIONS"
+#endif
+
+/* Set when an index other than the sentinel BST holds the movies, the trees stay empty then */
+#if defined(CATEGORY_SKIPLIST) || defined(CATEGORY_BPTREE)
+#define CATEGORY_INDEX
+#endif
+
+/* Set when the category nodes link to their parents, so that W fixes the maxima up from the node of the movie.
+ * Versions share nodes between trees, so with CATALOG_VERSIONS W walks down to the movie instead */
+#if !defined(CATEGORY_INDEX) && !defined(CATALOG_VERSIONS)
+#define CATEGORY_PARENTS
+#endif
+
+#define MOVIE_NO_SCORE -1.0f		/* maxScore of a subtree without a rated movie */
+#define ALL_CATEGORIES 0x3f			/* Category bitmask selecting all six categories */
+#define MOVIE_FILTER_CAPACITY 1024	/* Movies the first movie filter is sized for */
+#define MOVIE_MAP_SIZE 1024			/* movieIDs the first movie map covers */
+#ifndef MOVIE_MAP_MAX
+#define MOVIE_MAP_MAX (1 << 20)		/* The movie map never covers movieIDs past it, override with -DMOVIE_MAP_MAX=<n> */
+#endif
+#define WATCH_BATCH 16				/* W events whose lookups are interleaved by watch_movies() */
+#define WATCH_BULK_SKIP 8			/* Movies watch_bulk() steps over in an index before it seeks the next rated one instead */
+#ifndef USER_POOL_WATCHED
+#define USER_POOL_WATCHED 32			/* Watched movies the history pool is budgeted for per user, override with -DUSER_POOL_WATCHED=<n> */
+#endif
+#define USER_POOL_HISTORY (2 * USER_POOL_WATCHED - 1)	/* History nodes per user: a history of n movies has n leaves and n-1 inner nodes */
+#define MOVIE_MAP_UNKNOWN -3		/* The movie map can't tell where the movie is, look it up in the trees */
+#define MOVIE_MAP_ABSENT -2			/* No movie has the movieID */
+#define MOVIE_MAP_NEW -1			/* The movie is a new release */
+
 
 typedef enum {
 	HORROR,
@@ -45,6 +126,13 @@ typedef struct movie{
 	movieInfo_t *Info; /* Pointer to the movieInfo_t struct */
 	struct movie *lc;	/* Pointer to the node's left child*/
 	struct movie *rc;	/* Pointer to the node's right child*/
+	float maxScore;		/* The highest average score in the subtree, MOVIE_NO_SCORE if none is rated */
+#ifdef CATEGORY_PARENTS
+	struct movie *parent;	/* Pointer to the node's parent, NULL at the root */
+#endif
+#ifdef CATALOG_VERSIONS
+	uint64_t version;	/* The draft that created the node. Nodes of published versions are never modified */
+#endif
 }movie_t;
 
 
@@ -69,6 +157,15 @@ typedef struct movie_info_user
 typedef struct movie_category_array{
 	movie_t *movie;
 	movie_t *sentinel;
+#ifdef CATEGORY_SKIPLIST
+	skipList_t *index;	/* The skip list indexing the category instead of the tree */
+#elif defined(CATEGORY_BPTREE)
+	bpTree_t *index;	/* The B+ tree indexing the category instead of the tree */
+#endif
+	yearIndex_t years;	/* The movies of the category by release year */
+#ifdef CATEGORY_EYTZINGER
+	eytzinger_t *layout;	/* The movies of the tree in Eytzinger order, NULL while a D changes the tree */
+#endif
 }movieCategoryArray_t;
 
 /**
@@ -90,9 +187,33 @@ typedef struct user {
 	int userID; 			/* The user's identifier*/
 	userMovie_t *history;	/* A doubly linked binary tree with the movies watched by the user*/
 	struct user *next;		/* Pointer to the next node of the chain*/	
+	const snapshotLeaf_t *snapshot;	/* The watched movies in the loaded snapshot while history is still NULL */
+	int n_snapshot;					/* The number of them */
+	uint64_t version;				/* Changes with every W of the user, tags its cached Q result */
 }user_t;
 
 
+/**
+* Structure defining a history node along with its info, allocated as one object
+*/
+typedef struct user_movie_record
+{
+	userMovie_t node;		/* node.Info points at info */
+	movieInfoUser_t info;
+}userMovieRecord_t;
+
+
+/**
+* Structure defining the pools the user records and history nodes come from, sized by max_users
+*/
+typedef struct user_pools
+{
+	poolRegion_t region;	/* The mapping both pools are carved from, unmapped until max_users is known */
+	pool_t users;			/* user_t records, twice max_users so that a resize has room for its copies */
+	pool_t history;			/* userMovieRecord_t objects, USER_POOL_HISTORY per user */
+}userPools_t;
+
+
 ///////////////////////// EXTRA STRUCTS ///////////////////////////
 // New movies Tree struct
 typedef struct new_movie
@@ -128,52 +249,194 @@ typedef struct heap_tree
 }heapTree_t;
 
 
-extern movieCategoryArray_t *categoryArray[6];  /* The categories array (pinakas kathgoriwn)*/
-extern user_t **user_hashtable_p;		   /* The users hashtable. This is an array of chains (pinakas katakermatismoy xrhstwn)*/
-extern newMoviesTree_t newMoviesTree;      /* The new movies Tree struct */
-extern int hashtable_size;				   /* The size of the users hashtable, parsed from the command line (>0)*/
-extern int max_users;					   /* The maximum number of registrations (users)*/			
-extern int max_id;   			   /* The maximum account ID */
-extern int primes_g[160];
-extern int a;
-extern int b;
-extern int m;
-extern int p;
+// A W event handed to watch_movies() or watch_bulk()
+typedef struct watch_event
+{
+	int userID;
+	int category;
+	int movieID;
+	int score;
+	int result;			/* What watch_movie() returned for the event */
+}watchEvent_t;
 
 
+// In-order iterator over a category, whichever index backs it
+typedef struct category_iter
+{
+#ifdef CATEGORY_SKIPLIST
+	skipNode_t *node;	/* The next node to return */
+#elif defined(CATEGORY_BPTREE)
+	bpIter_t leaves;	/* The walk over the leaves */
+#else
+	treeStack_t stack;	/* The nodes whose left subtree has been walked but not themselves, deepest on top */
+#endif
+	int failed;			/* Set if the walk stopped early on malloc failure */
+}categoryIter_t;
+
+
+// Where the movie of a movieID is, whatever tree holds it
+typedef struct movie_slot
+{
+	movieInfo_t *info;	/* The record of a categorized movie, NULL with CATALOG_VERSIONS where every version has its own */
+#ifdef CATEGORY_PARENTS
+	struct movie *node;	/* The category node holding the record */
+#endif
+	int where;			/* The category, MOVIE_MAP_NEW or MOVIE_MAP_UNKNOWN, minus MOVIE_MAP_ABSENT so that a zeroed slot is absent */
+}movieSlot_t;
+
+
+// Direct map of the movieIDs from 0 to size-1. Movies are never removed, so a slot only goes from absent
+// to new to categorized, or to unknown once a second movie gets the same movieID
+typedef struct movie_map
+{
+	int size;				/* The number of slots */
+	movieSlot_t slots[];
+}movieMap_t;
+
+
+// The movies a user has watched in ascending movieID, probed by a stream of candidates
+typedef struct watched_set
+{
+	int *ids;		/* The watched movieIDs, ascending */
+	int n;			/* The number of them */
+	int cursor;		/* The first id not below the last probe, where the next probe starts */
+}watchedSet_t;
+
+
+/**
+* Structure defining a catalog: the movies, the users and everything that indexes or caches them.
+* Catalogs share nothing, so each can be driven by a thread of its own
+*/
+typedef struct catalog
+{
+	movieCategoryArray_t *categoryArray[6];  /* The categories array (pinakas kathgoriwn)*/
+	userTable_t userTable;		   /* The users hashtable. This is an array of chains (pinakas katakermatismoy xrhstwn)*/
+	newMoviesTree_t newMoviesTree;      /* The new movies Tree struct */
+	int hashtable_size;				   /* The size of the users hashtable, parsed from the command line (>0)*/
+	int max_users;					   /* The maximum number of registrations (users)*/
+	int registrations;				   /* Users registered or being registered. R reserves one before inserting, U gives one back */
+	int max_id;   			   /* The maximum account ID */
+	int a, b, m, p;					   /* The parameters of hash_function(), m is the first hashtable_size */
+	epochDomain_t epoch;			   /* Defers freeing of unlinked nodes until concurrent readers are done with them */
+	snapshot_t snapshot;		   /* The snapshot the state was loaded from, if any */
+	queryCache_t queryCache;			   /* The cached results of the F and Q events */
+	bloom_t *movieFilter;			   /* The movieIDs of the new releases and the categories */
+	movieMap_t *movieMap;			   /* Where the movie of every small movieID is */
+	userPools_t userPools;			   /* Where the users and their history nodes are allocated from */
+#ifdef MOVIE_HOT_CACHE
+	hotCache_t movieHotCache;		   /* The records of the movies looked up most */
+#endif
+#ifdef CATALOG_VERSIONS
+	catalogVersions_t versions;  /* The published versions of the category trees */
+#endif
+}catalog_t;
+
 
 
 //////////////////////////////////////////////////////////////////////
 
 
+/**
+ * @brief Creates an empty catalog, or one restored from a snapshot.
+ * The new catalog becomes the calling thread's catalog. On failure whatever was made is freed
+ * and the calling thread keeps its previous catalog.
+ *
+ * @param loadPath The snapshot to restore, NULL for an empty catalog
+ *
+ * @return the catalog on success
+ *         NULL on failure
+ */
+
+ catalog_t *catalogCreate(const char *loadPath);
+
+/**
+ * @brief Makes a catalog the one the calling thread works on.
+ *
+ * @param instance The catalog
+ *
+ * @return the thread's previous catalog
+ */
+
+ catalog_t *catalogUse(catalog_t *instance);
+
+/**
+ * @brief Frees a catalog and everything in it, also one that failed to initialize. No other thread may use it.
+ *
+ * @param instance The catalog
+ */
+
+ void catalogDestroy(catalog_t *instance);
+
+/**
+ * @brief Sets the maximum number of registrations and preallocates the users and their histories for them.
+ *
+ * @param instance The catalog
+ * @param maxUsers The maximum number of registrations
+ *
+ * @return 1 on success
+ *         0 if the users could not be preallocated
+ */
+
+ int catalogSetMaxUsers(catalog_t *instance, int maxUsers);
+
+/**
+ * @brief Sets the maximum account ID, which the users hashtable indexes directly if it is small enough.
+ *
+ * @param instance The catalog
+ * @param maxID The maximum account ID
+ */
+
+ void catalogSetMaxID(catalog_t *instance, int maxID);
+
+/**
+ * @brief Returns the LSN of the first event after the snapshot the catalog was restored from.
+ *
+ * @param instance The catalog
+ *
+ * @return the LSN, 0 if the catalog was not restored from a snapshot
+ */
+
+ uint64_t catalogSnapshotLsn(catalog_t *instance);
+
+/**
+ * @brief Publishes the changes to the category trees since the last version, if built with CATALOG_VERSIONS.
+ *
+ * @param instance The catalog
+ */
+
+ void catalogPublish(catalog_t *instance);
+
 /**
  * @brief Creates a new user.
  * Creates a new user with userID as its identification.
  *
+ * @param instance The catalog the event goes to
  * @param userID The new user's identification
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int register_user(int userID);
+ int register_user(catalog_t *instance, int userID);
  
 /**
  * @brief Deletes a user.
  * Deletes a user with userID from the system, along with users' history tree.
  *
+ * @param instance The catalog the event goes to
  * @param userID The new user's identification
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int unregister_user(int userID);
+ int unregister_user(catalog_t *instance, int userID);
  
  /**
  * @brief Add new movie to new release binary tree.
  * Create a node movie and insert it in 'new release' binary tree.
  *
+ * @param instance The catalog the event goes to
  * @param movieID The new movie identifier
  * @param category The category of the movie
  * @param year The year movie released
@@ -182,20 +445,23 @@ extern int p;
  *         0 on failure
  */
 
- int add_new_movie(int movieID, int category, int year);
+ int add_new_movie(catalog_t *instance, int movieID, int category, int year);
  
  /**
  * @brief Distribute the movies from new release binary tree to the array of categories.
  *
+ * @param instance The catalog the event goes to
+ *
  * @return 1 on success
  *         0 on failure
  */
 
- int distribute_movies(void);
+ int distribute_movies(catalog_t *instance);
  
  /**
  * @brief User rates the movie with identification movieID with score
  *
+ * @param instance The catalog the event goes to
  * @param userID The identifier of the user
  * @param category The Category of the movie
  * @param movieID The identifier of the movie
@@ -205,11 +471,41 @@ extern int p;
  *         0 on failure
  */
 
- int watch_movie(int userID, int category,int movieID, int score);
+ int watch_movie(catalog_t *instance, int userID, int category,int movieID, int score);
+ 
+ /**
+ * @brief Handles a run of W events as watch_movie() would one after the other. The lookups of all of them
+ * are first advanced together, a cache miss at a time, so that their misses overlap
+ *
+ * @param instance The catalog the event goes to
+ * @param events The events, whose results are stored in them
+ * @param n The number of events, at most WATCH_BATCH
+ *
+ * @return void
+ */
+
+ void watch_movies(catalog_t *instance, watchEvent_t *events, int n);
+ 
+ /**
+ * @brief Applies a bulk of ratings, leaving the catalog and the histories as the W events of them would one after
+ * the other, and storing in each what watch_movie() would have returned for it. The ratings are sorted by
+ * (category, movieID) and each category is updated in one merged walk, then sorted by (userID, movieID)
+ * and each history is rebuilt in one pass. Nothing is printed but what userFind() reports of missing users
+ *
+ * @param instance The catalog the event goes to
+ * @param events The ratings, whose results are stored in them
+ * @param n The number of ratings
+ *
+ * @return 1 on success
+ *         0 on malloc failure, before any rating is applied
+ */
+
+ int watch_bulk(catalog_t *instance, watchEvent_t *events, int n);
  
 /**
  * @brief Identify the best rating score movie and cluster all the movies of a category.
  *
+ * @param instance The catalog the event goes to
  * @param userID The identifier of the user
  * @param score The minimum score of a movie
  *
@@ -217,22 +513,24 @@ extern int p;
  *         0 on failure
  */
 
- int filter_movies(int userID, float score);
+ int filter_movies(catalog_t *instance, int userID, float score);
 
 /**
  * @brief Find the median score that user rates movies.
  *
+ * @param instance The catalog the event goes to
  * @param userID The identifier of the user
  *
  * @return 1 on success
  *         0 on failure
  */
 
- int user_stats(int userID);
+ int user_stats(catalog_t *instance, int userID);
  
 /**
  * @brief Search for a movie with identification movieID in a specific category.
  *
+ * @param instance The catalog the event goes to
  * @param movieID The identifier of the movie
  * @param category The category of the movie
  *
@@ -240,300 +538,99 @@ extern int p;
  *         0 on failure
  */
 
- int search_movie(int movieID, int category);
+ int search_movie(catalog_t *instance, int movieID, int category);
  
  /**
  * @brief Prints the movies in movies categories array.
+ * @param instance The catalog the event goes to
+ *
  * @return 1 on success
  *         0 on failure
  */
 
- int print_movies(void);
+ int print_movies(catalog_t *instance);
  
   /**
  * @brief Prints the users hashtable.
+ * @param instance The catalog the event goes to
+ *
  * @return 1 on success
  *         0 on failure
  */
-
- int print_users(void);
  
+ int print_users(catalog_t *instance);
+ 
+ /**
+ * @brief Prints the movies of a category whose movieID lies in [lo, hi], in ascending order.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param lo The smallest movieID to print
+ * @param hi The largest movieID to print
+ * @param limit The maximum number of movies to print, 0 for no limit
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
 
-/* Extra functions */
-
-/**
- * @brief Implements the universal hash function given all parameters
- * @return int: the key
-*/
-
-int hash_function(int a, int b, int x, int m, int p);
-
-
-
-/**
- * @brief Makes a new user of userID
- * @return user_t*: a pointer to the new user struct
-*/
-user_t* makeNewUser(int userID);
-
-
-/**
- * @brief Initializes Hash Table with null Pointers
- * @return 1 on Success 0 on malloc failure
-*/
-int makeHashTable(void);
-
-
-/**
- * @brief Initializes Hash Table with null Pointers
- * @return void
-*/
-void initHashTable(void);
-
-
-/**
- * @brief Deletes Hash Table
- * @return void
-*/
-void deleteHashTable(void);
-
-
-/**
- * @brief Deletes Hash Table cell chain
- * @return void
-*/
-void deleteUserChainIter(user_t*);
-
-
-/**
- * @brief Checks if a given User exists
- * @return returns 1 if True, 0 if False
-*/
-int existsUser(int userID);
-
-
-/**
- * @brief Initialize newMoviesTree with NULL root
- * @return returns void
-*/
-void initNewMoviesTree(void);
-
-
-/**
- * @brief Create New Movie for NewMovies Tree
- * @return returns newMovie_t struct pointer
-*/
-newMovie_t* makeNewMovie(int movieID, int category, int year);
-
-
-/**
- * @brief Checks whether the given movie exists or not (using the MovieID)
- * @return returns 1 if True, 0 otherwise
-*/
-int existsNewMovie(int movieID);
-
-
-
-/**
- * @brief Recursive Function that traverses the newMoviesTree and checks if a given movie exists
- * @return returns 1 if Movie is found, 0 otherwise
-*/
-int InOrderFoundNewMovieTree(newMovie_t* newMovieNode, int movieID);
-
-
-/**
- * @brief InOrder Traversal of newMovieTree that prints the movieIDs
- * @return returns 1 if Movie is found, 0 otherwise
-*/
-void InOrderPrintNewMovieTree(newMovie_t *newMovieNode);
-
-
-/**
- * @brief delete the newMoviesTree
- * @return returns void
-*/
-void deleteNewMoviesTree();
-
-
-/**
- * @brief delete the newMoviesTree recursive PostOrder function
- * @return returns void
-*/
-void deleteNewMoviesTreeIter(newMovie_t *newMovieNode);
-
-
-/**
- * @brief Initializes the movie Category Array with sentinel nodes
- * @return returns void
-*/
-int initMovieCategoryArray();
-
-
-/**
- * @brief Makes a regular movie_t struct object
- * @return returns 1 upon success, 0 upon malloc failure
-*/
-movie_t* makeMovie(int movieId, int year);
-
-
-/**
- * @brief Performs inOrder newMovieTree traversal and for each node it visits it calls the function distsributeMovie()
- * that is responsible for creating and placing the corresponding movie in the appropriate BST of the movieCategoryArray
- * @note: IF A MOVIE TRANSFER FAILS WE HAVE TO STOP THE PROCESS. OTHERWISE WE MIGHT END UP WITH A CORRUPTED TREE 
- * @return returns void
-*/
-int postOrderDistribute(newMovie_t *newMovie);
-
-
-/**
- * @brief Distributes the given movie to the appropriate place and tree of the movieCategoryArray
- * @return returns 1 upon success, 0 upon failure
-*/
-int DistributeMovie(newMovie_t *newMovie);
-
-
-/**
- * @brief Checks if the movie already exists in the movie category array trees (Assuming movieID-category pair is correct)
- * @return returns 1 if True, 0 if False
-*/
-int newMovieExistsInCategoryArray(int movieID, int category);
-
-
-/**
- * @brief Prints the BSTs of the movie category array Inorder
- * @return returns void
-*/
-void inOrderMoviePrint(movie_t *movie);
-
-
-/**
- * @brief destroy movieCategoryArray and Subtrees
- * @return returns void
-*/
-void deleteMovieCategoryArray();
-
-
-/**
- * @brief Recursively Frees BST nodes using PostOrder Traversal
- * @return returns void
-*/
-void PostOrderMovieDelete(movie_t *movie);
-
-
-/**
- * @brief Assigns the user of UID for the given user  parameter.
- * @return returns 1 if user exists, 0 otherwise
-*/
-int userFind(int userID, user_t **user);
-
-
-
-/**
- * @brief edits the Movie with movieID given the user's score
- * @return returns 1 if movie exists, 0 otherwise
-*/
-int editeMovie(int movieID, int score, int category);
-
-
-/**
- * @brief adds the given movie to the user History Tree
- * @return returns 1 on success, 0 otherwise
-*/
-int addMovieToUser(user_t** user, int category, int movieID, int score);
-
-
-/**
- * @brief makes a new usermovie_t object and fills it in
- * @return returns 1 on success, 0 otherwise
-*/
-userMovie_t *makeNewUserMovie(int movieID, int category, int score);
-
-
-/**
- * @brief Makes a copy user movie object from the passed in object
- * @return returns NULL on failure, userMovie_t* on success
-*/
-userMovie_t* userMovieCopy(userMovie_t *userMovie);
-
-
-/**
- * @brief Frees the History tree associated with one user using PostOrder Tree Traversal
- * @return returns NULL on failure, userMovie_t* on success
-*/
-void freeUserHistoryTree(userMovie_t *userMovie);
-
-
-
-/**
- * @brief Traverse the History Tree Inorder and prints the leaves
- * @return returns NULL on failure, userMovie_t* on success
-*/
-void InOrderPrintHistoryTreeLeaves(userMovie_t *root);
-
-
-/**
- * @brief Heapifies movieHelperArray with size d from index i
- * @return returns void
-*/
-void heapify(movie_t **helperMovieArray, int d, int i);
-
-
-/**
- * @brief heapSorts a given movie_t pointer Array based on their scores
- * @return returns void
-*/
-void heapSort(movie_t **helperMovieArray, int d);
-
-
-/**
- * @brief Traverses a movie_t tree InOrder and adds a movie to helperMovieArray if movie_score exceeds the provided score
- * @return returns void
-*/
-void inOrderAddBasedOnScore(movie_t *movie, float score, movie_t **helperMovieArray, int *index);
-
-
-/**
- * @brief Returns the total amount of movies found in the movieCategoryArray Trees
- * @return the number of movies
-*/
-int getNumberOfMovies(void);
-
-
-/**
- * @brief Returns the total amount of movies found in the movieCategoryArray Trees
- * @return the number of movies
-*/
-void inOrderCountMovies(movie_t *movie, int *n_movies);
-
-
-/**
- * @brief Edits scoreSum and counter int pointers according to the sum of scores of the user and the movie count
- * @return returns void
-*/
-void inOrderFindStats(userMovie_t *movie, int *scoreSum, int *counter);
-
-
-/**
- * @brief Prints Movies in the history tree of user UserID
- * @return returns 1 on Success, 0 on failure
-*/
-int PrintUserMovies(int userID);
-
-
-/**
- * @brief InOrder Print user History Tree movies
- * @return returns void
-*/
-void InOrderPrintUserMovies(userMovie_t *movie);
+ int range_movies(catalog_t *instance, int category, int lo, int hi, int limit);
+ 
+ /**
+ * @brief Prints the movies of a category released from fromYear to toYear, by ascending year.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param fromYear The first year to print
+ * @param toYear The last year to print
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
 
+ int year_movies(catalog_t *instance, int category, int fromYear, int toYear);
+ 
+ /**
+ * @brief Counts the movies of a category released from fromYear to toYear, in buckets of width years.
+ *
+ * @param instance The catalog the event goes to
+ * @param category The category of the movies
+ * @param fromYear The first year to count
+ * @param toYear The last year to count
+ * @param width The number of years of every bucket, 0 for a single bucket
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
 
+ int count_movies_by_year(catalog_t *instance, int category, int fromYear, int toYear, int width);
+ 
 /**
- * @brief InOrder Print user History Tree movies
- * @return returns void
-*/
-void InOrderPrintUserMoviesEd2(userMovie_t *movie);
+ * @brief Like filter_movies(), only for the movies of some categories released from fromYear to toYear.
+ *
+ * @param instance The catalog the event goes to
+ * @param userID The identifier of the user
+ * @param score The minimum score of a movie
+ * @param categories Bitmask of the categories to search, bit i for category i
+ * @param fromYear The first year of release
+ * @param toYear The last year of release
+ * @param unwatched Set to leave out the movies the user has watched
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
 
+ int filter_movies_in(catalog_t *instance, int userID, float score, int categories, int fromYear, int toYear, int unwatched);
+ 
+ /**
+ * @brief Prints the hits and misses of the F and Q result cache.
+ * @param instance The catalog the event goes to
+ *
+ * @return 1 on success
+ *         0 on failure
+ */
 
+ int cache_stats(catalog_t *instance);
+ 
 
  #endif
 
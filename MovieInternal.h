@@ -0,0 +1,586 @@
+/*****************************************************
+ * @file   MovieInternal.h                            *
+ *                                                   *
+ * @brief Helpers shared by the library sources      *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef MOVIE_INTERNAL_FILE
+#define MOVIE_INTERNAL_FILE
+
+#include "Movie.h"
+#include "Tree.h"
+
+
+/*
+ * What the sources of the library share but a program linked against it doesn't need: the catalog of
+ * the calling thread, which every helper below works on, and the helpers themselves. Programs include
+ * Movie.h and pass the catalog_t * that catalogCreate() returned to the events.
+ */
+
+
+// Hidden, so that the shared library doesn't export it. Programs pass their catalog to the events instead
+extern _Thread_local catalog_t *catalog __attribute__((visibility("hidden")));	/* The catalog the calling thread works on, set by catalogUse() */
+
+
+// The trees of movies, keyed by movieID. The category trees end in the sentinel all categories share
+#define TREE_MOVIE_ID(node) ((node)->Info->movieID)
+TREE_DEFINE(newMovie, newMovie_t, int, TREE_MOVIE_ID, TREE_CMP_INT, NULL)
+TREE_DEFINE(movie, movie_t, int, TREE_MOVIE_ID, TREE_CMP_INT, catalog->categoryArray[0]->sentinel)
+TREE_DEFINE_LEAF(history, userMovie_t, int, TREE_MOVIE_ID, TREE_CMP_INT, NULL)
+
+
+
+/* Extra functions */
+
+/**
+ * @brief Implements the universal hash function given all parameters
+ * @return int: the key
+*/
+
+int hash_function(int a, int b, int x, int m, int p);
+
+
+
+/**
+ * @brief Makes a new user of userID
+ * @return user_t*: a pointer to the new user struct
+*/
+user_t* makeNewUser(int userID);
+
+
+/**
+ * @brief Frees a user record made by makeNewUser(), but not its history
+ * @return void
+*/
+void freeUser(user_t *user);
+
+
+/**
+ * @brief Maps the user pools for maxUsers users, once max_users is known. Later calls keep the first pools
+ * @return 1 on Success 0 if the pools can't be mapped, in which case users are malloc'd
+*/
+int reserveUsers(int maxUsers);
+
+
+/**
+ * @brief Initializes Hash Table with null Pointers
+ * @return 1 on Success 0 on malloc failure
+*/
+int makeHashTable(void);
+
+
+/**
+ * @brief Initializes Hash Table with null Pointers
+ * @return void
+*/
+void initHashTable(void);
+
+
+/**
+ * @brief Deletes Hash Table
+ * @return void
+*/
+void deleteHashTable(void);
+
+
+/**
+ * @brief Deletes Hash Table cell chain
+ * @return void
+*/
+void deleteUserChainIter(user_t*);
+
+
+/**
+ * @brief Checks if a given User exists
+ * @return returns 1 if True, 0 if False
+*/
+int existsUser(int userID);
+
+
+/**
+ * @brief Initialize newMoviesTree with NULL root
+ * @return returns void
+*/
+void initNewMoviesTree(void);
+
+
+/**
+ * @brief Create New Movie for NewMovies Tree
+ * @return returns newMovie_t struct pointer
+*/
+newMovie_t* makeNewMovie(int movieID, int category, int year);
+
+
+/**
+ * @brief Checks whether the given movie exists or not (using the MovieID)
+ * @return returns 1 if True, 0 otherwise
+*/
+int existsNewMovie(int movieID);
+
+
+
+/**
+ * @brief InOrder Traversal of newMovieTree that prints the movieIDs
+ * @return returns 1 if Movie is found, 0 otherwise
+*/
+void InOrderPrintNewMovieTree(newMovie_t *newMovieNode);
+
+
+/**
+ * @brief delete the newMoviesTree
+ * @return returns void
+*/
+void deleteNewMoviesTree();
+
+
+/**
+ * @brief delete the newMoviesTree recursive PostOrder function
+ * @return returns void
+*/
+void deleteNewMoviesTreeIter(newMovie_t *newMovieNode);
+
+
+/**
+ * @brief Initializes the movie Category Array with sentinel nodes
+ * @return returns void
+*/
+int initMovieCategoryArray();
+
+
+/**
+ * @brief Makes a regular movie_t struct object
+ * @return returns 1 upon success, 0 upon malloc failure
+*/
+movie_t* makeMovie(int movieId, int year);
+
+
+/**
+ * @brief Performs inOrder newMovieTree traversal and for each node it visits it calls the function distsributeMovie()
+ * that is responsible for creating and placing the corresponding movie in the appropriate BST of the movieCategoryArray
+ * @note: IF A MOVIE TRANSFER FAILS WE HAVE TO STOP THE PROCESS. OTHERWISE WE MIGHT END UP WITH A CORRUPTED TREE 
+ * @return returns void
+*/
+int postOrderDistribute(newMovie_t *newMovie);
+
+
+/**
+ * @brief Distributes the given movie to the appropriate place and tree of the movieCategoryArray
+ * @return returns 1 upon success, 0 upon failure
+*/
+int DistributeMovie(newMovie_t *newMovie);
+
+
+/**
+ * @brief Checks if the movie already exists in the movie category array trees (Assuming movieID-category pair is correct)
+ * @return returns 1 if True, 0 if False
+*/
+int newMovieExistsInCategoryArray(int movieID, int category);
+
+
+/**
+ * @brief Prints the BSTs of the movie category array Inorder
+ * @return returns void
+*/
+void inOrderMoviePrint(movie_t *movie);
+
+
+/**
+ * @brief destroy movieCategoryArray and Subtrees
+ * @return returns void
+*/
+void deleteMovieCategoryArray();
+
+
+/**
+ * @brief Frees BST nodes using PostOrder Traversal
+ * @return returns void
+*/
+void PostOrderMovieDelete(movie_t *movie);
+
+
+/**
+ * @brief Checks the movie filter for a movieID. Safe to call concurrently with A
+ * @return returns 0 if no movie has movieID, 1 if one may have
+*/
+int movieMayExist(int movieID);
+
+
+/**
+ * @brief Adds a movieID to the movie filter before the movie becomes reachable, growing the filter first if it is full
+ * @return returns void
+*/
+void movieFilterAdd(int movieID);
+
+
+/**
+ * @brief Replaces the movie filter with one sized for capacity movies, holding every new release and categorized movie
+ * @return returns 1 on success, 0 on malloc failure (the old filter stays)
+*/
+int movieFilterRebuild(int capacity);
+
+
+/**
+ * @brief Makes a movie map of size absent slots
+ * @return returns the map, NULL on malloc failure
+*/
+movieMap_t *makeMovieMap(int size);
+
+
+/**
+ * @brief Looks a movieID up in the movie map. Safe to call concurrently with A and D
+ * @return returns the category of the movie, MOVIE_MAP_NEW, MOVIE_MAP_ABSENT or MOVIE_MAP_UNKNOWN, and sets *info
+ * (if info isn't NULL) to the record of a categorized movie when the backend keeps one record per movie, NULL otherwise,
+ * and *node (if node isn't NULL) to its category node with CATEGORY_PARENTS, NULL otherwise
+*/
+int movieMapFind(int movieID, movieInfo_t **info, movie_t **node);
+
+
+/**
+ * @brief Maps a movieID to the new releases before the movie becomes reachable, growing the map first if it doesn't cover it
+ * @return returns void
+*/
+void movieMapAdd(int movieID);
+
+
+/**
+ * @brief Maps a new release to the category it was distributed to, once it is linked there. node is the category
+ * node holding info, NULL for the index backends
+ * @return returns void
+*/
+void movieMapDistribute(int movieID, int category, movieInfo_t *info, movie_t *node);
+
+
+/**
+ * @brief Looks the record of a movie up in the hot movie cache, if built with MOVIE_HOT_CACHE. Sets *node (if node
+ * isn't NULL) to the category node of the record with CATEGORY_PARENTS when the cache has it, NULL otherwise
+ * @return returns the record, NULL on a miss or without the cache
+*/
+movieInfo_t *movieHotFind(int movieID, int category, movie_t **node);
+
+
+/**
+ * @brief Caches the record of a movie just found in its category, with its category node if the caller has it,
+ * if built with MOVIE_HOT_CACHE
+ * @return returns void
+*/
+void movieHotAdd(int movieID, int category, movieInfo_t *info, movie_t *node);
+
+
+/**
+ * @brief Frees the info of a category movie unless it is a record of the loaded snapshot
+ * @return returns void
+*/
+void freeMovieInfo(movieInfo_t *Info);
+
+
+/**
+ * @brief Assigns the user of UID for the given user  parameter. Call inside a read section or with the user's stripe locked
+ * @return returns 1 if user exists, 0 otherwise
+*/
+int userFind(int userID, user_t **user);
+
+
+/**
+ * @brief Locks the stripe of the user and assigns it to slot->user in the same probe. Reports a missing user as userFind() does
+ * @return returns the user with slot->stripe locked, NULL with nothing locked if it doesn't exist
+*/
+user_t *userLocate(int userID, userSlot_t *slot);
+
+
+/**
+ * @brief userLocate() for a user a finished probe looked up, whose result is taken unless users were registered
+ * or unregistered or the table was resized since. With probe NULL the user is looked up as userLocate() does
+ * @return returns the user with slot->stripe locked, NULL with nothing locked if it doesn't exist
+*/
+user_t *userLocateProbed(int userID, const userProbe_t *probe, userSlot_t *slot);
+
+
+
+/**
+ * @brief edits the Movie with movieID given the user's score
+ * @return returns 1 if movie exists, 0 otherwise
+*/
+int editeMovie(int movieID, int score, int category);
+
+
+/**
+ * @brief edits the category node of a movie the caller found, as editeMovie() does once it finds it
+ * @return returns 1 on success, 0 if no draft copy could be made
+*/
+int editeMovieNode(movie_t *curr, int score, int category);
+
+
+/**
+ * @brief adds the given movie to the user History Tree
+ * @return returns 1 on success, 0 otherwise
+*/
+int addMovieToUser(user_t** user, int category, int movieID, int score);
+
+
+/**
+ * @brief addMovieToUser() for a caller that already found the leaf of the history the movie goes next to,
+ * with the user's stripe locked since. With leaf NULL the leaf is searched for
+ * @return returns 1 on success, 0 otherwise
+*/
+int addMovieToUserAt(user_t** user, userMovie_t *leaf, int category, int movieID, int score);
+
+
+/**
+ * @brief Returns the History Tree of the user, building it first if it is still in the loaded snapshot.
+ * Only call with the user's stripe locked
+ * @return returns the root, NULL if the user has not watched any movies or on malloc failure
+*/
+userMovie_t *userHistory(user_t *user);
+
+
+/**
+ * @brief makes a new usermovie_t object and fills it in
+ * @return returns 1 on success, 0 otherwise
+*/
+userMovie_t *makeNewUserMovie(int movieID, int category, int score);
+
+
+/**
+ * @brief Makes a copy user movie object from the passed in object
+ * @return returns NULL on failure, userMovie_t* on success
+*/
+userMovie_t* userMovieCopy(userMovie_t *userMovie);
+
+
+/**
+ * @brief Frees the History tree associated with one user using PostOrder Tree Traversal
+ * @return returns NULL on failure, userMovie_t* on success
+*/
+void freeUserHistoryTree(userMovie_t *userMovie);
+
+
+
+/**
+ * @brief Epoch reclaim function for unregistered users. Frees the user along with its History tree
+ * @return returns void
+*/
+void reclaimUser(void *user);
+
+
+/**
+ * @brief Epoch reclaim function for distributed new release nodes
+ * @return returns void
+*/
+void reclaimNewMovie(void *newMovie);
+
+
+/**
+ * @brief Traverse the History Tree Inorder and prints the leaves
+ * @return returns NULL on failure, userMovie_t* on success
+*/
+void InOrderPrintHistoryTreeLeaves(userMovie_t *root);
+
+
+/**
+ * @brief Traverses a movie_t tree InOrder and adds a movie to helperMovieArray if movie_score exceeds the provided score
+ * @return returns void
+*/
+void inOrderAddBasedOnScore(movie_t *movie, float score, movieInfo_t **helperMovieArray, int *index, int size);
+
+
+/**
+ * @brief Recomputes the maxScore of a category tree node from its info and its children
+ * @return returns void
+*/
+void movieUpdateMaxScore(movie_t *movie);
+
+
+/**
+ * @brief Recomputes the maxScore of every node on the path down to movieID, bottom-up, after its score changed
+ * @return returns void
+*/
+void movieFixMaxScore(movie_t *movie, int movieID);
+
+
+#ifdef CATEGORY_PARENTS
+/**
+ * @brief Recomputes the maxScore of a category tree node after its score changed, then of its ancestors up to the
+ * first one whose maxScore stays the same, since the ones above were computed from it
+ * @return returns void
+*/
+void movieFixMaxScoreUp(movie_t *movie);
+#endif
+
+
+/**
+ * @brief Returns the total amount of movies found in the given category trees
+ * @return the number of movies
+*/
+int getNumberOfMovies(movie_t *roots[6]);
+
+
+/**
+ * @brief Looks a movie up in a category, whichever index backs it. root is the tree to search (unused by the skip list and the B+ tree)
+ * @return returns the movie info, NULL if the movie isn't in the category
+*/
+movieInfo_t *categoryFind(int category, movie_t *root, int movieID);
+
+
+/**
+ * @brief Prints the movieIDs of a category in ascending order. root is the tree to print (unused by the skip list and the B+ tree)
+ * @return returns void
+*/
+void categoryPrint(int category, movie_t *root);
+
+
+/**
+ * @brief Counts the movies of a category. root is the tree to count (unused by the skip list and the B+ tree)
+ * @return returns the number of movies
+*/
+int categoryCount(int category, movie_t *root);
+
+
+#ifdef CATEGORY_EYTZINGER
+/**
+ * @brief Lays the current tree of a category out in Eytzinger order and publishes the layout
+ * @return returns 1 on success, 0 on malloc failure (lookups keep walking the tree)
+*/
+int categoryLayoutBuild(int category);
+
+
+/**
+ * @brief Unpublishes the layout of a category before its tree changes
+ * @return returns void
+*/
+void categoryLayoutDrop(int category);
+#endif
+
+
+/**
+ * @brief Adds the movies of a category whose score is at least score to helperMovieArray, up to size entries.
+ * root is the tree to scan (unused by the skip list and the B+ tree)
+ * @return returns void
+*/
+void categoryAddBasedOnScore(int category, movie_t *root, float score, movieInfo_t **helperMovieArray, int *index, int size);
+
+
+/**
+ * @brief Adds the movies of a category released from fromYear to toYear whose score is at least score to helperMovieArray,
+ * up to size entries, leaving out those in watched unless it is NULL. Drives the scan with the year index or the category,
+ * whichever holds fewer candidates. root is the tree to scan (unused by the skip list and the B+ tree)
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int categoryAddInYears(int category, movie_t *root, float score, int fromYear, int toYear, watchedSet_t *watched, movieInfo_t **helperMovieArray, int *index, int size);
+
+
+/**
+ * @brief Traverses a movie_t tree InOrder, skipping the subtrees below score, and adds the movies that pass score and are not in watched.
+ * Probing watched in ascending movieID makes the exclusion a merge with the history
+ * @return returns void
+*/
+void inOrderAddUnwatched(movie_t *movie, float score, watchedSet_t *watched, movieInfo_t **helperMovieArray, int *index, int size);
+
+
+/**
+ * @brief Fills the set with the movies the user has watched. Only call inside the catalog epoch
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int watchedSetBuild(watchedSet_t *watched, user_t *user);
+
+
+/**
+ * @brief Checks whether movieID is in the set. Probes in ascending movieID cost amortized O(1), others O(log n)
+ * @return returns 1 if True, 0 if False
+*/
+int watchedSetHas(watchedSet_t *watched, int movieID);
+
+
+/**
+ * @brief Frees the ids of a set filled by watchedSetBuild()
+ * @return returns void
+*/
+void watchedSetFree(watchedSet_t *watched);
+
+
+/**
+ * @brief Collects the movieIDs of the leaves of a History Tree InOrder, up to size of them
+ * @return returns void
+*/
+void inOrderCollectHistory(userMovie_t *movie, int *ids, int *n, int size);
+
+
+/**
+ * @brief Positions the iterator on the first movie of a category whose movieID is at least movieID.
+ * root is the tree to walk (unused by the skip list and the B+ tree)
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int categoryIterSeek(categoryIter_t *iter, int category, movie_t *root, int movieID);
+
+
+/**
+ * @brief Returns the movie under the iterator and moves it to the next one in ascending movieID
+ * @return returns the movie info, NULL past the last movie
+*/
+movieInfo_t *categoryIterNext(categoryIter_t *iter);
+
+
+/**
+ * @brief Releases an iterator positioned with categoryIterSeek()
+ * @return returns void
+*/
+void categoryIterEnd(categoryIter_t *iter);
+
+
+/**
+ * @brief Returns the name of a category as the events print it
+ * @return returns the name
+*/
+const char *categoryName(int category);
+
+
+/**
+ * @brief Starts a read of the category trees and fills roots with the trees to read.
+ * Pins the latest version with CATALOG_VERSIONS, enters the catalog epoch otherwise
+ * @return returns the pinned version to hand to catalogReadEnd(), NULL when reading the live trees
+*/
+catalogVersion_t *catalogReadBegin(movie_t *roots[6]);
+
+
+/**
+ * @brief Ends a read started with catalogReadBegin()
+ * @return returns void
+*/
+void catalogReadEnd(catalogVersion_t *version);
+
+
+/**
+ * @brief Returns the total amount of movies found in the movieCategoryArray Trees
+ * @return the number of movies
+*/
+void inOrderCountMovies(movie_t *movie, int *n_movies);
+
+
+/**
+ * @brief Edits scoreSum and counter int pointers according to the sum of scores of the user and the movie count
+ * @return returns void
+*/
+void inOrderFindStats(userMovie_t *movie, int *scoreSum, int *counter);
+
+
+/**
+ * @brief Prints Movies in the history tree of user UserID
+ * @return returns 1 on Success, 0 on failure
+*/
+int PrintUserMovies(int userID);
+
+
+/**
+ * @brief InOrder Print user History Tree movies
+ * @return returns void
+*/
+void InOrderPrintUserMovies(userMovie_t *movie);
+
+
+/**
+ * @brief InOrder Print user History Tree movies
+ * @return returns void
+*/
+void InOrderPrintUserMoviesEd2(userMovie_t *movie);
+
+
+#endif
@@ -0,0 +1,154 @@
+/*****************************************************
+ * @file   Pool.c                                     *
+ *                                                   *
+ * @brief Implementation for Pool.h 				 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "Pool.h"
+
+#include <sys/mman.h>
+#ifdef __SANITIZE_ADDRESS__
+#include <sanitizer/lsan_interface.h>
+#endif
+
+
+/**
+ * @brief Maps a region of length bytes with its pages faulted in
+ * @return returns 1 on success, 0 if the mapping failed
+*/
+int poolRegionMap(poolRegion_t *region, size_t length)
+{
+	void *base = MAP_FAILED;
+	region->huge = 0;
+#ifdef POOL_HUGE_PAGES
+	// Huge pages have to be reserved by the administrator, so asking for them may fail
+	length = (length + POOL_HUGE_PAGE_SIZE - 1) / POOL_HUGE_PAGE_SIZE * POOL_HUGE_PAGE_SIZE;
+	base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+	if(base != MAP_FAILED) region->huge = 1;
+#endif
+	if(base == MAP_FAILED)
+	{
+		base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+		if(base == MAP_FAILED) return 0;
+#ifdef POOL_HUGE_PAGES
+		madvise(base, length, MADV_HUGEPAGE);
+#endif
+	}
+	region->base = (char*)base;
+	region->length = length;
+	region->used = 0;
+#ifdef __SANITIZE_ADDRESS__
+	// The leak checker doesn't scan mappings, malloc'd objects only linked from pooled ones would look leaked
+	__lsan_register_root_region(base, length);
+#endif
+	return 1;
+}
+
+
+/**
+ * @brief Unmaps a region. Every pool carved from it must be out of use
+ * @return returns void
+*/
+void poolRegionUnmap(poolRegion_t *region)
+{
+	if(region->base == NULL) return;
+#ifdef __SANITIZE_ADDRESS__
+	__lsan_unregister_root_region(region->base, region->length);
+#endif
+	munmap(region->base, region->length);
+	region->base = NULL;
+	region->length = 0;
+	region->used = 0;
+}
+
+
+/**
+ * @brief Rounds an object size up so that the object can hold the link of the free list and is aligned like malloc()
+ * @return returns the rounded size
+*/
+static size_t poolObjectSize(size_t size)
+{
+	if(size < sizeof(void*)) size = sizeof(void*);
+	return (size + 15) & ~(size_t)15;
+}
+
+
+/**
+ * @brief Computes the bytes a pool of count objects of size bytes takes from a region
+ * @return returns the length
+*/
+size_t poolLength(size_t size, size_t count)
+{
+	return poolObjectSize(size) * count;
+}
+
+
+/**
+ * @brief Gives a pool count objects of size bytes from a mapped region, which must have room for them.
+ * Without a region every object comes from malloc()
+ * @return returns void
+*/
+void poolInit(pool_t *pool, poolRegion_t *region, size_t size, size_t count)
+{
+	size = poolObjectSize(size);
+	pool->base = NULL;
+	pool->end = NULL;
+	if(region != NULL && count > 0)
+	{
+		pool->base = region->base + region->used;
+		pool->end = pool->base + size * count;
+		region->used += size * count;
+	}
+	pool->next = pool->base;
+	pool->size = size;
+	pool->free = NULL;
+	pool->overflow = 0;
+	pthread_mutex_init(&pool->lock, NULL);
+}
+
+
+/**
+ * @brief Hands out an object, from malloc() once the pool has run out
+ * @return returns the object, NULL on malloc failure
+*/
+void *poolAlloc(pool_t *pool)
+{
+	void *object = NULL;
+	if(pool->base != NULL)
+	{
+		pthread_mutex_lock(&pool->lock);
+		if(pool->free != NULL)
+		{
+			object = pool->free;
+			pool->free = *(void**)object;
+		}
+		else if(pool->next < pool->end)
+		{
+			object = pool->next;
+			pool->next += pool->size;
+		}
+		else pool->overflow++;
+		pthread_mutex_unlock(&pool->lock);
+	}
+	if(object == NULL) object = malloc(pool->size);
+	return object;
+}
+
+
+/**
+ * @brief Returns an object handed out by poolAlloc() to the pool, or to free() if it came from malloc()
+ * @return returns void
+*/
+void poolFree(pool_t *pool, void *object)
+{
+	char *p = (char*)object;
+	if(pool->base == NULL || p < pool->base || p >= pool->end)
+	{
+		free(object);
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	*(void**)object = pool->free;
+	pool->free = object;
+	pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,101 @@
+/*****************************************************
+ * @file   Pool.h                                     *
+ *                                                   *
+ * @brief Preallocated pools of fixed size objects   *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef POOL_FILE
+#define POOL_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+/*
+ * A pool hands out objects of one size from a slice of a region mapped up front, so that the
+ * events that create objects at a steady rate make no allocator calls. The region is mapped
+ * with MAP_POPULATE, so its pages are faulted in once, and with huge pages when built with
+ * -DPOOL_HUGE_PAGES (falling back to transparent huge pages if none are reserved).
+ *
+ * Objects that were never handed out are taken in address order; freed objects are linked
+ * through their first bytes and handed out again first. Once a pool runs out it falls back to
+ * malloc(), and poolFree() tells the two apart by address, so callers never need to know where
+ * an object came from. Allocations and frees may run concurrently.
+ */
+
+#define POOL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+
+/**
+ * Structure defining a mapped region the pools are carved from
+*/
+typedef struct pool_region
+{
+	char *base;					/* NULL until the region is mapped */
+	size_t length;
+	size_t used;				/* Bytes handed to pools so far */
+	int huge;					/* Set if the region is backed by huge pages */
+}poolRegion_t;
+
+
+/**
+ * Structure defining a pool of objects
+*/
+typedef struct pool
+{
+	char *base;					/* The first object of the pool, NULL if the pool has no slice */
+	char *end;					/* Past the last object */
+	char *next;					/* The first object never handed out */
+	size_t size;				/* Size of an object */
+	void *free;					/* Freed objects */
+	pthread_mutex_t lock;
+	long overflow;				/* Objects that came from malloc() because the pool ran out */
+}pool_t;
+
+
+/**
+ * @brief Maps a region of length bytes with its pages faulted in
+ * @return returns 1 on success, 0 if the mapping failed
+*/
+int poolRegionMap(poolRegion_t *region, size_t length);
+
+
+/**
+ * @brief Unmaps a region. Every pool carved from it must be out of use
+ * @return returns void
+*/
+void poolRegionUnmap(poolRegion_t *region);
+
+
+/**
+ * @brief Computes the bytes a pool of count objects of size bytes takes from a region
+ * @return returns the length
+*/
+size_t poolLength(size_t size, size_t count);
+
+
+/**
+ * @brief Gives a pool count objects of size bytes from a mapped region, which must have room for them.
+ * Without a region every object comes from malloc()
+ * @return returns void
+*/
+void poolInit(pool_t *pool, poolRegion_t *region, size_t size, size_t count);
+
+
+/**
+ * @brief Hands out an object, from malloc() once the pool has run out
+ * @return returns the object, NULL on malloc failure
+*/
+void *poolAlloc(pool_t *pool);
+
+
+/**
+ * @brief Returns an object handed out by poolAlloc() to the pool, or to free() if it came from malloc()
+ * @return returns void
+*/
+void poolFree(pool_t *pool, void *object);
+
+
+#endif
@@ -0,0 +1,185 @@
+/*****************************************************
+ * @file   QueryCache.c                               *
+ *                                                   *
+ * @brief Implementation for QueryCache.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Picks the slot of an F result
+ * @return returns the slot index
+*/
+static int queryCacheFilterSlot(float score, int categories, int fromYear, int toYear)
+{
+	uint32_t bits;
+	memcpy(&bits, &score, sizeof(bits));
+
+	// FNV-1a over the four words of the key
+	uint32_t words[4] = {bits, (uint32_t)categories, (uint32_t)fromYear, (uint32_t)toYear};
+	uint32_t hash = 2166136261u;
+	for(int i=0; i < 4; i++)
+	{
+		hash ^= words[i];
+		hash *= 16777619u;
+	}
+	return (int)(hash % QUERYCACHE_FILTER_SLOTS);
+}
+
+
+/**
+ * @brief Copies a cached output so that it can be printed after the lock is released
+ * @return returns the copy, NULL on malloc failure
+*/
+static char *queryCacheCopy(const char *text)
+{
+	size_t size = strlen(text) + 1;
+	char *copy = (char*)malloc(size);
+	if(copy != NULL) memcpy(copy, text, size);
+	return copy;
+}
+
+
+/**
+ * @brief Bumps the catalog stamp. Call once a change of the category trees is visible to readers
+ * @return returns void
+*/
+void queryCacheTouchCatalog(queryCache_t *cache)
+{
+	__atomic_fetch_add(&cache->catalog, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Reads the catalog stamp. Read it before computing an F result
+ * @return returns the stamp
+*/
+uint64_t queryCacheCatalog(queryCache_t *cache)
+{
+	return __atomic_load_n(&cache->catalog, __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Hands out a version no user had before. Every new user and every change of a history takes one
+ * @return returns the version
+*/
+uint64_t queryCacheNextVersion(queryCache_t *cache)
+{
+	return __atomic_add_fetch(&cache->versions, 1, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Looks an F result up and counts the hit or miss
+ * @return returns a malloc'ed copy of the output, NULL on a miss or malloc failure
+*/
+char *queryCacheFilterGet(queryCache_t *cache, float score, int categories, int fromYear, int toYear)
+{
+	uint64_t catalog = queryCacheCatalog(cache);
+	queryCacheFilter_t *slot = &cache->filters[queryCacheFilterSlot(score, categories, fromYear, toYear)];
+	char *text = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	if(slot->text != NULL && slot->catalog == catalog && slot->score == score && slot->categories == categories
+		&& slot->fromYear == fromYear && slot->toYear == toYear)
+	{
+		text = queryCacheCopy(slot->text);
+	}
+	if(text != NULL) cache->filterHits++;
+	else cache->filterMisses++;
+	pthread_mutex_unlock(&cache->lock);
+	return text;
+}
+
+
+/**
+ * @brief Stores an F result computed at stamp catalog. The cache takes over text
+ * @return returns void
+*/
+void queryCacheFilterPut(queryCache_t *cache, float score, int categories, int fromYear, int toYear, uint64_t catalog, char *text)
+{
+	queryCacheFilter_t *slot = &cache->filters[queryCacheFilterSlot(score, categories, fromYear, toYear)];
+
+	pthread_mutex_lock(&cache->lock);
+	char *old = slot->text;
+	slot->score = score;
+	slot->categories = categories;
+	slot->fromYear = fromYear;
+	slot->toYear = toYear;
+	slot->catalog = catalog;
+	slot->text = text;
+	pthread_mutex_unlock(&cache->lock);
+	free(old);
+}
+
+
+/**
+ * @brief Looks a Q result up and counts the hit or miss
+ * @return returns a malloc'ed copy of the output, NULL on a miss or malloc failure
+*/
+char *queryCacheStatsGet(queryCache_t *cache, int userID, uint64_t version)
+{
+	queryCacheStats_t *slot = &cache->stats[(unsigned)userID % QUERYCACHE_STATS_SLOTS];
+	char *text = NULL;
+
+	pthread_mutex_lock(&cache->lock);
+	if(slot->text != NULL && slot->userID == userID && slot->version == version) text = queryCacheCopy(slot->text);
+	if(text != NULL) cache->statsHits++;
+	else cache->statsMisses++;
+	pthread_mutex_unlock(&cache->lock);
+	return text;
+}
+
+
+/**
+ * @brief Stores a Q result computed at version. The cache takes over text
+ * @return returns void
+*/
+void queryCacheStatsPut(queryCache_t *cache, int userID, uint64_t version, char *text)
+{
+	queryCacheStats_t *slot = &cache->stats[(unsigned)userID % QUERYCACHE_STATS_SLOTS];
+
+	pthread_mutex_lock(&cache->lock);
+	char *old = slot->text;
+	slot->userID = userID;
+	slot->version = version;
+	slot->text = text;
+	pthread_mutex_unlock(&cache->lock);
+	free(old);
+}
+
+
+/**
+ * @brief Prints the hit and miss counters
+ * @return returns void
+*/
+void queryCachePrint(queryCache_t *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	printf("   F: %llu hits, %llu misses\n", (unsigned long long)cache->filterHits, (unsigned long long)cache->filterMisses);
+	printf("   Q: %llu hits, %llu misses\n", (unsigned long long)cache->statsHits, (unsigned long long)cache->statsMisses);
+	pthread_mutex_unlock(&cache->lock);
+}
+
+
+/**
+ * @brief Frees every cached result
+ * @return returns void
+*/
+void queryCacheClear(queryCache_t *cache)
+{
+	pthread_mutex_lock(&cache->lock);
+	for(int i=0; i < QUERYCACHE_FILTER_SLOTS; i++)
+	{
+		free(cache->filters[i].text);
+		cache->filters[i].text = NULL;
+	}
+	for(int i=0; i < QUERYCACHE_STATS_SLOTS; i++)
+	{
+		free(cache->stats[i].text);
+		cache->stats[i].text = NULL;
+	}
+	pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,139 @@
+/*****************************************************
+ * @file   QueryCache.h                               *
+ *                                                   *
+ * @brief Result cache of the F and Q events         *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef QUERYCACHE_FILE
+#define QUERYCACHE_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+/*
+ * F and Q are often repeated with the same arguments between two mutations. The cache keeps
+ * the formatted output of recent ones, so that a repeat prints it instead of scanning again.
+ *
+ * An F result is keyed by its score, categories and years, and tagged with the catalog stamp,
+ * which every change of the category trees bumps (a W, a D, a published version). A Q result
+ * is keyed by userID and tagged with the version of the user, which every W of the user
+ * bumps. Versions are drawn from one counter, so a user registered again after U never
+ * matches the results of the old one. A tag is read before the result is computed and bumped
+ * after the change is visible, so a result that raced with a change is simply never hit.
+ *
+ * Both tables are direct mapped: a new result replaces whatever was in its slot.
+ */
+
+#define QUERYCACHE_FILTER_SLOTS 256		/* Slots of the F results */
+#define QUERYCACHE_STATS_SLOTS 1024		/* Slots of the Q results */
+
+
+/**
+ * Structure defining a cached F result
+*/
+typedef struct query_cache_filter
+{
+	float score;			/* The key of the result */
+	int categories;
+	int fromYear;
+	int toYear;
+	uint64_t catalog;		/* The catalog stamp the result was computed at */
+	char *text;				/* The output after the event line, NULL while the slot is empty */
+}queryCacheFilter_t;
+
+
+/**
+ * Structure defining a cached Q result
+*/
+typedef struct query_cache_stats
+{
+	int userID;				/* The key of the result */
+	uint64_t version;		/* The version of the user the result was computed at */
+	char *text;				/* The whole output, NULL while the slot is empty */
+}queryCacheStats_t;
+
+
+/**
+ * Structure defining the cache
+*/
+typedef struct query_cache
+{
+	pthread_mutex_t lock;								/* Guards the slots and the counters */
+	uint64_t catalog;									/* The catalog stamp */
+	uint64_t versions;									/* The last version handed out to a user */
+	queryCacheFilter_t filters[QUERYCACHE_FILTER_SLOTS];
+	queryCacheStats_t stats[QUERYCACHE_STATS_SLOTS];
+	uint64_t filterHits;
+	uint64_t filterMisses;
+	uint64_t statsHits;
+	uint64_t statsMisses;
+}queryCache_t;
+
+
+/**
+ * @brief Bumps the catalog stamp. Call once a change of the category trees is visible to readers
+ * @return returns void
+*/
+void queryCacheTouchCatalog(queryCache_t *cache);
+
+
+/**
+ * @brief Reads the catalog stamp. Read it before computing an F result
+ * @return returns the stamp
+*/
+uint64_t queryCacheCatalog(queryCache_t *cache);
+
+
+/**
+ * @brief Hands out a version no user had before. Every new user and every change of a history takes one
+ * @return returns the version
+*/
+uint64_t queryCacheNextVersion(queryCache_t *cache);
+
+
+/**
+ * @brief Looks an F result up and counts the hit or miss
+ * @return returns a malloc'ed copy of the output, NULL on a miss or malloc failure
+*/
+char *queryCacheFilterGet(queryCache_t *cache, float score, int categories, int fromYear, int toYear);
+
+
+/**
+ * @brief Stores an F result computed at stamp catalog. The cache takes over text
+ * @return returns void
+*/
+void queryCacheFilterPut(queryCache_t *cache, float score, int categories, int fromYear, int toYear, uint64_t catalog, char *text);
+
+
+/**
+ * @brief Looks a Q result up and counts the hit or miss
+ * @return returns a malloc'ed copy of the output, NULL on a miss or malloc failure
+*/
+char *queryCacheStatsGet(queryCache_t *cache, int userID, uint64_t version);
+
+
+/**
+ * @brief Stores a Q result computed at version. The cache takes over text
+ * @return returns void
+*/
+void queryCacheStatsPut(queryCache_t *cache, int userID, uint64_t version, char *text);
+
+
+/**
+ * @brief Prints the hit and miss counters
+ * @return returns void
+*/
+void queryCachePrint(queryCache_t *cache);
+
+
+/**
+ * @brief Frees every cached result
+ * @return returns void
+*/
+void queryCacheClear(queryCache_t *cache);
+
+
+#endif
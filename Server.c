@@ -0,0 +1,359 @@
+/*****************************************************
+ * @file   Server.c                                   *
+ *                                                   *
+ * @brief Implementation for Server.h 				 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#define _GNU_SOURCE
+#include "Server.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+/**
+ * @brief Makes room for length more bytes in the reply buffer of a connection, doubling it as needed
+ * @return returns 1 on success, 0 on malloc failure
+*/
+static int serverReserve(serverConn_t *conn, size_t length)
+{
+	if(conn->out_end + length <= conn->out_size) return 1;
+
+	// Sent bytes are dropped first, which is often enough
+	if(conn->out_sent > 0)
+	{
+		memmove(conn->out, conn->out + conn->out_sent, conn->out_end - conn->out_sent);
+		conn->out_end -= conn->out_sent;
+		conn->out_sent = 0;
+		if(conn->out_end + length <= conn->out_size) return 1;
+	}
+	size_t size = conn->out_size;
+	while(size < conn->out_end + length) size *= 2;
+	char *out = (char*)realloc(conn->out, size);
+	if(out == NULL) return 0;
+	conn->out = out;
+	conn->out_size = size;
+	return 1;
+}
+
+
+/**
+ * @brief Write function of the stream that stands in for stdout, appends to the reply of the current connection
+ * @return returns the bytes written, -1 on malloc failure
+*/
+static ssize_t serverStreamWrite(void *cookie, const char *buffer, size_t size)
+{
+	server_t *server = (server_t*)cookie;
+	serverConn_t *conn = server->current;
+	if(conn == NULL || conn->failed) return size;
+	if(!serverReserve(conn, size))
+	{
+		conn->failed = 1;
+		return -1;
+	}
+	memcpy(conn->out + conn->out_end, buffer, size);
+	conn->out_end += size;
+	return size;
+}
+
+
+/**
+ * @brief Binds a Unix domain socket at path, replacing any file there, and gets ready to serve it
+ * @return returns 1 on success, 0 if the socket can't be bound or listened on
+*/
+int serverOpen(server_t *server, const char *path, void (*handle)(char *line, void *arg), void *arg)
+{
+	memset(server, 0, sizeof(server_t));
+	server->listen_fd = -1;
+	server->epoll_fd = -1;
+	server->path = path;
+	server->handle = handle;
+	server->arg = arg;
+
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(strlen(path) >= sizeof(address.sun_path)) return 0;
+	strcpy(address.sun_path, path);
+
+	cookie_io_functions_t functions = { .write = serverStreamWrite };
+	server->out = fopencookie(server, "w", functions);
+	if(server->out == NULL) return 0;
+	setvbuf(server->out, server->out_buffer, _IOFBF, sizeof(server->out_buffer));
+
+	unlink(path);
+	server->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	server->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	struct epoll_event event = { .events = EPOLLIN, .data.ptr = NULL };
+	if(server->listen_fd < 0 || server->epoll_fd < 0
+		|| bind(server->listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0
+		|| listen(server->listen_fd, SERVER_BACKLOG) != 0
+		|| epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event) != 0)
+	{
+		serverClose(server);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Takes a connection off the free list, or makes a new one
+ * @return returns the connection, NULL on malloc failure
+*/
+static serverConn_t *serverConnGet(server_t *server)
+{
+	serverConn_t *conn = server->free;
+	if(conn != NULL)
+	{
+		server->free = conn->next;
+	}
+	else
+	{
+		conn = (serverConn_t*)malloc(sizeof(serverConn_t));
+		if(conn == NULL) return NULL;
+		conn->in = (char*)malloc(SERVER_READ_SIZE);
+		conn->out = (char*)malloc(SERVER_OUT_SIZE);
+		conn->out_size = SERVER_OUT_SIZE;
+		if(conn->in == NULL || conn->out == NULL)
+		{
+			free(conn->in);
+			free(conn->out);
+			free(conn);
+			return NULL;
+		}
+	}
+	conn->eof = 0;
+	conn->in_start = 0;
+	conn->in_end = 0;
+	conn->out_sent = 0;
+	conn->out_end = 0;
+	conn->failed = 0;
+	return conn;
+}
+
+
+/**
+ * @brief Closes a connection and puts it on the free list
+ * @return returns void
+*/
+static void serverConnClose(server_t *server, serverConn_t *conn)
+{
+	epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	if(conn->prev != NULL) conn->prev->next = conn->next;
+	else server->open = conn->next;
+	if(conn->next != NULL) conn->next->prev = conn->prev;
+	conn->next = server->free;
+	server->free = conn;
+}
+
+
+/**
+ * @brief Accepts every pending connection
+ * @return returns void
+*/
+static void serverAccept(server_t *server)
+{
+	for(;;)
+	{
+		int fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if(fd < 0) return;
+		serverConn_t *conn = serverConnGet(server);
+		if(conn == NULL)
+		{
+			close(fd);
+			continue;
+		}
+		conn->fd = fd;
+		conn->events = EPOLLIN;
+		struct epoll_event event = { .events = conn->events, .data.ptr = conn };
+		if(epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+		{
+			close(fd);
+			conn->next = server->free;
+			server->free = conn;
+			continue;
+		}
+		conn->prev = NULL;
+		conn->next = server->open;
+		if(server->open != NULL) server->open->prev = conn;
+		server->open = conn;
+		server->connections++;
+	}
+}
+
+
+/**
+ * @brief Handles the whole lines read on a connection, until they run out or too many reply bytes are unsent
+ * @return returns 1 on success, 0 if a line is too long or a reply didn't fit in memory
+*/
+static int serverHandleLines(server_t *server, serverConn_t *conn)
+{
+	char line[SERVER_LINE_SIZE];
+	FILE *saved = stdout;
+	int ok = 1;
+
+	stdout = server->out;
+	server->current = conn;
+	while(conn->out_end - conn->out_sent < SERVER_OUT_HIGH)
+	{
+		char *start = conn->in + conn->in_start;
+		size_t pending = conn->in_end - conn->in_start;
+		char *newline = (char*)memchr(start, '\n', pending);
+		if(newline == NULL)
+		{
+			ok = pending < SERVER_LINE_SIZE;
+			break;
+		}
+		size_t length = newline - start + 1;
+		if(length >= SERVER_LINE_SIZE)
+		{
+			ok = 0;
+			break;
+		}
+		memcpy(line, start, length);
+		line[length] = '\0';
+		conn->in_start += length;
+
+		// The reply ends with what the event printed, flushed before the '\0' that marks its end
+		server->handle(line, server->arg);
+		fflush(server->out);
+		if(conn->failed || !serverReserve(conn, 1))
+		{
+			ok = 0;
+			break;
+		}
+		conn->out[conn->out_end++] = '\0';
+		server->requests++;
+	}
+	server->current = NULL;
+	stdout = saved;
+
+	// The partial line left moves to the front, so the next read has the rest of the buffer
+	if(conn->in_start > 0)
+	{
+		memmove(conn->in, conn->in + conn->in_start, conn->in_end - conn->in_start);
+		conn->in_end -= conn->in_start;
+		conn->in_start = 0;
+	}
+	return ok;
+}
+
+
+/**
+ * @brief Sends as much of the unsent replies of a connection as the socket takes
+ * @return returns 1 on success, 0 if the client is gone
+*/
+static int serverSend(serverConn_t *conn)
+{
+	while(conn->out_sent < conn->out_end)
+	{
+		ssize_t sent = send(conn->fd, conn->out + conn->out_sent, conn->out_end - conn->out_sent, MSG_NOSIGNAL);
+		if(sent < 0)
+		{
+			if(errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		conn->out_sent += sent;
+	}
+	conn->out_sent = 0;
+	conn->out_end = 0;
+	return 1;
+}
+
+
+/**
+ * @brief Serves a ready connection: reads what arrived, handles its lines, sends the replies
+ * @return returns 1 if the connection stays open, 0 if it is done or failed
+*/
+static int serverServe(server_t *server, serverConn_t *conn, unsigned events)
+{
+	if(events & EPOLLIN)
+	{
+		ssize_t n = read(conn->fd, conn->in + conn->in_end, SERVER_READ_SIZE - conn->in_end);
+		if(n == 0) conn->eof = 1;
+		else if(n > 0) conn->in_end += n;
+		else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return 0;
+	}
+	else if(events & (EPOLLERR | EPOLLHUP)) return 0;
+
+	// A connection whose client stopped reading keeps its lines until its replies drain
+	for(;;)
+	{
+		if(!serverHandleLines(server, conn) || !serverSend(conn)) return 0;
+		if(conn->out_sent < conn->out_end || memchr(conn->in, '\n', conn->in_end) == NULL) break;
+	}
+
+	int waiting = conn->out_sent < conn->out_end;
+	if(conn->eof && !waiting) return 0;
+
+	// Lines are only read while the replies keep up
+	unsigned wanted = waiting ? EPOLLOUT : 0;
+	if(!conn->eof && conn->out_end - conn->out_sent < SERVER_OUT_HIGH && conn->in_end < SERVER_READ_SIZE) wanted |= EPOLLIN;
+	if(wanted != conn->events)
+	{
+		struct epoll_event event = { .events = wanted, .data.ptr = conn };
+		if(epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event) != 0) return 0;
+		conn->events = wanted;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Serves the connections until stop is set, by a signal handler for example
+ * @return returns 1 once stopped, 0 if epoll failed
+*/
+int serverRun(server_t *server, volatile sig_atomic_t *stop)
+{
+	struct epoll_event events[SERVER_EVENTS];
+	while(!*stop)
+	{
+		int n = epoll_wait(server->epoll_fd, events, SERVER_EVENTS, -1);
+		if(n < 0)
+		{
+			if(errno == EINTR) continue;
+			return 0;
+		}
+		for(int i=0; i < n; i++)
+		{
+			serverConn_t *conn = (serverConn_t*)events[i].data.ptr;
+			if(conn == NULL) serverAccept(server);
+			else if(!serverServe(server, conn, events[i].events)) serverConnClose(server, conn);
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Closes every connection and the socket, and removes the socket file
+ * @return returns void
+*/
+void serverClose(server_t *server)
+{
+	while(server->open != NULL) serverConnClose(server, server->open);
+	while(server->free != NULL)
+	{
+		serverConn_t *conn = server->free;
+		server->free = conn->next;
+		free(conn->in);
+		free(conn->out);
+		free(conn);
+	}
+	if(server->listen_fd >= 0)
+	{
+		close(server->listen_fd);
+		unlink(server->path);
+	}
+	if(server->epoll_fd >= 0) close(server->epoll_fd);
+	if(server->out != NULL) fclose(server->out);
+	server->listen_fd = -1;
+	server->epoll_fd = -1;
+	server->out = NULL;
+}
@@ -0,0 +1,102 @@
+/*****************************************************
+ * @file   Server.h                                   *
+ *                                                   *
+ * @brief Unix domain socket service of the events   *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef SERVER_FILE
+#define SERVER_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+
+
+/*
+ * With -u <socket> the events come from local clients over a Unix domain socket instead of
+ * only from the input file. A client sends the same lines the input file holds and may send
+ * many of them before reading any reply. Each line gets one reply: what the event printed,
+ * followed by a '\0' byte. Replies go back in the order the lines came in on the connection.
+ *
+ * One thread serves every connection from an epoll loop, so the events run one at a time as
+ * they do from the file. A connection is read SERVER_READ_SIZE bytes at a time, every whole
+ * line in them is handled, and the replies of all of them are sent with as few writes as the
+ * socket takes. While the handler runs, stdout is a stream that appends to the reply buffer
+ * of the connection.
+ *
+ * A closed connection keeps its buffers on a free list for the next one, and a reply buffer
+ * only ever grows. Once the connections and their buffers have reached the sizes the clients
+ * need, serving does no allocation.
+ */
+
+#define SERVER_READ_SIZE (64 * 1024)	/* Input buffer of a connection, the most one read takes */
+#define SERVER_LINE_SIZE 1024			/* Longest line with its '\n', like BUFFER_SIZE of main.c. Longer ones close the connection */
+#define SERVER_OUT_SIZE (16 * 1024)		/* First size of the reply buffer of a connection */
+#define SERVER_OUT_HIGH (256 * 1024)	/* Unsent reply bytes past which a connection's lines wait */
+#define SERVER_EVENTS 64				/* Ready connections taken from one epoll_wait() */
+#define SERVER_BACKLOG 128
+
+
+/**
+ * Structure defining a client connection
+*/
+typedef struct server_conn
+{
+	int fd;
+	int eof;						/* Set once the client has shut its side down */
+	unsigned events;				/* The epoll events the connection waits for */
+	char *in;						/* SERVER_READ_SIZE bytes of lines as read */
+	size_t in_start;				/* The first byte not handled yet */
+	size_t in_end;					/* Past the last byte read */
+	char *out;						/* The replies not sent yet */
+	size_t out_sent;				/* The first byte not sent yet */
+	size_t out_end;					/* Past the last reply byte */
+	size_t out_size;				/* The capacity of out */
+	int failed;						/* Set if a reply didn't fit in memory */
+	struct server_conn *prev;		/* The previous open connection */
+	struct server_conn *next;		/* The next open connection, or the next of the free list */
+}serverConn_t;
+
+
+/**
+ * Structure defining the server
+*/
+typedef struct server
+{
+	int listen_fd;
+	int epoll_fd;
+	const char *path;						/* Where the socket is bound */
+	void (*handle)(char *line, void *arg);	/* Handles one line, printing its reply to stdout */
+	void *arg;
+	FILE *out;								/* stdout while a line is handled, appends to the reply of current */
+	char out_buffer[BUFSIZ];				/* The stdio buffer of out */
+	serverConn_t *current;					/* The connection whose line is being handled */
+	serverConn_t *open;						/* The open connections */
+	serverConn_t *free;						/* Closed connections with their buffers */
+	unsigned long long requests;			/* Lines handled */
+	unsigned long long connections;			/* Connections accepted */
+}server_t;
+
+
+/**
+ * @brief Binds a Unix domain socket at path, replacing any file there, and gets ready to serve it
+ * @return returns 1 on success, 0 if the socket can't be bound or listened on
+*/
+int serverOpen(server_t *server, const char *path, void (*handle)(char *line, void *arg), void *arg);
+
+
+/**
+ * @brief Serves the connections until stop is set, by a signal handler for example
+ * @return returns 1 once stopped, 0 if epoll failed
+*/
+int serverRun(server_t *server, volatile sig_atomic_t *stop);
+
+
+/**
+ * @brief Closes every connection and the socket, and removes the socket file
+ * @return returns void
+*/
+void serverClose(server_t *server);
+
+
+#endif
@@ -0,0 +1,198 @@
+/*****************************************************
+ * @file   SkipList.c                                 *
+ *                                                   *
+ * @brief Implementation for SkipList.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+static _Thread_local uint32_t skipListSeed = 0;	/* Per thread state of the level generator */
+
+
+/**
+ * @brief Draws the height of a new node. Each extra level is taken with probability 1/4
+ * @return returns the height in [1, SKIPLIST_MAX_LEVEL]
+*/
+static int skipListRandomHeight(void)
+{
+	if(skipListSeed == 0) skipListSeed = (uint32_t)(uintptr_t)&skipListSeed | 1;
+
+	// xorshift32
+	skipListSeed ^= skipListSeed << 13;
+	skipListSeed ^= skipListSeed >> 17;
+	skipListSeed ^= skipListSeed << 5;
+
+	int height = 1;
+	uint32_t bits = skipListSeed;
+	while(height < SKIPLIST_MAX_LEVEL && (bits & 3) == 0)
+	{
+		height++;
+		bits >>= 2;
+	}
+	return height;
+}
+
+
+/**
+ * @brief Makes a node of the given height with all its links NULL
+ * @return returns the node, NULL on malloc failure
+*/
+static skipNode_t *makeSkipNode(int movieID, movieInfo_t *Info, int height)
+{
+	skipNode_t *node = (skipNode_t*)malloc(sizeof(skipNode_t) + height * sizeof(skipNode_t*));
+	if(node == NULL) return NULL;
+	node->movieID = movieID;
+	node->Info = Info;
+	node->height = height;
+	for(int i=0; i < height; i++) node->next[i] = NULL;
+	return node;
+}
+
+
+/**
+ * @brief Fills preds and succs with the last node before movieID and the first node at or after it on every level
+ * @return returns the node holding movieID, NULL if it isn't indexed
+*/
+static skipNode_t *skipListSearch(skipList_t *list, int movieID, skipNode_t **preds, skipNode_t **succs)
+{
+	skipNode_t *pred = list->head, *succ = NULL;
+	for(int level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--)
+	{
+		succ = __atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE);
+		while(succ != NULL && succ->movieID < movieID)
+		{
+			pred = succ;
+			succ = __atomic_load_n(&pred->next[level], __ATOMIC_ACQUIRE);
+		}
+		if(preds != NULL)
+		{
+			preds[level] = pred;
+			succs[level] = succ;
+		}
+	}
+	if(succ != NULL && succ->movieID == movieID) return succ;
+	return NULL;
+}
+
+
+/**
+ * @brief Makes an empty skip list
+ * @return returns the list, NULL on malloc failure
+*/
+skipList_t *makeSkipList(void)
+{
+	skipList_t *list = (skipList_t*)malloc(sizeof(skipList_t));
+	if(list == NULL) return NULL;
+	list->head = makeSkipNode(INT_MIN, NULL, SKIPLIST_MAX_LEVEL);
+	if(list->head == NULL)
+	{
+		free(list);
+		return NULL;
+	}
+	return list;
+}
+
+
+/**
+ * @brief Inserts the movie with the given info. Safe to call concurrently with other inserts and searches
+ * @return returns 1 on success, 0 on malloc failure or if movieID is already indexed
+*/
+int skipListInsert(skipList_t *list, movieInfo_t *Info)
+{
+	skipNode_t *preds[SKIPLIST_MAX_LEVEL], *succs[SKIPLIST_MAX_LEVEL];
+	int movieID = Info->movieID;
+	if(skipListSearch(list, movieID, preds, succs) != NULL) return 0;
+
+	skipNode_t *node = makeSkipNode(movieID, Info, skipListRandomHeight());
+	if(node == NULL) return 0;
+
+	// The bottom level decides membership. Losing the race against an equal key means the movie is already indexed
+	for(;;)
+	{
+		skipNode_t *expected = succs[0];
+		node->next[0] = expected;
+		if(__atomic_compare_exchange_n(&preds[0]->next[0], &expected, node, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) break;
+		if(skipListSearch(list, movieID, preds, succs) != NULL)
+		{
+			free(node);
+			return 0;
+		}
+	}
+
+	// The upper levels are only shortcuts. Link them bottom up, searching again whenever a neighbour changed
+	for(int level = 1; level < node->height; level++)
+	{
+		for(;;)
+		{
+			skipNode_t *expected = succs[level];
+			__atomic_store_n(&node->next[level], expected, __ATOMIC_RELAXED);
+			if(__atomic_compare_exchange_n(&preds[level]->next[level], &expected, node, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) break;
+			skipListSearch(list, movieID, preds, succs);
+		}
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Looks movieID up
+ * @return returns the movie info, NULL if it isn't indexed
+*/
+movieInfo_t *skipListFind(skipList_t *list, int movieID)
+{
+	skipNode_t *node = skipListSearch(list, movieID, NULL, NULL);
+	if(node == NULL) return NULL;
+	return node->Info;
+}
+
+
+/**
+ * @brief Returns the first node whose movieID is at least movieID, start of a range walk
+ * @return returns the node, NULL if every movieID is smaller
+*/
+skipNode_t *skipListSeek(skipList_t *list, int movieID)
+{
+	skipNode_t *preds[SKIPLIST_MAX_LEVEL], *succs[SKIPLIST_MAX_LEVEL];
+	skipListSearch(list, movieID, preds, succs);
+	return succs[0];
+}
+
+
+/**
+ * @brief Returns the node with the smallest movieID, start of an in-order walk
+ * @return returns the node, NULL if the list is empty
+*/
+skipNode_t *skipListFirst(skipList_t *list)
+{
+	return __atomic_load_n(&list->head->next[0], __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Returns the in-order successor of a node
+ * @return returns the node, NULL at the end of the list
+*/
+skipNode_t *skipListNext(skipNode_t *node)
+{
+	return __atomic_load_n(&node->next[0], __ATOMIC_ACQUIRE);
+}
+
+
+/**
+ * @brief Frees the list and the movie info of every node. Only valid once no other thread uses the list
+ * @return returns void
+*/
+void deleteSkipList(skipList_t *list)
+{
+	if(list == NULL) return;
+	skipNode_t *node = list->head;
+	while(node != NULL)
+	{
+		skipNode_t *next = node->next[0];
+		if(node->Info != NULL) freeMovieInfo(node->Info);
+		free(node);
+		node = next;
+	}
+	free(list);
+}
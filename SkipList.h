@@ -0,0 +1,98 @@
+/*****************************************************
+ * @file   SkipList.h                                 *
+ *                                                   *
+ * @brief Lock-free skip list category index         *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef SKIPLIST_FILE
+#define SKIPLIST_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+
+/*
+ * With CATEGORY_SKIPLIST defined every category is indexed by a skip list keyed by movieID
+ * instead of the sentinel BST. Movies are never removed from a category, so the list is
+ * insert-only: a node is linked with one CAS per level, bottom level first, and a search
+ * or an in-order walk of the bottom level never takes a lock or retries.
+ */
+
+#define SKIPLIST_MAX_LEVEL 24	/* Enough levels for 4^24 movies per category */
+
+struct movie_info;
+
+
+/**
+ * Structure defining a skip list node
+*/
+typedef struct skip_node
+{
+	int movieID;					/* The key of the node */
+	struct movie_info *Info;		/* Pointer to the movieInfo_t struct */
+	int height;						/* Number of levels the node is linked in */
+	struct skip_node *next[];		/* The successor of the node on each level */
+}skipNode_t;
+
+
+/**
+ * Structure defining a skip list
+*/
+typedef struct skip_list
+{
+	skipNode_t *head;	/* Head node of height SKIPLIST_MAX_LEVEL whose key is below every movieID */
+}skipList_t;
+
+
+/**
+ * @brief Makes an empty skip list
+ * @return returns the list, NULL on malloc failure
+*/
+skipList_t *makeSkipList(void);
+
+
+/**
+ * @brief Inserts the movie with the given info. Safe to call concurrently with other inserts and searches
+ * @return returns 1 on success, 0 on malloc failure or if movieID is already indexed
+*/
+int skipListInsert(skipList_t *list, struct movie_info *Info);
+
+
+/**
+ * @brief Looks movieID up
+ * @return returns the movie info, NULL if it isn't indexed
+*/
+struct movie_info *skipListFind(skipList_t *list, int movieID);
+
+
+/**
+ * @brief Returns the first node whose movieID is at least movieID, start of a range walk
+ * @return returns the node, NULL if every movieID is smaller
+*/
+skipNode_t *skipListSeek(skipList_t *list, int movieID);
+
+
+/**
+ * @brief Returns the node with the smallest movieID, start of an in-order walk
+ * @return returns the node, NULL if the list is empty
+*/
+skipNode_t *skipListFirst(skipList_t *list);
+
+
+/**
+ * @brief Returns the in-order successor of a node
+ * @return returns the node, NULL at the end of the list
+*/
+skipNode_t *skipListNext(skipNode_t *node);
+
+
+/**
+ * @brief Frees the list and the movie info of every node. Only valid once no other thread uses the list
+ * @return returns void
+*/
+void deleteSkipList(skipList_t *list);
+
+
+#endif
@@ -0,0 +1,610 @@
+/*****************************************************
+ * @file   Snapshot.c                                 *
+ *                                                   *
+ * @brief Implementation for Snapshot.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_FNV_BASIS 14695981039346656037ULL
+#define SNAPSHOT_FNV_PRIME 1099511628211ULL
+
+/* The category records are used in place as the Info of the tree nodes */
+_Static_assert(sizeof(movieInfo_t) == 16, "movieInfo_t is a snapshot record and must keep its layout");
+
+
+/**
+ * Structure defining the state of a snapshot being written
+*/
+typedef struct snapshot_writer
+{
+	FILE *file;
+	uint64_t offset;		/* Offset of the next byte to write */
+	uint64_t checksum;		/* FNV-1a of everything written after the header */
+	int failed;				/* Set on the first failed write */
+}snapshotWriter_t;
+
+
+/**
+ * @brief Folds size bytes of data into an FNV-1a checksum
+ * @return returns the new checksum
+*/
+static uint64_t snapshotChecksum(uint64_t checksum, const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char*)data;
+	for(size_t i=0; i < size; i++)
+	{
+		checksum ^= bytes[i];
+		checksum *= SNAPSHOT_FNV_PRIME;
+	}
+	return checksum;
+}
+
+
+/**
+ * @brief Appends size bytes of data to the file
+ * @return returns void
+*/
+static void snapshotEmit(snapshotWriter_t *writer, const void *data, size_t size)
+{
+	if(writer->failed) return;
+	if(fwrite(data, 1, size, writer->file) != size)
+	{
+		writer->failed = 1;
+		return;
+	}
+	writer->checksum = snapshotChecksum(writer->checksum, data, size);
+	writer->offset += size;
+}
+
+
+/**
+ * @brief Pads the file up to the alignment of a section and opens the section there
+ * @return returns void
+*/
+static void snapshotBeginSection(snapshotWriter_t *writer, snapshotSection_t *section)
+{
+	static const char zeros[SNAPSHOT_ALIGN] = {0};
+	snapshotEmit(writer, zeros, (SNAPSHOT_ALIGN - writer->offset % SNAPSHOT_ALIGN) % SNAPSHOT_ALIGN);
+	section->offset = writer->offset;
+	section->count = 0;
+}
+
+
+#ifndef CATEGORY_INDEX
+/**
+ * @brief Writes the movies of a category tree in pre-order
+ * @return returns void
+*/
+static void snapshotEmitMovies(snapshotWriter_t *writer, snapshotSection_t *section, movie_t *movie)
+{
+	treeWalk_t walk;
+	movieWalkBegin(&walk, TREE_WALK_PRE, movie);
+	for(movie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		snapshotEmit(writer, node->Info, sizeof(movieInfo_t));
+		section->count++;
+	}
+	if(!treeWalkEnd(&walk)) writer->failed = 1;
+}
+#endif
+
+
+/**
+ * @brief Writes the new releases tree in pre-order
+ * @return returns void
+*/
+static void snapshotEmitNewMovies(snapshotWriter_t *writer, snapshotSection_t *section, newMovie_t *newMovie)
+{
+	treeWalk_t walk;
+	newMovieWalkBegin(&walk, TREE_WALK_PRE, newMovie);
+	for(newMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		snapshotNewMovie_t record = {node->Info->movieID, node->Info->year, (int32_t)node->category};
+		snapshotEmit(writer, &record, sizeof(record));
+		section->count++;
+	}
+	if(!treeWalkEnd(&walk)) writer->failed = 1;
+}
+
+
+/**
+ * @brief Counts the leaves of a history tree
+ * @return returns the number of watched movies
+*/
+static int snapshotCountLeaves(snapshotWriter_t *writer, userMovie_t *movie)
+{
+	treeWalk_t walk;
+	int n = 0;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(EPOCH_READ(node->lc) == NULL && EPOCH_READ(node->rc) == NULL) n++;
+	}
+	if(!treeWalkEnd(&walk)) writer->failed = 1;
+	return n;
+}
+
+
+/**
+ * @brief Writes the leaves of a history tree in ascending movieID
+ * @return returns void
+*/
+static void snapshotEmitLeaves(snapshotWriter_t *writer, snapshotSection_t *section, userMovie_t *movie)
+{
+	treeWalk_t walk;
+	historyWalkBegin(&walk, TREE_WALK_IN, movie);
+	for(userMovie_t *node; (node = treeWalkNext(&walk)) != NULL; )
+	{
+		if(EPOCH_READ(node->lc) != NULL || EPOCH_READ(node->rc) != NULL) continue;
+		snapshotLeaf_t record = {node->Info->movieID, (int32_t)node->Info->category, node->Info->sumScore};
+		snapshotEmit(writer, &record, sizeof(record));
+		section->count++;
+	}
+	if(!treeWalkEnd(&walk)) writer->failed = 1;
+}
+
+
+/**
+ * @brief Writes the current state to path. The file is written next to it and renamed over it once synced.
+ * Readers may run meanwhile, writers may not. lsn is the LSN of the next event to log
+ * @return returns 1 on success, 0 on I/O or malloc failure
+*/
+int snapshotWrite(const char *path, uint64_t lsn)
+{
+	char *tmp = (char*)malloc(strlen(path) + 5);
+	if(tmp == NULL) return 0;
+	sprintf(tmp, "%s.tmp", path);
+
+	snapshotWriter_t writer = {fopen(tmp, "wb"), 0, SNAPSHOT_FNV_BASIS, 0};
+	if(writer.file == NULL)
+	{
+		free(tmp);
+		return 0;
+	}
+
+	// The header goes last, once the sections and the checksum are known
+	snapshotHeader_t header;
+	memset(&header, 0, sizeof(header));
+	if(fwrite(&header, 1, sizeof(header), writer.file) != sizeof(header)) writer.failed = 1;
+	writer.offset = sizeof(header);
+
+	// Category trees, read as any reader would
+	movie_t *roots[6];
+	catalogVersion_t *version = catalogReadBegin(roots);
+	for(int i=0; i<6; i++)
+	{
+		snapshotBeginSection(&writer, &header.categories[i]);
+#ifdef CATEGORY_SKIPLIST
+		(void)roots;
+		for(skipNode_t *node = skipListFirst(catalog->categoryArray[i]->index); node != NULL; node = skipListNext(node))
+		{
+			snapshotEmit(&writer, node->Info, sizeof(movieInfo_t));
+			header.categories[i].count++;
+		}
+#elif defined(CATEGORY_BPTREE)
+		(void)roots;
+		bpIter_t iter;
+		movieInfo_t *Info;
+		bpTreeSeek(catalog->categoryArray[i]->index, &iter, INT_MIN);
+		while((Info = bpIterNext(&iter)) != NULL)
+		{
+			snapshotEmit(&writer, Info, sizeof(movieInfo_t));
+			header.categories[i].count++;
+		}
+#else
+		snapshotEmitMovies(&writer, &header.categories[i], roots[i]);
+#endif
+	}
+	catalogReadEnd(version);
+
+	// New releases and users
+	epochEnter(&catalog->epoch);
+	snapshotBeginSection(&writer, &header.newMovies);
+	snapshotEmitNewMovies(&writer, &header.newMovies, EPOCH_READ(catalog->newMoviesTree.root));
+
+	userChains_t *chains = userTableChains(&catalog->userTable);
+	uint64_t n_leaves = 0;
+	snapshotBeginSection(&writer, &header.users);
+	for(int key=0; key < chains->size; key++)
+	{
+		for(user_t *user = EPOCH_READ(chains->chains[key]); user != NULL; user = EPOCH_READ(user->next))
+		{
+			userMovie_t *history = EPOCH_READ(user->history);
+			snapshotUser_t record = {user->userID, history != NULL ? snapshotCountLeaves(&writer, history) : user->n_snapshot, n_leaves};
+			snapshotEmit(&writer, &record, sizeof(record));
+			header.users.count++;
+			n_leaves += record.n_history;
+		}
+	}
+
+	// Histories never built since they were loaded are copied as they are
+	snapshotBeginSection(&writer, &header.history);
+	for(int key=0; key < chains->size; key++)
+	{
+		for(user_t *user = EPOCH_READ(chains->chains[key]); user != NULL; user = EPOCH_READ(user->next))
+		{
+			userMovie_t *history = EPOCH_READ(user->history);
+			if(history != NULL) snapshotEmitLeaves(&writer, &header.history, history);
+			else
+			{
+				snapshotEmit(&writer, user->snapshot, user->n_snapshot * sizeof(snapshotLeaf_t));
+				header.history.count += user->n_snapshot;
+			}
+		}
+	}
+	header.hashtable_size = chains->size;
+	epochExit(&catalog->epoch);
+
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.format = SNAPSHOT_FORMAT;
+	header.header_size = sizeof(header);
+	header.file_size = writer.offset;
+	header.checksum = writer.checksum;
+	header.max_users = catalog->max_users;
+	header.max_id = catalog->max_id;
+	header.lsn = lsn;
+
+	if(!writer.failed && (fseek(writer.file, 0, SEEK_SET) != 0 || fwrite(&header, 1, sizeof(header), writer.file) != sizeof(header))) writer.failed = 1;
+	if(!writer.failed && (fflush(writer.file) != 0 || fsync(fileno(writer.file)) != 0)) writer.failed = 1;
+	if(fclose(writer.file) != 0) writer.failed = 1;
+
+	// Readers of path see either the previous snapshot or the complete new one
+	if(writer.failed || rename(tmp, path) != 0)
+	{
+		remove(tmp);
+		free(tmp);
+		return 0;
+	}
+	free(tmp);
+	return 1;
+}
+
+
+/**
+ * @brief Checks that a section lies inside the file
+ * @return returns 1 if True, 0 if False
+*/
+static int snapshotSectionValid(const snapshotHeader_t *header, const snapshotSection_t *section, size_t record)
+{
+	if(section->offset < header->header_size || section->offset > header->file_size) return 0;
+	if(section->offset % SNAPSHOT_ALIGN != 0) return 0;
+	return section->count <= (header->file_size - section->offset) / record;
+}
+
+
+/**
+ * @brief Maps the snapshot at path and validates its header, bounds and checksum
+ * @return returns 1 on success, 0 if the file can't be mapped or isn't a valid snapshot
+*/
+int snapshotOpen(snapshot_t *snapshot, const char *path)
+{
+	snapshot->base = NULL;
+	snapshot->size = 0;
+	snapshot->header = NULL;
+
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return 0;
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(snapshotHeader_t))
+	{
+		close(fd);
+		return 0;
+	}
+
+	// Private and writable, so that edits of the records in place never reach the file
+	char *base = (char*)mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(base == MAP_FAILED) return 0;
+
+	const snapshotHeader_t *header = (const snapshotHeader_t*)base;
+	int valid = memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0
+		&& header->format == SNAPSHOT_FORMAT
+		&& header->header_size == sizeof(snapshotHeader_t)
+		&& header->file_size == (uint64_t)st.st_size
+		&& header->hashtable_size > 0;
+	for(int i=0; i<6 && valid; i++) valid = snapshotSectionValid(header, &header->categories[i], sizeof(movieInfo_t));
+	valid = valid && snapshotSectionValid(header, &header->newMovies, sizeof(snapshotNewMovie_t));
+	valid = valid && snapshotSectionValid(header, &header->users, sizeof(snapshotUser_t));
+	valid = valid && snapshotSectionValid(header, &header->history, sizeof(snapshotLeaf_t));
+	if(valid)
+	{
+		// The whole file is read once here. Everything after this trusts the records
+		madvise(base, st.st_size, MADV_SEQUENTIAL);
+		valid = snapshotChecksum(SNAPSHOT_FNV_BASIS, base + header->header_size, header->file_size - header->header_size) == header->checksum;
+		madvise(base, st.st_size, MADV_NORMAL);
+	}
+	if(!valid)
+	{
+		munmap(base, st.st_size);
+		return 0;
+	}
+
+	snapshot->base = base;
+	snapshot->size = st.st_size;
+	snapshot->header = header;
+	return 1;
+}
+
+
+/**
+ * @brief Unmaps an opened snapshot. Nothing restored from it may be used afterwards
+ * @return returns void
+*/
+void snapshotClose(snapshot_t *snapshot)
+{
+	if(snapshot->base != NULL) munmap(snapshot->base, snapshot->size);
+	snapshot->base = NULL;
+	snapshot->size = 0;
+	snapshot->header = NULL;
+}
+
+
+#ifndef CATEGORY_INDEX
+/**
+ * @brief Makes a category tree node over a movieInfo_t record of the mapping
+ * @return returns the node, NULL on malloc failure
+*/
+static movie_t *snapshotMovieNode(movieInfo_t *Info, movie_t *sentinel)
+{
+	movie_t *movie = (movie_t*)malloc(sizeof(movie_t));
+	if(movie == NULL) return NULL;
+	movie->Info = Info;
+	movie->lc = sentinel;
+	movie->rc = sentinel;
+	movie->maxScore = MOVIE_NO_SCORE;
+#ifdef CATEGORY_PARENTS
+	movie->parent = NULL;
+#endif
+#ifdef CATALOG_VERSIONS
+	movie->version = catalog->versions.draft;
+#endif
+	return movie;
+}
+
+
+/**
+ * @brief Rebuilds a category tree from its pre-order. The stack holds the nodes still missing a right child
+ * @return returns 1 on success, 0 on malloc failure
+*/
+static int snapshotRestoreCategory(int category, movieInfo_t *records, uint64_t n)
+{
+	if(n == 0) return 1;
+	movie_t *sentinel = catalog->categoryArray[category]->sentinel;
+	movie_t **stack = (movie_t**)malloc(2 * n * sizeof(movie_t*));
+	if(stack == NULL) return 0;
+	movie_t **nodes = stack + n;
+
+	movie_t *root = sentinel;
+	uint64_t depth = 0;
+	for(uint64_t i=0; i < n; i++)
+	{
+		movie_t *movie = snapshotMovieNode(&records[i], sentinel);
+		if(movie == NULL)
+		{
+			PostOrderMovieDelete(root);
+			free(stack);
+			return 0;
+		}
+		int movieID = records[i].movieID;
+		if(depth == 0) root = movie;
+		else if(movieID < stack[depth-1]->Info->movieID)
+		{
+			stack[depth-1]->lc = movie;
+#ifdef CATEGORY_PARENTS
+			movie->parent = stack[depth-1];
+#endif
+		}
+		else
+		{
+			// The parent is the last node smaller than movieID on the way back up
+			movie_t *parent;
+			do parent = stack[--depth];
+			while(depth > 0 && stack[depth-1]->Info->movieID < movieID);
+			parent->rc = movie;
+#ifdef CATEGORY_PARENTS
+			movie->parent = parent;
+#endif
+		}
+		stack[depth++] = movie;
+		nodes[i] = movie;
+	}
+
+	// In reverse pre-order every node comes after its whole subtree, so the maxima are computed bottom-up
+	for(uint64_t i = n; i-- > 0; ) movieUpdateMaxScore(nodes[i]);
+	EPOCH_PUBLISH(catalog->categoryArray[category]->movie, root);
+#ifdef CATEGORY_PARENTS
+	// The map holds the node of every movie, for W to fix the maxima up from
+	for(uint64_t i=0; i < n; i++)
+	{
+		movieMapAdd(records[i].movieID);
+		movieMapDistribute(records[i].movieID, category, &records[i], nodes[i]);
+	}
+#endif
+	free(stack);
+	return 1;
+}
+#endif
+
+
+/**
+ * @brief Rebuilds the new releases tree from its pre-order
+ * @return returns 1 on success, 0 on malloc failure
+*/
+static int snapshotRestoreNewMovies(const snapshotNewMovie_t *records, uint64_t n)
+{
+	if(n == 0) return 1;
+	newMovie_t **stack = (newMovie_t**)malloc(n * sizeof(newMovie_t*));
+	if(stack == NULL) return 0;
+
+	newMovie_t *root = NULL;
+	uint64_t depth = 0;
+	for(uint64_t i=0; i < n; i++)
+	{
+		newMovie_t *newMovie = makeNewMovie(records[i].movieID, records[i].category, records[i].year);
+		if(newMovie == NULL)
+		{
+			deleteNewMoviesTreeIter(root);
+			free(stack);
+			return 0;
+		}
+		int movieID = records[i].movieID;
+		if(depth == 0) root = newMovie;
+		else if(movieID < stack[depth-1]->Info->movieID) stack[depth-1]->lc = newMovie;
+		else
+		{
+			newMovie_t *parent;
+			do parent = stack[--depth];
+			while(depth > 0 && stack[depth-1]->Info->movieID < movieID);
+			parent->rc = newMovie;
+		}
+		stack[depth++] = newMovie;
+	}
+	free(stack);
+	EPOCH_PUBLISH(catalog->newMoviesTree.root, root);
+	return 1;
+}
+
+
+/**
+ * @brief Restores the new releases, the category trees and the users from an opened snapshot.
+ * The structures must be initialized and empty; the users hashtable must have header->hashtable_size chains
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int snapshotRestore(snapshot_t *snapshot)
+{
+	const snapshotHeader_t *header = snapshot->header;
+
+	for(int i=0; i<6; i++)
+	{
+		movieInfo_t *records = (movieInfo_t*)(snapshot->base + header->categories[i].offset);
+		for(uint64_t j=0; j < header->categories[i].count; j++)
+		{
+			if(!yearIndexInsert(&catalog->categoryArray[i]->years, records[j].year, records[j].movieID)) return 0;
+		}
+#ifdef CATEGORY_SKIPLIST
+		for(uint64_t j=0; j < header->categories[i].count; j++)
+		{
+			if(!skipListInsert(catalog->categoryArray[i]->index, &records[j])) return 0;
+		}
+#elif defined(CATEGORY_BPTREE)
+		// The records are in ascending movieID, so every insert appends to the last leaf and keeps the leaves full
+		for(uint64_t j=0; j < header->categories[i].count; j++)
+		{
+			if(!bpTreeInsert(catalog->categoryArray[i]->index, &records[j])) return 0;
+		}
+#else
+		if(!snapshotRestoreCategory(i, records, header->categories[i].count)) return 0;
+#endif
+#ifdef CATEGORY_EYTZINGER
+		categoryLayoutBuild(i);
+#endif
+	}
+
+	const snapshotNewMovie_t *newMovies = (const snapshotNewMovie_t*)(snapshot->base + header->newMovies.offset);
+	for(uint64_t i=0; i < header->newMovies.count; i++)
+	{
+		if(newMovies[i].category < 0 || newMovies[i].category >= 6) return 0;
+	}
+	if(!snapshotRestoreNewMovies(newMovies, header->newMovies.count)) return 0;
+
+	// Map the categorized movies before the new releases, so that a movieID both have ends up unknown. With
+	// CATEGORY_PARENTS the categories were mapped as they were rebuilt, along with their nodes
+#ifndef CATEGORY_PARENTS
+	for(int i=0; i<6; i++)
+	{
+		movieInfo_t *records = (movieInfo_t*)(snapshot->base + header->categories[i].offset);
+		for(uint64_t j=0; j < header->categories[i].count; j++)
+		{
+			movieMapAdd(records[j].movieID);
+			movieMapDistribute(records[j].movieID, i, &records[j], NULL);
+		}
+	}
+#endif
+	for(uint64_t i=0; i < header->newMovies.count; i++) movieMapAdd(newMovies[i].movieID);
+
+	// Size the movie filter for the restored movies, with as much room again for new ones
+	uint64_t n_movies = header->newMovies.count;
+	for(int i=0; i<6; i++) n_movies += header->categories[i].count;
+	if(n_movies > INT_MAX / 2) return 0;
+	if(!movieFilterRebuild(n_movies < MOVIE_FILTER_CAPACITY / 2 ? MOVIE_FILTER_CAPACITY : (int)(2 * n_movies))) return 0;
+
+	// Users are appended in the order they were saved, which keeps the order of every chain
+	reserveUsers(header->max_users);
+	const snapshotUser_t *users = (const snapshotUser_t*)(snapshot->base + header->users.offset);
+	const snapshotLeaf_t *leaves = (const snapshotLeaf_t*)(snapshot->base + header->history.offset);
+	for(uint64_t i=0; i < header->users.count; i++)
+	{
+		if(users[i].n_history < 0 || users[i].history > header->history.count || (uint64_t)users[i].n_history > header->history.count - users[i].history) return 0;
+		user_t *user = makeNewUser(users[i].userID);
+		if(user == NULL) return 0;
+		user->snapshot = &leaves[users[i].history];
+		user->n_snapshot = users[i].n_history;
+		if(!userTableInsert(&catalog->userTable, user, NULL))
+		{
+			freeUser(user);
+			return 0;
+		}
+	}
+
+	catalog->max_users = header->max_users;
+	catalog->registrations = (int)header->users.count;
+	catalog->max_id = header->max_id;
+	userTableDirect(&catalog->userTable, catalog->max_id);
+	return 1;
+}
+
+
+/**
+ * @brief Checks whether a pointer points into the mapping of the loaded snapshot, and so must not be freed
+ * @return returns 1 if True, 0 if False
+*/
+int snapshotOwns(const void *ptr)
+{
+	const char *p = (const char*)ptr;
+	return catalog->snapshot.base != NULL && p >= catalog->snapshot.base && p < catalog->snapshot.base + catalog->snapshot.size;
+}
+
+
+/**
+ * @brief Builds the history subtree over leaves [lo, hi). Every internal node is a copy of the largest leaf on its left,
+ * like the ones addMovieToUser() makes
+ * @return returns the root, NULL on malloc failure
+*/
+static userMovie_t *snapshotBuildLeaves(const snapshotLeaf_t *leaves, int lo, int hi)
+{
+	if(hi - lo == 1) return makeNewUserMovie(leaves[lo].movieID, leaves[lo].category, leaves[lo].sumScore);
+
+	int mid = lo + (hi - lo) / 2;
+	userMovie_t *left = snapshotBuildLeaves(leaves, lo, mid);
+	userMovie_t *right = snapshotBuildLeaves(leaves, mid, hi);
+	userMovie_t *inner = makeNewUserMovie(leaves[mid-1].movieID, leaves[mid-1].category, leaves[mid-1].sumScore);
+	if(left == NULL || right == NULL || inner == NULL)
+	{
+		freeUserHistoryTree(left);
+		freeUserHistoryTree(right);
+		freeUserHistoryTree(inner);
+		return NULL;
+	}
+	inner->lc = left;
+	inner->rc = right;
+	left->parent = inner;
+	right->parent = inner;
+	return inner;
+}
+
+
+/**
+ * @brief Builds a history tree out of n leaves in ascending movieID
+ * @return returns the root, NULL on malloc failure or if n is 0
+*/
+userMovie_t *snapshotBuildHistory(const snapshotLeaf_t *leaves, int n)
+{
+	if(n == 0) return NULL;
+	return snapshotBuildLeaves(leaves, 0, n);
+}
@@ -0,0 +1,163 @@
+/*****************************************************
+ * @file   Snapshot.h                                 *
+ *                                                   *
+ * @brief Binary snapshots of the whole state        *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef SNAPSHOT_FILE
+#define SNAPSHOT_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+
+/*
+ * A snapshot holds the category trees, the new releases and the users hashtable with the
+ * history of every user, so that a process can start from it instead of replaying the whole
+ * event log. The file is a header followed by flat sections of fixed size records, addressed
+ * by offsets from the start of the file, in native byte order:
+ *
+ *   categories[i]  the movies of category i in pre-order, as movieInfo_t records
+ *   newMovies      the new releases in pre-order
+ *   users          the users chain by chain, in chain order
+ *   history        the watched movies of every user in ascending movieID, users back to back
+ *
+ * A pre-order fixes the shape of a BST, so the trees come back exactly as they were saved.
+ * The header carries a checksum of everything after it.
+ *
+ * Loading maps the file privately and uses it in place: the nodes of the category trees point
+ * straight at the movieInfo_t records of the mapping (a W copies the page it edits), and the
+ * history of a user is read from its records until its first W builds the tree (see
+ * userHistory()). The mapping stays for the lifetime of the process.
+ */
+
+#define SNAPSHOT_MAGIC "CS240SNP"
+#define SNAPSHOT_FORMAT 2		/* Bumped on every change of the layout */
+#define SNAPSHOT_ALIGN 8		/* Alignment of every section */
+
+
+/**
+ * Structure defining a section of the file
+*/
+typedef struct snapshot_section
+{
+	uint64_t offset;	/* Offset of the first record from the start of the file */
+	uint64_t count;		/* Number of records */
+}snapshotSection_t;
+
+
+/**
+ * Structure defining the header at the start of the file
+*/
+typedef struct snapshot_header
+{
+	char magic[8];						/* SNAPSHOT_MAGIC */
+	uint32_t format;					/* SNAPSHOT_FORMAT */
+	uint32_t header_size;				/* sizeof(snapshotHeader_t) */
+	uint64_t file_size;					/* Size of the whole file */
+	uint64_t checksum;					/* FNV-1a of the bytes after the header */
+	int32_t hashtable_size;				/* The number of chains of the users hashtable */
+	int32_t max_users;
+	int32_t max_id;
+	int32_t reserved;
+	uint64_t lsn;						/* LSN of the first logged event the snapshot doesn't contain (see Wal.h) */
+	snapshotSection_t categories[6];	/* movieInfo_t records */
+	snapshotSection_t newMovies;		/* snapshotNewMovie_t records */
+	snapshotSection_t users;			/* snapshotUser_t records */
+	snapshotSection_t history;			/* snapshotLeaf_t records */
+}snapshotHeader_t;
+
+
+/**
+ * Structure defining a new release record
+*/
+typedef struct snapshot_new_movie
+{
+	int32_t movieID;
+	int32_t year;
+	int32_t category;
+}snapshotNewMovie_t;
+
+
+/**
+ * Structure defining a user record
+*/
+typedef struct snapshot_user
+{
+	int32_t userID;
+	int32_t n_history;		/* Number of movies the user has watched */
+	uint64_t history;		/* Index of the first of them in the history section */
+}snapshotUser_t;
+
+
+/**
+ * Structure defining a watched movie record, a leaf of a history tree
+*/
+typedef struct snapshot_leaf
+{
+	int32_t movieID;
+	int32_t category;
+	int32_t sumScore;
+}snapshotLeaf_t;
+
+
+/**
+ * Structure defining an opened snapshot
+*/
+typedef struct snapshot
+{
+	char *base;							/* The private mapping of the file, NULL if none */
+	size_t size;						/* Size of the mapping */
+	const snapshotHeader_t *header;		/* The header at the start of the mapping */
+}snapshot_t;
+
+
+struct user_movie;
+
+
+/**
+ * @brief Writes the current state to path. The file is written next to it and renamed over it once synced.
+ * Readers may run meanwhile, writers may not. lsn is the LSN of the next event to log
+ * @return returns 1 on success, 0 on I/O or malloc failure
+*/
+int snapshotWrite(const char *path, uint64_t lsn);
+
+
+/**
+ * @brief Maps the snapshot at path and validates its header, bounds and checksum
+ * @return returns 1 on success, 0 if the file can't be mapped or isn't a valid snapshot
+*/
+int snapshotOpen(snapshot_t *snapshot, const char *path);
+
+
+/**
+ * @brief Unmaps an opened snapshot. Nothing restored from it may be used afterwards
+ * @return returns void
+*/
+void snapshotClose(snapshot_t *snapshot);
+
+
+/**
+ * @brief Restores the new releases, the category trees and the users from an opened snapshot.
+ * The structures must be initialized and empty; the users hashtable must have header->hashtable_size chains
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int snapshotRestore(snapshot_t *snapshot);
+
+
+/**
+ * @brief Checks whether a pointer points into the mapping of the loaded snapshot, and so must not be freed
+ * @return returns 1 if True, 0 if False
+*/
+int snapshotOwns(const void *ptr);
+
+
+/**
+ * @brief Builds a history tree out of n leaves in ascending movieID
+ * @return returns the root, NULL on malloc failure or if n is 0
+*/
+struct user_movie *snapshotBuildHistory(const snapshotLeaf_t *leaves, int n);
+
+
+#endif
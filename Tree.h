@@ -0,0 +1,106 @@
+/*****************************************************
+ * @file   Tree.h                                     *
+ *                                                   *
+ * @brief Binary search trees specialized per node type *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef TREE_FILE
+#define TREE_FILE
+
+#include <stddef.h>
+#include "Epoch.h"
+#include "TreeWalk.h"
+
+
+/*
+ * The new releases, the categories and the histories are all binary search trees of movies,
+ * linked through lc and rc. Their searches, inserts and walks are defined once here, and each
+ * tree gets its own copy with its node type, key and comparison filled in. The comparisons are
+ * then inlined, and no call goes through a function pointer.
+ *
+ *   KEY(node)   the key of a node
+ *   CMP(a, b)   compares two keys: negative, 0 or positive as a is smaller, equal or larger
+ *   NIL         what a missing child points to: NULL, or a sentinel. It is evaluated once per call
+ *
+ * TREE_DEFINE(name, ...) is for trees that hold a key in every node. Keys equal to a node's key
+ * go to its right. It defines:
+ *   name##Find(root, key)        the node of key, NULL if there is none
+ *   name##Parent(root, key)      the node a new node of key is linked under, NULL if the tree is empty
+ *   name##Link(parent, node)     publishes node as the child of parent on the side of its key
+ *   name##WalkBegin(walk, order, root)
+ *
+ * TREE_DEFINE_LEAF(name, ...) is for leaf-oriented trees like the histories. Only the leaves hold
+ * keys, and every internal node routes keys up to its own to the left. It defines:
+ *   name##Leaf(root, key)        the leaf the search for key ends at, NULL if the tree is empty
+ *   name##Find(root, key)        the leaf of key, NULL if there is none
+ *   name##WalkBegin(walk, order, root)
+ *
+ * Links are read with EPOCH_READ, so the lock-free readers search the trees with the same code.
+ */
+
+#define TREE_CMP_INT(a, b) (((a) > (b)) - ((a) < (b)))
+
+
+#define TREE_DEFINE_WALK(name, node_t, NIL)																	\
+static inline void name##WalkBegin(treeWalk_t *walk, int order, node_t *root)								\
+{																											\
+	treeWalkBegin(walk, order, root, offsetof(node_t, lc), offsetof(node_t, rc), (NIL));					\
+}
+
+
+#define TREE_DEFINE(name, node_t, key_t, KEY, CMP, NIL)														\
+static inline node_t *name##Find(node_t *root, key_t key)													\
+{																											\
+	node_t *nil = (NIL);																					\
+	for(node_t *curr = root; curr != nil; )																	\
+	{																										\
+		int cmp = CMP(key, KEY(curr));																		\
+		if(cmp == 0) return curr;																			\
+		curr = cmp < 0 ? EPOCH_READ(curr->lc) : EPOCH_READ(curr->rc);										\
+	}																										\
+	return NULL;																							\
+}																											\
+																											\
+static inline node_t *name##Parent(node_t *root, key_t key)													\
+{																											\
+	node_t *nil = (NIL), *parent = NULL;																	\
+	for(node_t *curr = root; curr != nil; )																	\
+	{																										\
+		parent = curr;																						\
+		curr = CMP(key, KEY(curr)) < 0 ? EPOCH_READ(curr->lc) : EPOCH_READ(curr->rc);						\
+	}																										\
+	return parent;																							\
+}																											\
+																											\
+static inline void name##Link(node_t *parent, node_t *node)													\
+{																											\
+	if(CMP(KEY(node), KEY(parent)) < 0) EPOCH_PUBLISH(parent->lc, node);									\
+	else EPOCH_PUBLISH(parent->rc, node);																	\
+}																											\
+																											\
+TREE_DEFINE_WALK(name, node_t, NIL)
+
+
+#define TREE_DEFINE_LEAF(name, node_t, key_t, KEY, CMP, NIL)												\
+static inline node_t *name##Leaf(node_t *root, key_t key)													\
+{																											\
+	node_t *nil = (NIL), *leaf = NULL;																		\
+	for(node_t *curr = root; curr != nil; )																	\
+	{																										\
+		leaf = curr;																						\
+		curr = CMP(key, KEY(curr)) <= 0 ? EPOCH_READ(curr->lc) : EPOCH_READ(curr->rc);						\
+	}																										\
+	return leaf;																							\
+}																											\
+																											\
+static inline node_t *name##Find(node_t *root, key_t key)													\
+{																											\
+	node_t *leaf = name##Leaf(root, key);																	\
+	if(leaf == NULL || CMP(key, KEY(leaf)) != 0) return NULL;												\
+	return leaf;																							\
+}																											\
+																											\
+TREE_DEFINE_WALK(name, node_t, NIL)
+
+
+#endif
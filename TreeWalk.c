@@ -0,0 +1,212 @@
+/*****************************************************
+ * @file   TreeWalk.c                                 *
+ *                                                   *
+ * @brief Implementation for TreeWalk.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Empties a stack
+ * @return returns void
+*/
+void treeStackInit(treeStack_t *stack)
+{
+	stack->nodes = stack->inline_nodes;
+	stack->depth = 0;
+	stack->size = TREE_WALK_INLINE;
+	stack->failed = 0;
+}
+
+
+/**
+ * @brief Pushes a node, moving the stack to the heap or growing it as needed
+ * @return returns 1 on success, 0 on malloc failure, which also sets failed
+*/
+int treeStackPush(treeStack_t *stack, void *node)
+{
+	if(stack->depth == stack->size)
+	{
+		int size = 2 * stack->size;
+		void **nodes;
+		if(stack->nodes == stack->inline_nodes)
+		{
+			nodes = (void**)malloc(size * sizeof(void*));
+			if(nodes != NULL) memcpy(nodes, stack->inline_nodes, stack->depth * sizeof(void*));
+		}
+		else nodes = (void**)realloc(stack->nodes, size * sizeof(void*));
+		if(nodes == NULL)
+		{
+			stack->failed = 1;
+			return 0;
+		}
+		stack->nodes = nodes;
+		stack->size = size;
+	}
+	stack->nodes[stack->depth++] = node;
+	return 1;
+}
+
+
+/**
+ * @brief Pops a node
+ * @return returns the node, NULL if the stack is empty
+*/
+void *treeStackPop(treeStack_t *stack)
+{
+	if(stack->depth == 0) return NULL;
+	return stack->nodes[--stack->depth];
+}
+
+
+/**
+ * @brief Frees the heap part of a stack, leaving it empty
+ * @return returns void
+*/
+void treeStackFree(treeStack_t *stack)
+{
+	if(stack->nodes != stack->inline_nodes) free(stack->nodes);
+	stack->nodes = stack->inline_nodes;
+	stack->depth = 0;
+	stack->size = TREE_WALK_INLINE;
+}
+
+
+/**
+ * @brief Reads a child link of a node
+ * @return returns the child, NULL if it is missing
+*/
+static void *treeWalkLink(const treeWalk_t *walk, void *node, size_t offset)
+{
+	void *child = __atomic_load_n((void**)((char*)node + offset), __ATOMIC_ACQUIRE);
+	return child == walk->nil ? NULL : child;
+}
+
+
+/**
+ * @brief Checks whether the walk goes into a node, which the filter may reject
+ * @return returns the node, NULL if it is missing or rejected
+*/
+static void *treeWalkEnters(const treeWalk_t *walk, void *node)
+{
+	if(node == NULL || (walk->enter != NULL && !walk->enter(node, walk->arg))) return NULL;
+	return node;
+}
+
+
+/**
+ * @brief Starts a walk of the tree under root. lc and rc are the offsetof() the child links, nil what a missing child points to
+ * @return returns void
+*/
+void treeWalkBegin(treeWalk_t *walk, int order, void *root, size_t lc, size_t rc, const void *nil)
+{
+	walk->order = order;
+	walk->lc = lc;
+	walk->rc = rc;
+	walk->nil = nil;
+	walk->enter = NULL;
+	walk->arg = NULL;
+	walk->next = root == nil ? NULL : root;
+	walk->last = NULL;
+	treeStackInit(&walk->stack);
+}
+
+
+/**
+ * @brief Makes the walk skip every node enter() returns 0 for, along with its subtree. Call before the first treeWalkNext()
+ * @return returns void
+*/
+void treeWalkFilter(treeWalk_t *walk, int (*enter)(const void *node, void *arg), void *arg)
+{
+	walk->enter = enter;
+	walk->arg = arg;
+
+	// The root is still waiting in next, the filter may reject it too
+	walk->next = treeWalkEnters(walk, walk->next);
+}
+
+
+/**
+ * @brief Returns the next node of the walk
+ * @return returns the node, NULL once every node was returned or if the stack couldn't grow
+*/
+void *treeWalkNext(treeWalk_t *walk)
+{
+	treeStack_t *stack = &walk->stack;
+	if(stack->failed) return NULL;
+
+	if(walk->order == TREE_WALK_PRE)
+	{
+		// The root waits in next until the first call
+		if(walk->next != NULL)
+		{
+			if(!treeStackPush(stack, walk->next)) return NULL;
+			walk->next = NULL;
+		}
+		void *node = treeStackPop(stack);
+		if(node == NULL) return NULL;
+
+		// The right subtree goes below the left one, so it is walked after it
+		void *right = treeWalkEnters(walk, treeWalkLink(walk, node, walk->rc));
+		void *left = treeWalkEnters(walk, treeWalkLink(walk, node, walk->lc));
+		if(right != NULL && !treeStackPush(stack, right)) return NULL;
+		if(left != NULL && !treeStackPush(stack, left)) return NULL;
+		return node;
+	}
+
+	for(;;)
+	{
+		// Descend the left spine of the pending subtree, keeping every node on it to come back to
+		for(void *node = walk->next; node != NULL; node = treeWalkEnters(walk, treeWalkLink(walk, node, walk->lc)))
+		{
+			if(!treeStackPush(stack, node)) return NULL;
+		}
+		walk->next = NULL;
+		if(stack->depth == 0) return NULL;
+		void *top = stack->nodes[stack->depth - 1];
+
+		if(walk->order == TREE_WALK_IN)
+		{
+			stack->depth--;
+			walk->next = treeWalkEnters(walk, treeWalkLink(walk, top, walk->rc));
+			return top;
+		}
+
+		// In post-order a node is returned once its right subtree is done, which ends with the right child itself.
+		// The node returned last may be freed already, so it is compared before the filter looks at it
+		void *right = treeWalkLink(walk, top, walk->rc);
+		if(right != NULL && right != walk->last && treeWalkEnters(walk, right) != NULL)
+		{
+			walk->next = right;
+			continue;
+		}
+		stack->depth--;
+		walk->last = top;
+		return top;
+	}
+}
+
+
+/**
+ * @brief In a post-order walk, returns the parent of the node returned last
+ * @return returns the parent, NULL for the root
+*/
+void *treeWalkParent(treeWalk_t *walk)
+{
+	if(walk->stack.depth == 0) return NULL;
+	return walk->stack.nodes[walk->stack.depth - 1];
+}
+
+
+/**
+ * @brief Ends a walk, finished or not
+ * @return returns 1 if the walk returned every node it was to return, 0 if it stopped on malloc failure
+*/
+int treeWalkEnd(treeWalk_t *walk)
+{
+	int failed = walk->stack.failed;
+	treeStackFree(&walk->stack);
+	walk->stack.failed = 0;
+	return !failed;
+}
@@ -0,0 +1,133 @@
+/*****************************************************
+ * @file   TreeWalk.h                                 *
+ *                                                   *
+ * @brief Explicit stack walks of the binary trees   *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef TREEWALK_FILE
+#define TREEWALK_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+
+
+/*
+ * The category trees, the new releases tree and the histories are walked without recursion.
+ * The movie IDs of a feed are mostly sorted, so those trees are often a chain as deep as they
+ * are big. A recursive walk of such a chain would overflow the call stack.
+ *
+ * A walk keeps the nodes it still has to come back to on a stack of its own. The first
+ * TREE_WALK_INLINE of them fit in the walk itself, so the walks of balanced trees and short
+ * chains never allocate. Past that the stack moves to the heap and doubles as needed. A walk
+ * knows a tree only by the offsets of the two child links in a node and by what a missing child
+ * points to: NULL, or the sentinel of the category trees. Each call to treeWalkNext() returns
+ * the next node in pre-, in- or post-order. The caller may stop at any node; treeWalkEnd()
+ * releases the stack either way.
+ *
+ * Children are read with an acquire load, as EPOCH_READ does, so the lock-free readers walk the trees the same way.
+ * A walk that is given a filter treats the nodes it rejects as missing children, so whole
+ * subtrees are skipped, like those of F whose best score is too low.
+ */
+
+#define TREE_WALK_INLINE 64			/* Nodes a walk keeps before its stack moves to the heap */
+
+#define TREE_WALK_PRE 0				/* A node, then its left subtree, then its right one */
+#define TREE_WALK_IN 1				/* The left subtree, the node, the right subtree */
+#define TREE_WALK_POST 2			/* Both subtrees, then the node. Safe to free each node as it is returned */
+
+
+/**
+ * Structure defining a stack of nodes that starts in place and moves to the heap once full
+*/
+typedef struct tree_stack
+{
+	void **nodes;					/* inline until the stack outgrows it */
+	int depth;
+	int size;
+	int failed;						/* Set once a push found no memory */
+	void *inline_nodes[TREE_WALK_INLINE];
+}treeStack_t;
+
+
+/**
+ * Structure defining a walk of a tree
+*/
+typedef struct tree_walk
+{
+	int order;						/* TREE_WALK_PRE, _IN or _POST */
+	size_t lc;						/* Offset of the left child link in a node */
+	size_t rc;						/* Offset of the right child link in a node */
+	const void *nil;				/* What a missing child points to */
+	int (*enter)(const void *node, void *arg);	/* If set, nodes it returns 0 for are skipped with their subtree */
+	void *arg;
+	void *next;						/* In- and post-order: the subtree to descend into next */
+	void *last;						/* Post-order: the node returned last */
+	treeStack_t stack;				/* Pre-order: the subtrees still to walk. Otherwise: the nodes still to return */
+}treeWalk_t;
+
+
+/**
+ * @brief Empties a stack
+ * @return returns void
+*/
+void treeStackInit(treeStack_t *stack);
+
+
+/**
+ * @brief Pushes a node, moving the stack to the heap or growing it as needed
+ * @return returns 1 on success, 0 on malloc failure, which also sets failed
+*/
+int treeStackPush(treeStack_t *stack, void *node);
+
+
+/**
+ * @brief Pops a node
+ * @return returns the node, NULL if the stack is empty
+*/
+void *treeStackPop(treeStack_t *stack);
+
+
+/**
+ * @brief Frees the heap part of a stack, leaving it empty
+ * @return returns void
+*/
+void treeStackFree(treeStack_t *stack);
+
+
+/**
+ * @brief Starts a walk of the tree under root. lc and rc are the offsetof() the child links, nil what a missing child points to
+ * @return returns void
+*/
+void treeWalkBegin(treeWalk_t *walk, int order, void *root, size_t lc, size_t rc, const void *nil);
+
+
+/**
+ * @brief Makes the walk skip every node enter() returns 0 for, along with its subtree. Call before the first treeWalkNext()
+ * @return returns void
+*/
+void treeWalkFilter(treeWalk_t *walk, int (*enter)(const void *node, void *arg), void *arg);
+
+
+/**
+ * @brief Returns the next node of the walk
+ * @return returns the node, NULL once every node was returned or if the stack couldn't grow
+*/
+void *treeWalkNext(treeWalk_t *walk);
+
+
+/**
+ * @brief In a post-order walk, returns the parent of the node returned last
+ * @return returns the parent, NULL for the root
+*/
+void *treeWalkParent(treeWalk_t *walk);
+
+
+/**
+ * @brief Ends a walk, finished or not
+ * @return returns 1 if the walk returned every node it was to return, 0 if it stopped on malloc failure
+*/
+int treeWalkEnd(treeWalk_t *walk);
+
+
+#endif
@@ -0,0 +1,501 @@
+/*****************************************************
+ * @file   UserTable.c                                *
+ *                                                   *
+ * @brief Implementation for UserTable.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+// This is a very conservative progress on the hashtable. Our purpose
+// is to force many rehashes to check the stability of the code.
+static int primes_g[160] = 		{  5,   7,  11,  13,  17,  19,  23,  29,  31,  37,
+                               41,  43,  47,  53,  59,  61,  67,  71,  73,  79,
+                               83,  89,  97, 101, 103, 107, 109, 113, 127, 131,
+                              137, 139, 149, 151, 157, 163, 167, 173, 179, 181,
+                              191, 193, 197, 199, 211, 223, 227, 229, 233, 239,
+                              241, 251, 257, 263, 269, 271, 277, 281, 283, 293,
+                              307, 311, 313, 317, 331, 337, 347, 349, 353, 359,
+                              367, 373, 379, 383, 389, 397, 401, 409, 419, 421,
+                              431, 433, 439, 443, 449, 457, 461, 463, 467, 479,
+                              487, 491, 499, 503, 509, 521, 523, 541, 547, 557,
+                              563, 569, 571, 577, 587, 593, 599, 601, 607, 613,
+                              617, 619, 631, 641, 643, 647, 653, 659, 661, 673,
+                              677, 683, 691, 701, 709, 719, 727, 733, 739, 743,
+                              751, 757, 761, 769, 773, 787, 797, 809, 811, 821,
+                              823, 827, 829, 839, 853, 857, 859, 863, 877, 881,
+                              883, 887, 907, 911, 919, 929, 937, 941, 947, 953};
+
+
+/**
+ * @brief Makes an array of size empty chains
+ * @return returns the array, NULL on malloc failure
+*/
+static userChains_t *makeUserChains(int size)
+{
+	userChains_t *chains = (userChains_t*)malloc(sizeof(userChains_t) + size * sizeof(user_t*));
+	if(chains == NULL) return NULL;
+	chains->filter = makeBloom(USER_TABLE_LOAD * size);
+	if(chains->filter == NULL)
+	{
+		free(chains);
+		return NULL;
+	}
+	chains->size = size;
+	for(int i=0; i < size; i++) chains->chains[i] = NULL;
+	return chains;
+}
+
+
+/**
+ * @brief Epoch reclaim function for an array replaced by a resize. Frees the array and the old copies of the
+ * records, but not the history trees, which now belong to the new copies
+ * @return returns void
+*/
+static void reclaimUserChains(void *object)
+{
+	userChains_t *chains = (userChains_t*)object;
+	for(int i=0; i < chains->size; i++)
+	{
+		user_t *user = chains->chains[i];
+		while(user != NULL)
+		{
+			user_t *next = user->next;
+			freeUser(user);
+			user = next;
+		}
+	}
+	deleteBloom(chains->filter);
+	free(chains);
+}
+
+
+/**
+ * @brief Checks whether the direct index covers a userID
+ * @return returns 1 if True, 0 if False
+*/
+static int userDirectCovers(userDirect_t *direct, int userID)
+{
+	return direct != NULL && userID >= 0 && userID <= direct->limit;
+}
+
+
+/**
+ * @brief Publishes a user in its slot, then sets its bit. Call with the user's stripe locked
+ * @return returns void
+*/
+static void userDirectLink(userDirect_t *direct, user_t *user)
+{
+	EPOCH_PUBLISH(direct->users[user->userID], user);
+	__atomic_fetch_or(&direct->present[user->userID >> 6], UINT64_C(1) << (user->userID & 63), __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Clears the bit of a userID, then its slot. Call with the user's stripe locked
+ * @return returns void
+*/
+static void userDirectUnlink(userDirect_t *direct, int userID)
+{
+	__atomic_fetch_and(&direct->present[userID >> 6], ~(UINT64_C(1) << (userID & 63)), __ATOMIC_RELEASE);
+	EPOCH_PUBLISH(direct->users[userID], NULL);
+}
+
+
+/**
+ * @brief Picks the size of the array a resize grows into: the next prime of primes_g at least twice as big, an odd number past them
+ * @return returns the new size
+*/
+static int userTableNextSize(int size)
+{
+	for(int i=0; i<160; i++)
+	{
+		if(primes_g[i] >= 2 * size) return primes_g[i];
+	}
+	return 2 * size + 1;
+}
+
+
+/**
+ * @brief Grows the table. Writers wait on the stripes while readers keep using the array they loaded
+ * @return returns void
+*/
+static void userTableResize(userTable_t *table, int size)
+{
+	for(int i=0; i < USER_TABLE_STRIPES; i++) pthread_mutex_lock(&table->stripes[i].lock);
+
+	// Another writer may have resized already
+	userChains_t *old = table->current;
+	if(old->size != size)
+	{
+		for(int i = USER_TABLE_STRIPES - 1; i >= 0; i--) pthread_mutex_unlock(&table->stripes[i].lock);
+		return;
+	}
+
+	userChains_t *chains = makeUserChains(userTableNextSize(size));
+	if(chains == NULL)
+	{
+		for(int i = USER_TABLE_STRIPES - 1; i >= 0; i--) pthread_mutex_unlock(&table->stripes[i].lock);
+		return;
+	}
+
+	// Copy every record into the new array, keeping the relative order of users that share a chain
+	for(int i=0; i < old->size; i++)
+	{
+		for(user_t *user = old->chains[i]; user != NULL; user = user->next)
+		{
+			user_t *copy = makeNewUser(user->userID);
+			if(copy == NULL)
+			{
+				// Give up on the resize. The copies made so far own nothing but themselves
+				reclaimUserChains(chains);
+				for(int j = USER_TABLE_STRIPES - 1; j >= 0; j--) pthread_mutex_unlock(&table->stripes[j].lock);
+				return;
+			}
+			copy->history = user->history;
+			copy->snapshot = user->snapshot;
+			copy->n_snapshot = user->n_snapshot;
+			copy->version = user->version;
+			bloomAdd(chains->filter, copy->userID);
+			if(userDirectCovers(table->direct, copy->userID)) EPOCH_PUBLISH(table->direct->users[copy->userID], copy);
+			int key = userTableKey(chains, copy->userID);
+			user_t **tail = &chains->chains[key];
+			while(*tail != NULL) tail = &(*tail)->next;
+			*tail = copy;
+		}
+	}
+
+	// The records moved into copies, so a probe that found one of the old ones has to look the user up again
+	__atomic_add_fetch(&table->changes, 1, __ATOMIC_RELEASE);
+	EPOCH_PUBLISH(table->current, chains);
+	for(int i = USER_TABLE_STRIPES - 1; i >= 0; i--) pthread_mutex_unlock(&table->stripes[i].lock);
+	epochRetire(table->epoch, old, reclaimUserChains);
+}
+
+
+/**
+ * @brief Indexes the userIDs from 0 to maxID directly, replacing the current index. Drops the index if maxID is
+ * negative or larger than USER_TABLE_DIRECT_MAX
+ * @return returns 1 if the users are indexed directly, 0 otherwise
+*/
+int userTableDirect(userTable_t *table, int maxID)
+{
+	userDirect_t *direct = NULL;
+	if(maxID >= 0 && maxID <= USER_TABLE_DIRECT_MAX)
+	{
+		size_t words = (size_t)maxID / 64 + 1;
+		direct = (userDirect_t*)calloc(1, sizeof(userDirect_t) + ((size_t)maxID + 1) * sizeof(user_t*) + words * sizeof(uint64_t));
+
+		// The index in place still covers its own range, so it stays
+		if(direct == NULL) return 0;
+		direct->limit = maxID;
+		direct->present = (uint64_t*)&direct->users[maxID + 1];
+	}
+
+	// Holding every stripe, no user is linked or unlinked while the index fills
+	for(int i=0; i < USER_TABLE_STRIPES; i++) pthread_mutex_lock(&table->stripes[i].lock);
+	userChains_t *chains = table->current;
+	for(int i=0; direct != NULL && i < chains->size; i++)
+	{
+		for(user_t *user = chains->chains[i]; user != NULL; user = user->next)
+		{
+			if(!userDirectCovers(direct, user->userID)) continue;
+			direct->users[user->userID] = user;
+			direct->present[user->userID >> 6] |= UINT64_C(1) << (user->userID & 63);
+		}
+	}
+	userDirect_t *old = table->direct;
+	EPOCH_PUBLISH(table->direct, direct);
+	for(int i = USER_TABLE_STRIPES - 1; i >= 0; i--) pthread_mutex_unlock(&table->stripes[i].lock);
+	if(old != NULL) epochRetire(table->epoch, old, free);
+	return direct != NULL;
+}
+
+
+/**
+ * @brief Initializes the table with size empty chains
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int userTableInit(userTable_t *table, int size, epochDomain_t *epoch)
+{
+	table->current = makeUserChains(size);
+	if(table->current == NULL) return 0;
+	for(int i=0; i < USER_TABLE_STRIPES; i++) pthread_mutex_init(&table->stripes[i].lock, NULL);
+	table->count = 0;
+	table->changes = 0;
+	table->direct = NULL;
+	table->epoch = epoch;
+	return 1;
+}
+
+
+/**
+ * @brief Returns the chain a userID hashes to in the given array
+ * @return returns the chain index
+*/
+int userTableKey(userChains_t *chains, int userID)
+{
+	return hash_function(catalog->a, catalog->b, userID, chains->size, catalog->p);
+}
+
+
+/**
+ * @brief Returns the published array of chains. Call inside a read section
+ * @return returns the array of chains
+*/
+userChains_t *userTableChains(userTable_t *table)
+{
+	return EPOCH_READ(table->current);
+}
+
+
+/**
+ * @brief Lock-free lookup of a user. Call inside a read section or with the user's stripe locked
+ * @return returns the user, NULL if it isn't registered
+*/
+user_t *userTableFind(userTable_t *table, int userID)
+{
+	// The bitmap answers for the userIDs of the direct index, whether the user exists or not
+	userDirect_t *direct = EPOCH_READ(table->direct);
+	if(userDirectCovers(direct, userID))
+	{
+		if(!(__atomic_load_n(&direct->present[userID >> 6], __ATOMIC_ACQUIRE) & (UINT64_C(1) << (userID & 63)))) return NULL;
+		return EPOCH_READ(direct->users[userID]);
+	}
+
+	userChains_t *chains = EPOCH_READ(table->current);
+	if(!bloomMayContain(chains->filter, userID)) return NULL;
+	user_t *user = EPOCH_READ(chains->chains[userTableKey(chains, userID)]);
+	while(user != NULL && user->userID != userID) user = EPOCH_READ(user->next);
+	return user;
+}
+
+
+/**
+ * @brief Starts a lookup of userID to be advanced with userTableProbeStep(). Call inside a read section,
+ * which must last until the probe is done
+ * @return returns void
+*/
+void userTableProbeStart(userTable_t *table, userProbe_t *probe, int userID)
+{
+	probe->userID = userID;
+	probe->user = NULL;
+	probe->changes = __atomic_load_n(&table->changes, __ATOMIC_ACQUIRE);
+	probe->direct = EPOCH_READ(table->direct);
+	if(userDirectCovers(probe->direct, userID))
+	{
+		// The bit and the slot are independent lines, both are fetched at once
+		__builtin_prefetch(&probe->direct->present[userID >> 6]);
+		__builtin_prefetch(&probe->direct->users[userID]);
+		probe->stage = USER_PROBE_BIT;
+		return;
+	}
+
+	// The filter would cost a miss of its own, a probe walks the chain straight away
+	userChains_t *chains = EPOCH_READ(table->current);
+	probe->direct = NULL;
+	probe->head = &chains->chains[userTableKey(chains, userID)];
+	__builtin_prefetch(probe->head);
+	probe->stage = USER_PROBE_HEAD;
+}
+
+
+/**
+ * @brief Advances a lookup by one read. The user is prefetched, not read, by the last step
+ * @return returns 1 while the lookup needs more steps, 0 once probe->user holds the user or NULL
+*/
+int userTableProbeStep(userProbe_t *probe)
+{
+	int userID = probe->userID;
+	switch(probe->stage)
+	{
+		case USER_PROBE_BIT:
+			if(__atomic_load_n(&probe->direct->present[userID >> 6], __ATOMIC_ACQUIRE) & (UINT64_C(1) << (userID & 63)))
+			{
+				probe->user = EPOCH_READ(probe->direct->users[userID]);
+				__builtin_prefetch(probe->user);
+			}
+			probe->stage = USER_PROBE_DONE;
+			return 0;
+		case USER_PROBE_HEAD:
+			probe->user = EPOCH_READ(*probe->head);
+			probe->stage = USER_PROBE_CHAIN;
+			if(probe->user == NULL) break;
+			__builtin_prefetch(probe->user);
+			return 1;
+		case USER_PROBE_CHAIN:
+			if(probe->user == NULL || probe->user->userID == userID) break;
+			probe->user = EPOCH_READ(probe->user->next);
+			if(probe->user != NULL) __builtin_prefetch(probe->user);
+			return 1;
+		default:
+			return 0;
+	}
+	probe->stage = USER_PROBE_DONE;
+	return 0;
+}
+
+
+/**
+ * @brief Unlocks a stripe locked with userTableLocate()
+ * @return returns void
+*/
+void userTableUnlock(userTable_t *table, int stripe)
+{
+	pthread_mutex_unlock(&table->stripes[stripe].lock);
+}
+
+
+/**
+ * @brief Locks the stripe of userID, filling slot->chains, slot->key and slot->stripe
+ * @return returns void
+*/
+static void userTableLockStripe(userTable_t *table, int userID, userSlot_t *slot)
+{
+	// The epoch keeps the array alive until we hold a stripe. The key that picks the stripe picks the chain too
+	epochEnter(table->epoch);
+	for(;;)
+	{
+		slot->chains = EPOCH_READ(table->current);
+		slot->key = userTableKey(slot->chains, userID);
+		slot->stripe = slot->key % USER_TABLE_STRIPES;
+		pthread_mutex_lock(&table->stripes[slot->stripe].lock);
+		if(slot->chains == table->current) break;
+		pthread_mutex_unlock(&table->stripes[slot->stripe].lock);
+	}
+	epochExit(table->epoch);
+	slot->link = NULL;
+	slot->prev = NULL;
+}
+
+
+/**
+ * @brief Finds userID with its stripe locked: the bit and slot of the direct index, or one walk of the chain
+ * @return returns the user, NULL if it isn't registered
+*/
+static user_t *userTableLookup(userTable_t *table, int userID, userSlot_t *slot, int chain)
+{
+	userDirect_t *direct = table->direct;
+	if(!chain && userDirectCovers(direct, userID))
+	{
+		slot->user = (__atomic_load_n(&direct->present[userID >> 6], __ATOMIC_ACQUIRE) & (UINT64_C(1) << (userID & 63))) ? direct->users[userID] : NULL;
+		return slot->user;
+	}
+
+	user_t **link = &slot->chains->chains[slot->key];
+	while(*link != NULL && (*link)->userID != userID)
+	{
+		slot->prev = *link;
+		link = &(*link)->next;
+	}
+	slot->link = link;
+	slot->user = *link;
+	return slot->user;
+}
+
+
+/**
+ * @brief Locks the stripe of userID and finds the user in the same probe: one hash, then the bit and slot of the
+ * direct index or one walk of the chain. With chain set the chain is walked even for the direct index, so that
+ * slot->link and slot->prev are filled in too
+ * @return returns the user, NULL if it isn't registered. Either way slot->stripe is locked
+*/
+user_t *userTableLocate(userTable_t *table, int userID, userSlot_t *slot, int chain)
+{
+	userTableLockStripe(table, userID, slot);
+	return userTableLookup(table, userID, slot, chain);
+}
+
+
+/**
+ * @brief Locks the stripe of the user a finished probe looked up and returns the probe's result, which stands as long
+ * as no user was inserted or removed and the table wasn't resized since the probe started. Otherwise the user is
+ * looked up again, as userTableLocate() does without chain. Call inside the read section the probe ran in
+ * @return returns the user, NULL if it isn't registered. Either way slot->stripe is locked
+*/
+user_t *userTableLocateProbed(userTable_t *table, const userProbe_t *probe, userSlot_t *slot)
+{
+	// Inserts, removes and resizes count themselves before unlocking, so with the stripe held an unchanged count covers this user too
+	userTableLockStripe(table, probe->userID, slot);
+	if(__atomic_load_n(&table->changes, __ATOMIC_ACQUIRE) != probe->changes) return userTableLookup(table, probe->userID, slot, 0);
+	slot->user = probe->user;
+	return slot->user;
+}
+
+
+/**
+ * @brief Appends the user to the tail of its chain, resizing the table if it got too loaded. If slot isn't NULL
+ * it is left holding the chain the user ended up in, to read inside a read section entered before the call
+ * @return returns 1 on success, 0 if a user with the same userID is already registered
+*/
+int userTableInsert(userTable_t *table, user_t *user, userSlot_t *slot)
+{
+	userSlot_t here;
+	if(slot == NULL) slot = &here;
+
+	// The walk that looks for a duplicate ends on the tail link
+	if(userTableLocate(table, user->userID, slot, 1) != NULL)
+	{
+		userTableUnlock(table, slot->stripe);
+		return 0;
+	}
+	user->next = NULL;
+
+	// The filter admits the user before readers can reach it
+	bloomAdd(slot->chains->filter, user->userID);
+	EPOCH_PUBLISH(*slot->link, user);
+	if(userDirectCovers(table->direct, user->userID)) userDirectLink(table->direct, user);
+	int count = __atomic_add_fetch(&table->count, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&table->changes, 1, __ATOMIC_RELEASE);
+	int size = slot->chains->size;
+	userTableUnlock(table, slot->stripe);
+
+	if(count > USER_TABLE_LOAD * size)
+	{
+		// The user now lives in another chain of a bigger array, the only case that hashes it again
+		userTableResize(table, size);
+		slot->chains = EPOCH_READ(table->current);
+		slot->key = userTableKey(slot->chains, user->userID);
+	}
+	slot->user = user;
+	return 1;
+}
+
+
+/**
+ * @brief Unlinks a user from its chain. The caller retires it once unlinked
+ * @return returns the unlinked user, NULL if it isn't registered
+*/
+user_t *userTableRemove(userTable_t *table, int userID)
+{
+	userSlot_t slot;
+	user_t *user = userTableLocate(table, userID, &slot, 1);
+	if(user != NULL)
+	{
+		// Readers already on the user keep following its next pointer, which stays intact
+		EPOCH_PUBLISH(*slot.link, user->next);
+		if(userDirectCovers(table->direct, userID)) userDirectUnlink(table->direct, userID);
+		bloomRemove(slot.chains->filter, userID);
+		__atomic_sub_fetch(&table->count, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&table->changes, 1, __ATOMIC_RELEASE);
+	}
+	userTableUnlock(table, slot.stripe);
+	return user;
+}
+
+
+/**
+ * @brief Frees the chains and every user with its history. Only valid once no other thread uses the table
+ * @return returns void
+*/
+void deleteUserTable(userTable_t *table)
+{
+	if(table->current == NULL) return;
+	for(int i=0; i < table->current->size; i++) deleteUserChainIter(table->current->chains[i]);
+	deleteBloom(table->current->filter);
+	free(table->current);
+	table->current = NULL;
+	free(table->direct);
+	table->direct = NULL;
+	for(int i=0; i < USER_TABLE_STRIPES; i++) pthread_mutex_destroy(&table->stripes[i].lock);
+}
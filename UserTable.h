@@ -0,0 +1,230 @@
+/*****************************************************
+ * @file   UserTable.h                                *
+ *                                                   *
+ * @brief Concurrent users hashtable                 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef USERTABLE_FILE
+#define USERTABLE_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "Epoch.h"
+#include "Bloom.h"
+
+
+/*
+ * The users hashtable is an array of chains published through a single pointer.
+ * Lookups load the array once and walk a chain without taking any lock; they must run
+ * inside a read section of the table's epoch domain. Inserts, deletes and anything that
+ * modifies a user (its history) lock the stripe that guards the user's chain.
+ *
+ * When the average chain grows past USER_TABLE_LOAD the table is resized online: the
+ * resizer takes every stripe, so writers wait, builds a bigger array holding copies of the
+ * user records and publishes it. Readers carry on with whichever array they loaded, and
+ * the old array and records are retired to the epoch domain. The history trees move to
+ * the copies as they are, so a user is only ever modified through the current array.
+ *
+ * Every array carries a bloom filter (see Bloom.h) of the userIDs linked in it, sized for
+ * the load that triggers the next resize, so that a lookup of an unregistered user is
+ * mostly answered without walking a chain. A resize builds the filter of the new array.
+ *
+ * Once max_id is known and at most USER_TABLE_DIRECT_MAX, the table also indexes the users
+ * directly by userID: a presence bitmap and an array of user pointers, so that a lookup
+ * neither hashes nor walks a chain. The chains stay, they keep the order P prints and serve
+ * the userIDs outside the index. A user is published in its slot before its bit is set, and
+ * its bit is cleared before its slot, so a reader that finds the bit set reads the slot.
+ * A resize points the slots at the copies while it holds every stripe.
+ */
+
+#define USER_TABLE_STRIPES 64	/* Number of locks guarding the chains */
+#define USER_TABLE_LOAD 2		/* Average chain length that triggers a resize */
+#ifndef USER_TABLE_DIRECT_MAX
+#define USER_TABLE_DIRECT_MAX (1 << 20)	/* Largest max_id indexed directly, override with -DUSER_TABLE_DIRECT_MAX=<n> */
+#endif
+
+struct user;
+
+
+/**
+ * Structure defining a published array of chains
+*/
+typedef struct user_chains
+{
+	int size;					/* The number of chains */
+	bloom_t *filter;			/* The userIDs linked in the chains */
+	struct user *chains[];		/* The chains (pinakas katakermatismoy xrhstwn) */
+}userChains_t;
+
+
+/**
+ * Structure defining the direct index of the userIDs from 0 to limit
+*/
+typedef struct user_direct
+{
+	int limit;					/* The largest userID indexed */
+	uint64_t *present;			/* Bit i is set while user i is linked */
+	struct user *users[];		/* users[i] is user i in the current array */
+}userDirect_t;
+
+
+/**
+ * Structure defining a stripe lock in its own cache line
+*/
+typedef struct user_stripe
+{
+	pthread_mutex_t lock;
+}__attribute__((aligned(EPOCH_CACHE_LINE))) userStripe_t;
+
+
+/**
+ * Structure defining a lookup advanced one cache miss at a time, so that a batch of them can be interleaved.
+ * Each step reads the line the previous step prefetched and prefetches the next one
+*/
+typedef struct user_probe
+{
+	int userID;
+	int stage;					/* What the next step reads, USER_PROBE_DONE once the lookup ended */
+	userDirect_t *direct;		/* The direct index covering userID, NULL if the chains hold it */
+	struct user **head;			/* The head of the chain of userID */
+	struct user *user;			/* The user the next step reads, the result once done */
+	unsigned changes;			/* The changes of the table when the lookup started */
+}userProbe_t;
+
+#define USER_PROBE_BIT 0		/* Read the bit of the direct index */
+#define USER_PROBE_HEAD 1		/* Read the head of the chain */
+#define USER_PROBE_CHAIN 2		/* Compare the user of the chain */
+#define USER_PROBE_DONE 3
+
+
+/**
+ * Structure defining where a userID is, or would be appended, in its chain. Filled by userTableLocate() with one
+ * hash and at most one walk of the chain, and valid while the stripe stays locked
+*/
+typedef struct user_slot
+{
+	userChains_t *chains;		/* The current array, which can't change while the stripe is locked */
+	int key;					/* The chain of userID in it */
+	int stripe;					/* The locked stripe, to hand to userTableUnlock() */
+	struct user **link;			/* The link to the user, or the NULL link at the tail of the chain if it isn't linked */
+	struct user *prev;			/* The user before link in the chain, NULL at the head */
+	struct user *user;			/* The user, NULL if it isn't registered */
+}userSlot_t;
+
+
+/**
+ * Structure defining the users hashtable
+*/
+typedef struct user_table
+{
+	userChains_t *current;							/* The published array of chains */
+	userStripe_t stripes[USER_TABLE_STRIPES];		/* Chain i is guarded by stripe i % USER_TABLE_STRIPES */
+	int count;										/* The number of registered users */
+	unsigned changes;								/* Counts the inserts, removes and resizes, each made with the user's stripe locked */
+	userDirect_t *direct;							/* The direct index, NULL while max_id is unknown or too big */
+	epochDomain_t *epoch;							/* Protects lock-free readers from resizes and deletes */
+}userTable_t;
+
+
+/**
+ * @brief Initializes the table with size empty chains
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int userTableInit(userTable_t *table, int size, epochDomain_t *epoch);
+
+
+/**
+ * @brief Returns the chain a userID hashes to in the given array
+ * @return returns the chain index
+*/
+int userTableKey(userChains_t *chains, int userID);
+
+
+/**
+ * @brief Returns the published array of chains. Call inside a read section
+ * @return returns the array of chains
+*/
+userChains_t *userTableChains(userTable_t *table);
+
+
+/**
+ * @brief Lock-free lookup of a user. Call inside a read section or with the user's stripe locked
+ * @return returns the user, NULL if it isn't registered
+*/
+struct user *userTableFind(userTable_t *table, int userID);
+
+
+/**
+ * @brief Starts a lookup of userID to be advanced with userTableProbeStep(). Call inside a read section,
+ * which must last until the probe is done
+ * @return returns void
+*/
+void userTableProbeStart(userTable_t *table, userProbe_t *probe, int userID);
+
+
+/**
+ * @brief Advances a lookup by one read. The user is prefetched, not read, by the last step
+ * @return returns 1 while the lookup needs more steps, 0 once probe->user holds the user or NULL
+*/
+int userTableProbeStep(userProbe_t *probe);
+
+
+/**
+ * @brief Unlocks a stripe locked with userTableLocate()
+ * @return returns void
+*/
+void userTableUnlock(userTable_t *table, int stripe);
+
+
+/**
+ * @brief Locks the stripe of userID and finds the user in the same probe: one hash, then the bit and slot of the
+ * direct index or one walk of the chain. With chain set the chain is walked even for the direct index, so that
+ * slot->link and slot->prev are filled in too
+ * @return returns the user, NULL if it isn't registered. Either way slot->stripe is locked
+*/
+struct user *userTableLocate(userTable_t *table, int userID, userSlot_t *slot, int chain);
+
+
+/**
+ * @brief Locks the stripe of the user a finished probe looked up and returns the probe's result, which stands as long
+ * as no user was inserted or removed and the table wasn't resized since the probe started. Otherwise the user is
+ * looked up again, as userTableLocate() does without chain. Call inside the read section the probe ran in
+ * @return returns the user, NULL if it isn't registered. Either way slot->stripe is locked
+*/
+struct user *userTableLocateProbed(userTable_t *table, const userProbe_t *probe, userSlot_t *slot);
+
+
+/**
+ * @brief Appends the user to the tail of its chain, resizing the table if it got too loaded. If slot isn't NULL
+ * it is left holding the chain the user ended up in, to read inside a read section entered before the call
+ * @return returns 1 on success, 0 if a user with the same userID is already registered
+*/
+int userTableInsert(userTable_t *table, struct user *user, userSlot_t *slot);
+
+
+/**
+ * @brief Unlinks a user from its chain. The caller retires it once unlinked
+ * @return returns the unlinked user, NULL if it isn't registered
+*/
+struct user *userTableRemove(userTable_t *table, int userID);
+
+
+/**
+ * @brief Indexes the userIDs from 0 to maxID directly, replacing the current index. Drops the index if maxID is
+ * negative or larger than USER_TABLE_DIRECT_MAX
+ * @return returns 1 if the users are indexed directly, 0 otherwise
+*/
+int userTableDirect(userTable_t *table, int maxID);
+
+
+/**
+ * @brief Frees the chains and every user with its history. Only valid once no other thread uses the table
+ * @return returns void
+*/
+void deleteUserTable(userTable_t *table);
+
+
+#endif
@@ -0,0 +1,224 @@
+/*****************************************************
+ * @file   Versions.c                                 *
+ *                                                   *
+ * @brief Implementation for Versions.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+#ifdef CATALOG_VERSIONS
+
+
+/**
+ * @brief Epoch reclaim function for an unpinned version. Frees the nodes only that version still shared
+ * @return returns void
+*/
+static void reclaimVersion(void *object)
+{
+	catalogVersion_t *version = (catalogVersion_t*)object;
+	for(int i=0; i < version->n_dropped; i++)
+	{
+		freeMovieInfo(version->dropped[i]->Info);
+		free(version->dropped[i]);
+	}
+	free(version->dropped);
+	free(version);
+}
+
+
+/**
+ * @brief Makes a new version holding the current roots of the category trees
+ * @return returns the version, NULL on malloc failure
+*/
+static catalogVersion_t *makeVersion(uint64_t seq)
+{
+	catalogVersion_t *version = (catalogVersion_t*)malloc(sizeof(catalogVersion_t));
+	if(version == NULL) return NULL;
+	version->seq = seq;
+	for(int i=0; i<6; i++) version->roots[i] = catalog->categoryArray[i]->movie;
+	version->pins = 0;
+	version->dropped = NULL;
+	version->n_dropped = 0;
+	version->next = NULL;
+	return version;
+}
+
+
+/**
+ * @brief Creates the first version from the current category roots
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int versionsInit(catalogVersions_t *versions, epochDomain_t *epoch)
+{
+	catalogVersion_t *first = makeVersion(0);
+	if(first == NULL) return 0;
+	versions->oldest = first;
+	versions->latest = first;
+	versions->draft = 1;
+	versions->dropped = NULL;
+	versions->n_dropped = 0;
+	versions->size_dropped = 0;
+	versions->epoch = epoch;
+	return 1;
+}
+
+
+/**
+ * @brief Returns a draft owned copy of the node, remembering the published original as dropped. Draft nodes are returned as they are
+ * @return returns the draft node, NULL on malloc failure
+*/
+movie_t *versionWritable(catalogVersions_t *versions, movie_t *movie)
+{
+	if(movie->version == versions->draft) return movie;
+
+	// Make room to remember the original
+	if(versions->n_dropped == versions->size_dropped)
+	{
+		int size = versions->size_dropped == 0 ? 64 : 2 * versions->size_dropped;
+		movie_t **dropped = (movie_t**)realloc(versions->dropped, size * sizeof(movie_t*));
+		if(dropped == NULL) return NULL;
+		versions->dropped = dropped;
+		versions->size_dropped = size;
+	}
+
+	// The copy gets its own Info so that the draft can edit the scores in place
+	movie_t *copy = makeMovie(movie->Info->movieID, movie->Info->year);
+	if(copy == NULL) return NULL;
+	copy->Info->watchedCounter = movie->Info->watchedCounter;
+	copy->Info->sumScore = movie->Info->sumScore;
+	copy->lc = movie->lc;
+	copy->rc = movie->rc;
+	copy->maxScore = movie->maxScore;
+	versions->dropped[versions->n_dropped++] = movie;
+	return copy;
+}
+
+
+/**
+ * @brief Walks down to movieID in the draft of a category, making every node on the way writable
+ * @return returns the draft node holding movieID (when stopAtMatch is set), otherwise the draft node under which movieID would be inserted
+*/
+movie_t *versionDraftPath(catalogVersions_t *versions, int category, int movieID, int stopAtMatch)
+{
+	movie_t *sentinel = catalog->categoryArray[category]->sentinel;
+	movie_t **link = &catalog->categoryArray[category]->movie;
+	movie_t *curr = *link, *prev = NULL;
+
+	// Every node above a draft node is a draft node too, so relinking the copies in place is safe
+	while(curr != sentinel)
+	{
+		curr = versionWritable(versions, curr);
+		if(curr == NULL) return NULL;
+		*link = curr;
+		if(stopAtMatch && curr->Info->movieID == movieID) return curr;
+		prev = curr;
+		if(curr->Info->movieID > movieID) link = &curr->lc;
+		else link = &curr->rc;
+		curr = *link;
+	}
+	return prev;
+}
+
+
+/**
+ * @brief Publishes the draft as a new immutable version and reclaims the unpinned old versions
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int versionPublish(catalogVersions_t *versions)
+{
+	catalogVersion_t *latest = versions->latest;
+
+	// Nothing to publish if the draft has neither copied a node nor changed a root
+	int changed = versions->n_dropped > 0;
+	for(int i=0; i<6 && !changed; i++) changed = latest->roots[i] != catalog->categoryArray[i]->movie;
+	if(!changed) return 1;
+
+	catalogVersion_t *version = makeVersion(versions->draft);
+	if(version == NULL) return 0;
+
+	// The nodes the draft copied are only reachable from the latest version and the older ones
+	latest->dropped = versions->dropped;
+	latest->n_dropped = versions->n_dropped;
+	versions->dropped = NULL;
+	versions->n_dropped = 0;
+	versions->size_dropped = 0;
+
+	latest->next = version;
+	EPOCH_PUBLISH(versions->latest, version);
+	versions->draft++;
+	queryCacheTouchCatalog(&catalog->queryCache);
+
+	// Reclaim old versions oldest first. A version is claimed by swapping its pin count from 0 to -1
+	while(versions->oldest != versions->latest)
+	{
+		catalogVersion_t *oldest = versions->oldest;
+		int unpinned = 0;
+		if(!__atomic_compare_exchange_n(&oldest->pins, &unpinned, -1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) break;
+		versions->oldest = oldest->next;
+		epochRetire(versions->epoch, oldest, reclaimVersion);
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Pins the latest published version so that it can't be reclaimed while it is read
+ * @return returns the pinned version
+*/
+catalogVersion_t *versionPin(catalogVersions_t *versions)
+{
+	// The epoch keeps the version struct alive between loading it and pinning it
+	epochEnter(versions->epoch);
+	for(;;)
+	{
+		catalogVersion_t *version = EPOCH_READ(versions->latest);
+		int pins = __atomic_load_n(&version->pins, __ATOMIC_ACQUIRE);
+		while(pins >= 0 && !__atomic_compare_exchange_n(&version->pins, &pins, pins + 1, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+		if(pins >= 0)
+		{
+			epochExit(versions->epoch);
+			return version;
+		}
+		// Only versions older than the latest are reclaimed, so a newer one has been published meanwhile
+	}
+}
+
+
+/**
+ * @brief Releases a version pinned with versionPin()
+ * @return returns void
+*/
+void versionUnpin(catalogVersions_t *versions, catalogVersion_t *version)
+{
+	(void)versions;
+	__atomic_fetch_sub(&version->pins, 1, __ATOMIC_RELEASE);
+}
+
+
+/**
+ * @brief Frees every version and the nodes the draft dropped, leaving the draft trees to the caller. No version may be pinned
+ * @return returns void
+*/
+void deleteVersions(catalogVersions_t *versions)
+{
+	// Every node is either in the draft trees or dropped exactly once, by a version or by the draft
+	while(versions->oldest != NULL)
+	{
+		catalogVersion_t *oldest = versions->oldest;
+		versions->oldest = oldest->next;
+		reclaimVersion(oldest);
+	}
+	versions->latest = NULL;
+	for(int i=0; i < versions->n_dropped; i++)
+	{
+		freeMovieInfo(versions->dropped[i]->Info);
+		free(versions->dropped[i]);
+	}
+	free(versions->dropped);
+	versions->dropped = NULL;
+	versions->n_dropped = 0;
+	versions->size_dropped = 0;
+}
+
+
+#endif
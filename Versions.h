@@ -0,0 +1,109 @@
+/*****************************************************
+ * @file   Versions.h                                 *
+ *                                                   *
+ * @brief Persistent category tree versions          *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef VERSIONS_FILE
+#define VERSIONS_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "Epoch.h"
+
+
+/*
+ * With CATALOG_VERSIONS defined the category trees become persistent, path copying trees.
+ * Writers (D and W) work on a private draft: every node they modify is first copied, along
+ * with the path leading to it, unless the draft already owns it. versionPublish() turns the
+ * draft into a new immutable version, sharing all unchanged subtrees with the previous one.
+ * Readers pin a version and traverse it for as long as they like without blocking writers.
+ * The nodes a version stopped sharing are freed once every older version is unpinned.
+ */
+
+#define VERSION_WATCH_BATCH 64	/* Maximum number of W events published as one version */
+
+struct movie;
+
+
+/**
+ * Structure defining a published version of the category trees
+*/
+typedef struct catalog_version
+{
+	uint64_t seq;						/* The publish sequence number of the version */
+	struct movie *roots[6];				/* The immutable category roots of the version */
+	int pins;							/* Readers holding the version, -1 once it is being reclaimed */
+	struct movie **dropped;				/* Nodes the next version no longer shares with this one */
+	int n_dropped;						/* The number of dropped nodes */
+	struct catalog_version *next;		/* Pointer to the next newer version */
+}catalogVersion_t;
+
+
+/**
+ * Structure defining the version history and the writer's draft
+*/
+typedef struct catalog_versions
+{
+	catalogVersion_t *oldest;	/* The oldest version that may still be pinned */
+	catalogVersion_t *latest;	/* The newest published version. Readers pin this one */
+	uint64_t draft;				/* The sequence number the draft will be published with */
+	struct movie **dropped;		/* Published nodes the draft has copied so far */
+	int n_dropped;				/* The number of dropped nodes */
+	int size_dropped;			/* The capacity of the dropped array */
+	epochDomain_t *epoch;		/* Protects readers racing with the reclamation of a version */
+}catalogVersions_t;
+
+
+/**
+ * @brief Creates the first version from the current category roots
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int versionsInit(catalogVersions_t *versions, epochDomain_t *epoch);
+
+
+/**
+ * @brief Returns a draft owned copy of the node, remembering the published original as dropped. Draft nodes are returned as they are
+ * @return returns the draft node, NULL on malloc failure
+*/
+struct movie *versionWritable(catalogVersions_t *versions, struct movie *movie);
+
+
+/**
+ * @brief Walks down to movieID in the draft of a category, making every node on the way writable
+ * @return returns the draft node holding movieID (when stopAtMatch is set), otherwise the draft node under which movieID would be inserted
+*/
+struct movie *versionDraftPath(catalogVersions_t *versions, int category, int movieID, int stopAtMatch);
+
+
+/**
+ * @brief Publishes the draft as a new immutable version and reclaims the unpinned old versions
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int versionPublish(catalogVersions_t *versions);
+
+
+/**
+ * @brief Pins the latest published version so that it can't be reclaimed while it is read
+ * @return returns the pinned version
+*/
+catalogVersion_t *versionPin(catalogVersions_t *versions);
+
+
+/**
+ * @brief Releases a version pinned with versionPin()
+ * @return returns void
+*/
+void versionUnpin(catalogVersions_t *versions, catalogVersion_t *version);
+
+
+/**
+ * @brief Frees every version and the nodes the draft dropped, leaving the draft trees to the caller. No version may be pinned
+ * @return returns void
+*/
+void deleteVersions(catalogVersions_t *versions);
+
+
+#endif
@@ -0,0 +1,507 @@
+/*****************************************************
+ * @file   Wal.c                                      *
+ *                                                   *
+ * @brief Implementation for Wal.h 					 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define WAL_FNV_BASIS 2166136261U
+#define WAL_FNV_PRIME 16777619U
+
+
+/**
+ * @brief FNV-1a checksum of a record
+ * @return returns the checksum
+*/
+static uint32_t walChecksum(const unsigned char *data, size_t size)
+{
+	uint32_t checksum = WAL_FNV_BASIS;
+	for(size_t i=0; i < size; i++)
+	{
+		checksum ^= data[i];
+		checksum *= WAL_FNV_PRIME;
+	}
+	return checksum;
+}
+
+
+/**
+ * @brief Number of arguments logged with each type of event
+ * @return returns the number of arguments, -1 if the event isn't logged
+*/
+static int walArguments(char type)
+{
+	switch(type)
+	{
+		case '0':
+		case '1':
+		case 'R':
+		case 'U':
+			return 1;
+		case 'A':
+			return 3;
+		case 'D':
+			return 0;
+		case 'W':
+			return 4;
+	}
+	return -1;
+}
+
+
+/**
+ * @brief Encodes an event as a record
+ * @return returns the size of the record
+*/
+static size_t walEncode(unsigned char *record, char type, const int *args, int n)
+{
+	size_t size = 2;
+	for(int i=0; i < n; i++)
+	{
+		// Zigzag maps small negative numbers to small varints too
+		uint32_t value = ((uint32_t)args[i] << 1) ^ (uint32_t)(args[i] >> 31);
+		while(value >= 0x80)
+		{
+			record[size++] = (unsigned char)(value | 0x80);
+			value >>= 7;
+		}
+		record[size++] = (unsigned char)value;
+	}
+	record[0] = (unsigned char)type;
+	record[1] = (unsigned char)(size - 2);
+	uint32_t checksum = walChecksum(record, size);
+	memcpy(record + size, &checksum, sizeof(checksum));
+	return size + sizeof(checksum);
+}
+
+
+/**
+ * @brief Decodes the record at data, which has size bytes left after it
+ * @return returns the size of the record, 0 if it is torn or corrupt
+*/
+static size_t walDecode(const unsigned char *data, size_t size, char *type, int *args, int *n)
+{
+	if(size < 2) return 0;
+	size_t length = data[1];
+	if(size < 2 + length + sizeof(uint32_t)) return 0;
+	uint32_t checksum;
+	memcpy(&checksum, data + 2 + length, sizeof(checksum));
+	if(walChecksum(data, 2 + length) != checksum) return 0;
+
+	*type = (char)data[0];
+	*n = walArguments(*type);
+	if(*n < 0) return 0;
+	size_t at = 2;
+	for(int i=0; i < *n; i++)
+	{
+		uint32_t value = 0;
+		for(int shift = 0; ; shift += 7)
+		{
+			if(at == 2 + length || shift > 28) return 0;
+			unsigned char byte = data[at++];
+			value |= (uint32_t)(byte & 0x7f) << shift;
+			if(!(byte & 0x80)) break;
+		}
+		args[i] = (int)((value >> 1) ^ -(value & 1));
+	}
+	if(at != 2 + length) return 0;
+	return 2 + length + sizeof(uint32_t);
+}
+
+
+/**
+ * @brief Writes all of data to fd
+ * @return returns 1 on success, 0 on I/O failure
+*/
+static int walWriteAll(int fd, const void *data, size_t size)
+{
+	const char *bytes = (const char*)data;
+	while(size > 0)
+	{
+		ssize_t written = write(fd, bytes, size);
+		if(written < 0)
+		{
+			if(errno == EINTR) continue;
+			return 0;
+		}
+		bytes += written;
+		size -= written;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Hands the pending records off as a group and syncs them. Call with the lock held; it is released
+ * while the group is written, so that appends go on into the other buffer
+ * @return returns 1 on success, 0 on I/O failure
+*/
+static int walFlushLocked(wal_t *wal)
+{
+	// One group at a time. The one being synced may already hold our records
+	while(wal->flushing) pthread_cond_wait(&wal->flushed, &wal->lock);
+	if(wal->used == 0) return 1;
+
+	unsigned char *group = wal->buffer;
+	size_t used = wal->used;
+	uint64_t upto = wal->lsn;
+	wal->buffer = wal->spare;
+	wal->spare = group;
+	wal->used = 0;
+	wal->pending = 0;
+	wal->flushing = 1;
+
+	pthread_mutex_unlock(&wal->lock);
+	int ok = walWriteAll(wal->fd, group, used) && fdatasync(wal->fd) == 0;
+	pthread_mutex_lock(&wal->lock);
+
+	wal->flushing = 0;
+	wal->syncs++;
+	if(ok) wal->synced = upto;
+	pthread_cond_broadcast(&wal->flushed);
+	return ok;
+}
+
+
+/**
+ * @brief Body of the flusher thread. Syncs the pending records once the oldest of them has waited the durability window
+ * @return returns NULL
+*/
+static void *walFlusher(void *arg)
+{
+	wal_t *wal = (wal_t*)arg;
+	pthread_mutex_lock(&wal->lock);
+	while(wal->running)
+	{
+		if(wal->pending == 0)
+		{
+			pthread_cond_wait(&wal->wake, &wal->lock);
+			continue;
+		}
+		struct timespec now, deadline = wal->oldest;
+		deadline.tv_sec += wal->window_ms / 1000;
+		deadline.tv_nsec += (wal->window_ms % 1000) * 1000000L;
+		if(deadline.tv_nsec >= 1000000000L)
+		{
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
+		}
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		if(now.tv_sec > deadline.tv_sec || (now.tv_sec == deadline.tv_sec && now.tv_nsec >= deadline.tv_nsec)) walFlushLocked(wal);
+		else pthread_cond_timedwait(&wal->wake, &wal->lock, &deadline);
+	}
+	pthread_mutex_unlock(&wal->lock);
+	return NULL;
+}
+
+
+/**
+ * @brief Writes a log header with the given base LSN to fd
+ * @return returns 1 on success, 0 on I/O failure
+*/
+static int walWriteHeader(int fd, uint64_t base)
+{
+	walHeader_t header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, WAL_MAGIC, sizeof(header.magic));
+	header.format = WAL_FORMAT;
+	header.base = base;
+	return walWriteAll(fd, &header, sizeof(header)) && fdatasync(fd) == 0;
+}
+
+
+/**
+ * @brief Maps the log read-only and checks its header
+ * @return returns the mapping, NULL if the file isn't a log. size is set to the size of the file
+*/
+static const unsigned char *walMap(int fd, size_t *size)
+{
+	struct stat st;
+	if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(walHeader_t)) return NULL;
+	const unsigned char *data = (const unsigned char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED) return NULL;
+	const walHeader_t *header = (const walHeader_t*)data;
+	if(memcmp(header->magic, WAL_MAGIC, sizeof(header->magic)) != 0 || header->format != WAL_FORMAT)
+	{
+		munmap((void*)data, st.st_size);
+		return NULL;
+	}
+	*size = st.st_size;
+	return data;
+}
+
+
+/**
+ * @brief Opens the log at path, creating it if missing, and drops whatever follows its last whole record,
+ * a write that a crash cut short. Logging starts at the end of the log
+ * @return returns 1 on success, 0 on I/O or malloc failure or if the file isn't a log
+*/
+int walOpen(wal_t *wal, const char *path, long window_ms)
+{
+	wal->fd = open(path, O_RDWR | O_CREAT, 0644);
+	if(wal->fd < 0) return 0;
+
+	struct stat st;
+	if(fstat(wal->fd, &st) != 0 || (st.st_size == 0 && !walWriteHeader(wal->fd, 0)))
+	{
+		close(wal->fd);
+		wal->fd = -1;
+		return 0;
+	}
+
+	// Count the whole records. Anything after the last one is a write the crash cut short
+	size_t size, end = sizeof(walHeader_t);
+	const unsigned char *data = walMap(wal->fd, &size);
+	if(data == NULL)
+	{
+		close(wal->fd);
+		wal->fd = -1;
+		return 0;
+	}
+	uint64_t count = 0;
+	for(;;)
+	{
+		char type;
+		int args[4], n;
+		size_t length = walDecode(data + end, size - end, &type, args, &n);
+		if(length == 0) break;
+		end += length;
+		count++;
+	}
+	uint64_t base = ((const walHeader_t*)data)->base;
+	munmap((void*)data, size);
+	if((end < size && (ftruncate(wal->fd, end) != 0 || fdatasync(wal->fd) != 0)) || lseek(wal->fd, end, SEEK_SET) < 0)
+	{
+		close(wal->fd);
+		wal->fd = -1;
+		return 0;
+	}
+
+	wal->path = strdup(path);
+	wal->buffer = (unsigned char*)malloc(WAL_BUFFER_SIZE);
+	wal->spare = (unsigned char*)malloc(WAL_BUFFER_SIZE);
+	if(wal->path == NULL || wal->buffer == NULL || wal->spare == NULL)
+	{
+		free(wal->path);
+		free(wal->buffer);
+		free(wal->spare);
+		close(wal->fd);
+		wal->fd = -1;
+		return 0;
+	}
+	wal->used = 0;
+	wal->pending = 0;
+	wal->flushing = 0;
+	wal->window_ms = window_ms;
+	wal->base = base;
+	wal->lsn = base + count;
+	wal->synced = wal->lsn;
+	wal->syncs = 0;
+
+	// The window is measured on the monotonic clock
+	pthread_condattr_t attr;
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&wal->wake, &attr);
+	pthread_condattr_destroy(&attr);
+	pthread_cond_init(&wal->flushed, NULL);
+	pthread_mutex_init(&wal->lock, NULL);
+	wal->running = 1;
+	if(pthread_create(&wal->flusher, NULL, walFlusher, wal) != 0)
+	{
+		wal->running = 0;
+		walClose(wal);
+		return 0;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Handles a logged event like main() does, without logging it again
+ * @return returns void
+*/
+static void walApply(char type, const int *args)
+{
+	switch(type)
+	{
+		case '0':
+			catalogSetMaxUsers(catalog, args[0]);
+			break;
+		case '1':
+			catalogSetMaxID(catalog, args[0]);
+			break;
+		case 'R':
+			register_user(catalog, args[0]);
+			break;
+		case 'U':
+			unregister_user(catalog, args[0]);
+			break;
+		case 'A':
+			add_new_movie(catalog, args[0], args[1], args[2]);
+			break;
+		case 'D':
+			distribute_movies(catalog);
+			break;
+		case 'W':
+			watch_movie(catalog, args[0], args[1], args[2], args[3]);
+			break;
+	}
+}
+
+
+/**
+ * @brief Handles every record of the log from LSN from on in the thread's catalog, with the output of the events suppressed
+ * @return returns the number of records handled
+*/
+uint64_t walReplay(wal_t *wal, uint64_t from)
+{
+	size_t size, end = sizeof(walHeader_t);
+	const unsigned char *data = walMap(wal->fd, &size);
+	if(data == NULL) return 0;
+	uint64_t lsn = ((const walHeader_t*)data)->base, replayed = 0;
+
+	// The events print what they did, which was already printed when they were logged
+	fflush(stdout);
+	int out = dup(STDOUT_FILENO), null = open("/dev/null", O_WRONLY);
+	if(out >= 0 && null >= 0) dup2(null, STDOUT_FILENO);
+
+	for(;;)
+	{
+		char type;
+		int args[4], n;
+		size_t length = walDecode(data + end, size - end, &type, args, &n);
+		if(length == 0) break;
+		end += length;
+		if(lsn++ < from) continue;
+		walApply(type, args);
+		replayed++;
+	}
+#ifdef CATALOG_VERSIONS
+	versionPublish(&catalog->versions);
+#endif
+
+	fflush(stdout);
+	if(out >= 0 && null >= 0) dup2(out, STDOUT_FILENO);
+	if(out >= 0) close(out);
+	if(null >= 0) close(null);
+	munmap((void*)data, size);
+	return replayed;
+}
+
+
+/**
+ * @brief Appends an event with n arguments to the log. Syncs the group when it is full
+ * @return returns 1 on success or when logging is off, 0 on I/O failure
+*/
+int walAppend(wal_t *wal, char type, const int *args, int n)
+{
+	if(wal->fd < 0) return 1;
+	unsigned char record[WAL_RECORD_MAX];
+	size_t size = walEncode(record, type, args, n);
+
+	pthread_mutex_lock(&wal->lock);
+	int ok = 1;
+	if(wal->used + size > WAL_BUFFER_SIZE) ok = walFlushLocked(wal);
+
+	// The buffer may still be full if another group was being synced. The wait above let it complete
+	while(ok && wal->used + size > WAL_BUFFER_SIZE) ok = walFlushLocked(wal);
+	if(ok)
+	{
+		if(wal->pending == 0)
+		{
+			clock_gettime(CLOCK_MONOTONIC, &wal->oldest);
+			pthread_cond_signal(&wal->wake);
+		}
+		memcpy(wal->buffer + wal->used, record, size);
+		wal->used += size;
+		wal->pending++;
+		wal->lsn++;
+		if(wal->pending >= WAL_GROUP_EVENTS || wal->window_ms == 0) ok = walFlushLocked(wal);
+	}
+	pthread_mutex_unlock(&wal->lock);
+	return ok;
+}
+
+
+/**
+ * @brief Writes and syncs every record appended so far
+ * @return returns 1 on success, 0 on I/O failure
+*/
+int walFlush(wal_t *wal)
+{
+	if(wal->fd < 0) return 1;
+	pthread_mutex_lock(&wal->lock);
+	int ok = walFlushLocked(wal);
+	pthread_mutex_unlock(&wal->lock);
+	return ok;
+}
+
+
+/**
+ * @brief Starts a new empty log whose first record will get LSN base, once a snapshot holds everything before it
+ * @return returns 1 on success, 0 on I/O failure
+*/
+int walReset(wal_t *wal, uint64_t base)
+{
+	if(wal->fd < 0) return 1;
+	char *tmp = (char*)malloc(strlen(wal->path) + 5);
+	if(tmp == NULL) return 0;
+	sprintf(tmp, "%s.tmp", wal->path);
+
+	// The new log replaces the old one in one rename, so a crash leaves either of them
+	pthread_mutex_lock(&wal->lock);
+	int ok = walFlushLocked(wal);
+	int fd = ok ? open(tmp, O_RDWR | O_CREAT | O_TRUNC, 0644) : -1;
+	if(fd >= 0 && walWriteHeader(fd, base) && rename(tmp, wal->path) == 0)
+	{
+		close(wal->fd);
+		wal->fd = fd;
+		wal->base = base;
+		wal->lsn = base;
+		wal->synced = base;
+	}
+	else
+	{
+		if(fd >= 0) close(fd);
+		remove(tmp);
+		ok = 0;
+	}
+	pthread_mutex_unlock(&wal->lock);
+	free(tmp);
+	return ok;
+}
+
+
+/**
+ * @brief Syncs the pending records, stops the flusher thread and closes the log
+ * @return returns void
+*/
+void walClose(wal_t *wal)
+{
+	if(wal->fd < 0) return;
+	pthread_mutex_lock(&wal->lock);
+	walFlushLocked(wal);
+	int running = wal->running;
+	wal->running = 0;
+	pthread_cond_signal(&wal->wake);
+	pthread_mutex_unlock(&wal->lock);
+	if(running) pthread_join(wal->flusher, NULL);
+
+	close(wal->fd);
+	wal->fd = -1;
+	free(wal->path);
+	free(wal->buffer);
+	free(wal->spare);
+	pthread_mutex_destroy(&wal->lock);
+	pthread_cond_destroy(&wal->wake);
+	pthread_cond_destroy(&wal->flushed);
+}
@@ -0,0 +1,124 @@
+/*****************************************************
+ * @file   Wal.h                                      *
+ *                                                   *
+ * @brief Write-ahead log of the mutating events     *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef WAL_FILE
+#define WAL_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+
+/*
+ * Every R, U, A, D and W event, along with the max_users and max_id lines, is appended to the
+ * log before it is handled, so that a crash only loses the events that were not synced yet. The file is a header followed by records:
+ *
+ *   type     1 byte, the event letter
+ *   length   1 byte, the size of the payload
+ *   payload  the arguments of the event as zigzag varints
+ *   check    4 bytes, FNV-1a of type, length and payload
+ *
+ * Records are numbered by their log sequence number (LSN). The header holds the LSN of the
+ * first record, and a snapshot holds the LSN of the first record it does not contain, so a
+ * restart loads the snapshot and replays only the records from that LSN on.
+ *
+ * Appends go to an in-memory buffer and are synced in groups (group commit): the appender
+ * that fills a group of WAL_GROUP_EVENTS records writes and syncs it, and a flusher thread
+ * syncs whatever is pending once the oldest pending record has waited the durability window.
+ * The next group keeps filling the second buffer while a group is being synced.
+ */
+
+#define WAL_MAGIC "CS240WAL"
+#define WAL_FORMAT 1
+#define WAL_GROUP_EVENTS 1024				/* Records per fdatasync when events arrive fast */
+#define WAL_BUFFER_SIZE (64 * 1024)			/* Size of each of the two buffers */
+#define WAL_RECORD_MAX (2 + 4 * 5 + 4)		/* Largest record: four 5 byte varints */
+#define WAL_DEFAULT_WINDOW_MS 10			/* Default durability window */
+
+
+/**
+ * Structure defining the header at the start of the log
+*/
+typedef struct wal_header
+{
+	char magic[8];		/* WAL_MAGIC */
+	uint32_t format;	/* WAL_FORMAT */
+	uint32_t reserved;
+	uint64_t base;		/* LSN of the first record */
+}walHeader_t;
+
+
+/**
+ * Structure defining an open log
+*/
+typedef struct wal
+{
+	int fd;							/* The log file, -1 while logging is off */
+	char *path;
+	pthread_mutex_t lock;
+	pthread_cond_t flushed;			/* Signaled whenever a group has been synced */
+	pthread_cond_t wake;			/* Wakes the flusher thread */
+	unsigned char *buffer;			/* Records appended since the last group was handed off */
+	unsigned char *spare;			/* The buffer of the group being synced */
+	size_t used;					/* Bytes used in buffer */
+	int pending;					/* Records in buffer */
+	int flushing;					/* Set while a group is being written and synced */
+	long window_ms;					/* Longest time a record waits for its sync */
+	struct timespec oldest;			/* When the oldest record of buffer was appended */
+	uint64_t base;					/* LSN of the first record of the file */
+	uint64_t lsn;					/* LSN of the next record */
+	uint64_t synced;				/* Records known to be on disk */
+	uint64_t syncs;					/* Number of fdatasync calls */
+	pthread_t flusher;
+	int running;					/* Cleared to stop the flusher thread */
+}wal_t;
+
+
+/**
+ * @brief Opens the log at path, creating it if missing, and drops whatever follows its last whole record,
+ * a write that a crash cut short. Logging starts at the end of the log
+ * @return returns 1 on success, 0 on I/O or malloc failure or if the file isn't a log
+*/
+int walOpen(wal_t *wal, const char *path, long window_ms);
+
+
+/**
+ * @brief Handles every record of the log from LSN from on in the thread's catalog, with the output of the events suppressed
+ * @return returns the number of records handled
+*/
+uint64_t walReplay(wal_t *wal, uint64_t from);
+
+
+/**
+ * @brief Appends an event with n arguments to the log. Syncs the group when it is full
+ * @return returns 1 on success or when logging is off, 0 on I/O failure
+*/
+int walAppend(wal_t *wal, char type, const int *args, int n);
+
+
+/**
+ * @brief Writes and syncs every record appended so far
+ * @return returns 1 on success, 0 on I/O failure
+*/
+int walFlush(wal_t *wal);
+
+
+/**
+ * @brief Starts a new empty log whose first record will get LSN base, once a snapshot holds everything before it
+ * @return returns 1 on success, 0 on I/O failure
+*/
+int walReset(wal_t *wal, uint64_t base);
+
+
+/**
+ * @brief Syncs the pending records, stops the flusher thread and closes the log
+ * @return returns void
+*/
+void walClose(wal_t *wal);
+
+
+#endif
@@ -0,0 +1,296 @@
+/*****************************************************
+ * @file   YearIndex.c                                *
+ *                                                   *
+ * @brief Implementation for YearIndex.h 			 *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#include "MovieInternal.h"
+
+
+/**
+ * @brief Compares the key of a node with (year, movieID)
+ * @return returns a negative number, 0 or a positive number as the node's key is smaller, equal or larger
+*/
+static int yearNodeCompare(const yearNode_t *node, int year, int movieID)
+{
+	if(node->year != year) return node->year < year ? -1 : 1;
+	if(node->movieID != movieID) return node->movieID < movieID ? -1 : 1;
+	return 0;
+}
+
+
+/**
+ * @brief Height of a subtree, 0 for an empty one
+ * @return returns the height
+*/
+static int yearHeight(const yearNode_t *node)
+{
+	return node == NULL ? 0 : node->height;
+}
+
+
+/**
+ * @brief Number of keys of a subtree, 0 for an empty one
+ * @return returns the number of keys
+*/
+static int yearSize(const yearNode_t *node)
+{
+	return node == NULL ? 0 : node->size;
+}
+
+
+/**
+ * @brief Recomputes the height and size of a node from its children
+ * @return returns void
+*/
+static void yearNodeUpdate(yearNode_t *node)
+{
+	int hl = yearHeight(node->lc), hr = yearHeight(node->rc);
+	node->height = (hl > hr ? hl : hr) + 1;
+	node->size = yearSize(node->lc) + yearSize(node->rc) + 1;
+}
+
+
+/**
+ * @brief Rotates a subtree right, lifting its left child
+ * @return returns the new root of the subtree
+*/
+static yearNode_t *yearRotateRight(yearNode_t *node)
+{
+	yearNode_t *left = node->lc;
+	node->lc = left->rc;
+	left->rc = node;
+	yearNodeUpdate(node);
+	yearNodeUpdate(left);
+	return left;
+}
+
+
+/**
+ * @brief Rotates a subtree left, lifting its right child
+ * @return returns the new root of the subtree
+*/
+static yearNode_t *yearRotateLeft(yearNode_t *node)
+{
+	yearNode_t *right = node->rc;
+	node->rc = right->lc;
+	right->lc = node;
+	yearNodeUpdate(node);
+	yearNodeUpdate(right);
+	return right;
+}
+
+
+/**
+ * @brief Restores the AVL balance of a node whose subtrees differ in height by at most 2
+ * @return returns the new root of the subtree
+*/
+static yearNode_t *yearRebalance(yearNode_t *node)
+{
+	yearNodeUpdate(node);
+	int balance = yearHeight(node->lc) - yearHeight(node->rc);
+	if(balance > 1)
+	{
+		if(yearHeight(node->lc->lc) < yearHeight(node->lc->rc)) node->lc = yearRotateLeft(node->lc);
+		return yearRotateRight(node);
+	}
+	if(balance < -1)
+	{
+		if(yearHeight(node->rc->rc) < yearHeight(node->rc->lc)) node->rc = yearRotateRight(node->rc);
+		return yearRotateLeft(node);
+	}
+	return node;
+}
+
+
+/**
+ * @brief Recursively inserts the key (year, movieID) in a subtree
+ * @return returns the new root of the subtree, NULL on malloc failure (the subtree is left as it was)
+*/
+static yearNode_t *yearNodeInsert(yearNode_t *node, int year, int movieID, int *failed)
+{
+	if(node == NULL)
+	{
+		yearNode_t *leaf = (yearNode_t*)malloc(sizeof(yearNode_t));
+		if(leaf == NULL)
+		{
+			*failed = 1;
+			return NULL;
+		}
+		leaf->year = year;
+		leaf->movieID = movieID;
+		leaf->height = 1;
+		leaf->size = 1;
+		leaf->lc = NULL;
+		leaf->rc = NULL;
+		return leaf;
+	}
+
+	int cmp = yearNodeCompare(node, year, movieID);
+	if(cmp == 0) return node;
+	if(cmp > 0)
+	{
+		yearNode_t *lc = yearNodeInsert(node->lc, year, movieID, failed);
+		if(*failed) return node;
+		node->lc = lc;
+	}
+	else
+	{
+		yearNode_t *rc = yearNodeInsert(node->rc, year, movieID, failed);
+		if(*failed) return node;
+		node->rc = rc;
+	}
+	return yearRebalance(node);
+}
+
+
+/**
+ * @brief Counts the keys smaller than (year, movieID)
+ * @return returns the number of keys
+*/
+static int yearIndexRank(yearIndex_t *index, int year, int movieID)
+{
+	int rank = 0;
+	yearNode_t *curr = index->root;
+	while(curr != NULL)
+	{
+		if(yearNodeCompare(curr, year, movieID) < 0)
+		{
+			// The node and its whole left subtree come before the key
+			rank += yearSize(curr->lc) + 1;
+			curr = curr->rc;
+		}
+		else curr = curr->lc;
+	}
+	return rank;
+}
+
+
+/**
+ * @brief Initializes an empty index
+ * @return returns 1 on success, 0 if the lock can't be initialized
+*/
+int yearIndexInit(yearIndex_t *index)
+{
+	index->root = NULL;
+	return pthread_rwlock_init(&index->lock, NULL) == 0;
+}
+
+
+/**
+ * @brief Adds the key (year, movieID). Adding a key already indexed does nothing
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int yearIndexInsert(yearIndex_t *index, int year, int movieID)
+{
+	int failed = 0;
+	pthread_rwlock_wrlock(&index->lock);
+	yearNode_t *root = yearNodeInsert(index->root, year, movieID, &failed);
+	if(!failed) index->root = root;
+	pthread_rwlock_unlock(&index->lock);
+	return !failed;
+}
+
+
+/**
+ * @brief Takes the lock of the index shared, for the calls below that read it
+ * @return returns void
+*/
+void yearIndexLock(yearIndex_t *index)
+{
+	pthread_rwlock_rdlock(&index->lock);
+}
+
+
+/**
+ * @brief Releases the lock taken by yearIndexLock()
+ * @return returns void
+*/
+void yearIndexUnlock(yearIndex_t *index)
+{
+	pthread_rwlock_unlock(&index->lock);
+}
+
+
+/**
+ * @brief Counts the keys of the index. Only call with the lock held
+ * @return returns the number of keys
+*/
+int yearIndexSize(yearIndex_t *index)
+{
+	return yearSize(index->root);
+}
+
+
+/**
+ * @brief Counts the movies released from fromYear to toYear, both included. Only call with the lock held
+ * @return returns the number of movies
+*/
+int yearIndexCount(yearIndex_t *index, int fromYear, int toYear)
+{
+	if(fromYear > toYear) return 0;
+	int below = yearIndexRank(index, fromYear, INT_MIN);
+	int upTo = toYear == INT_MAX ? yearIndexSize(index) : yearIndexRank(index, toYear + 1, INT_MIN);
+	return upTo - below;
+}
+
+
+/**
+ * @brief Positions the iterator on the first key of year fromYear or later. Only call with the lock held
+ * @return returns void
+*/
+void yearIndexSeek(yearIndex_t *index, yearIter_t *iter, int fromYear)
+{
+	// Every node at or after the first key of fromYear on the way down is still to be returned
+	iter->depth = 0;
+	yearNode_t *curr = index->root;
+	while(curr != NULL)
+	{
+		if(curr->year >= fromYear)
+		{
+			iter->stack[iter->depth++] = curr;
+			curr = curr->lc;
+		}
+		else curr = curr->rc;
+	}
+}
+
+
+/**
+ * @brief Returns the key under the iterator and moves it to the next one in ascending (year, movieID)
+ * @return returns the node holding the key, NULL past the last key
+*/
+yearNode_t *yearIndexNext(yearIter_t *iter)
+{
+	if(iter->depth == 0) return NULL;
+	yearNode_t *node = iter->stack[--iter->depth];
+
+	// The successor is the leftmost node of the right subtree, or the deepest node left on the stack
+	for(yearNode_t *curr = node->rc; curr != NULL; curr = curr->lc) iter->stack[iter->depth++] = curr;
+	return node;
+}
+
+
+/**
+ * @brief Frees the nodes of a subtree using PostOrder Traversal
+ * @return returns void
+*/
+static void PostOrderYearDelete(yearNode_t *node)
+{
+	treeWalk_t walk;
+	treeWalkBegin(&walk, TREE_WALK_POST, node, offsetof(yearNode_t, lc), offsetof(yearNode_t, rc), NULL);
+	for(yearNode_t *curr; (curr = treeWalkNext(&walk)) != NULL; ) free(curr);
+	treeWalkEnd(&walk);
+}
+
+
+/**
+ * @brief Frees every node of the index and destroys its lock. Only valid once no other thread uses it
+ * @return returns void
+*/
+void deleteYearIndex(yearIndex_t *index)
+{
+	PostOrderYearDelete(index->root);
+	index->root = NULL;
+	pthread_rwlock_destroy(&index->lock);
+}
@@ -0,0 +1,130 @@
+/*****************************************************
+ * @file   YearIndex.h                                *
+ *                                                   *
+ * @brief Release year index of a category           *
+ * Project: Winter 2023						         *
+ *****************************************************/
+#ifndef YEARINDEX_FILE
+#define YEARINDEX_FILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+
+
+/*
+ * Every category keeps a secondary index of its movies keyed by (year, movieID), filled by
+ * DistributeMovie() alongside the category tree. It is an AVL tree whose nodes also count
+ * the keys of their subtree, so the number of movies released in a range of years is two
+ * rank lookups, and the movies of the range are found by seeking to its first key and
+ * walking in order.
+ *
+ * The index only holds keys. The scores are read from the category itself, so that a reader
+ * sees the scores of the version it reads whichever backend holds them. A movie is indexed
+ * before it is linked in its category, so the index covers every movie a reader can find.
+ * Readers share the lock of the index, D takes it exclusively for each insert.
+ */
+
+#define YEARINDEX_MAX_HEIGHT 48		/* An AVL tree of height 48 holds more than 2^32 keys */
+
+
+/**
+ * Structure defining a node of the index
+*/
+typedef struct year_node
+{
+	int year;					/* The year the movie released, first part of the key */
+	int movieID;				/* The movie identifier, second part of the key */
+	int height;					/* Height of the subtree, 1 for a leaf */
+	int size;					/* Number of keys in the subtree */
+	struct year_node *lc;		/* Pointer to the node's left child */
+	struct year_node *rc;		/* Pointer to the node's right child */
+}yearNode_t;
+
+
+/**
+ * Structure defining the index of a category
+*/
+typedef struct year_index
+{
+	yearNode_t *root;			/* NULL while the category is empty */
+	pthread_rwlock_t lock;		/* Shared by readers, exclusive for inserts */
+}yearIndex_t;
+
+
+/**
+ * Structure defining an in-order walk over a range of the index
+*/
+typedef struct year_iter
+{
+	yearNode_t *stack[YEARINDEX_MAX_HEIGHT];	/* The nodes whose left subtree has been walked but not themselves, deepest on top */
+	int depth;
+}yearIter_t;
+
+
+/**
+ * @brief Initializes an empty index
+ * @return returns 1 on success, 0 if the lock can't be initialized
+*/
+int yearIndexInit(yearIndex_t *index);
+
+
+/**
+ * @brief Adds the key (year, movieID). Adding a key already indexed does nothing
+ * @return returns 1 on success, 0 on malloc failure
+*/
+int yearIndexInsert(yearIndex_t *index, int year, int movieID);
+
+
+/**
+ * @brief Takes the lock of the index shared, for the calls below that read it
+ * @return returns void
+*/
+void yearIndexLock(yearIndex_t *index);
+
+
+/**
+ * @brief Releases the lock taken by yearIndexLock()
+ * @return returns void
+*/
+void yearIndexUnlock(yearIndex_t *index);
+
+
+/**
+ * @brief Counts the keys of the index. Only call with the lock held
+ * @return returns the number of keys
+*/
+int yearIndexSize(yearIndex_t *index);
+
+
+/**
+ * @brief Counts the movies released from fromYear to toYear, both included. Only call with the lock held
+ * @return returns the number of movies
+*/
+int yearIndexCount(yearIndex_t *index, int fromYear, int toYear);
+
+
+/**
+ * @brief Positions the iterator on the first key of year fromYear or later. Only call with the lock held
+ * @return returns void
+*/
+void yearIndexSeek(yearIndex_t *index, yearIter_t *iter, int fromYear);
+
+
+/**
+ * @brief Returns the key under the iterator and moves it to the next one in ascending (year, movieID)
+ * @return returns the node holding the key, NULL past the last key
+*/
+yearNode_t *yearIndexNext(yearIter_t *iter);
+
+
+/**
+ * @brief Frees every node of the index and destroys its lock. Only valid once no other thread uses it
+ * @return returns void
+*/
+void deleteYearIndex(yearIndex_t *index);
+
+
+#endif
@@ -0,0 +1,304 @@
+/*****************************************************
+ * @file   loadgen.c                                  *
+ *                                                   *
+ * @brief Load generator for the server mode (-u)    *
+ * Project: Winter 2023						         *
+ *****************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define LOADGEN_LINE_SIZE 1024		/* Longest event line, like BUFFER_SIZE of main.c */
+#define LOADGEN_READ_SIZE (64 * 1024)	/* Bytes of replies taken by one read */
+
+/*
+ * Replays the event lines of an input file against a server started with -u <socket>.
+ * Every connection runs in a thread of its own and keeps up to depth lines in flight: it
+ * sends lines until depth of them wait for a reply, then reads replies, each ending with a
+ * '\0', and sends as many new lines as replies came back. The latency of a line is the time
+ * from its send to the end of its reply. Connections start at different lines of the file
+ * and wrap around it. Comments and empty lines are not sent.
+ */
+
+
+/**
+ * Structure defining the lines of the input file
+*/
+typedef struct loadgen_lines
+{
+	char **lines;
+	size_t *lengths;
+	int n;
+}loadgenLines_t;
+
+
+/**
+ * Structure defining a connection and what it measured
+*/
+typedef struct loadgen_conn
+{
+	pthread_t thread;
+	const char *path;
+	const loadgenLines_t *lines;
+	int first;					/* The line the connection starts at */
+	long requests;				/* Lines to send */
+	int depth;					/* Lines in flight at most */
+	double *latencies;			/* Microseconds per line, in reply order */
+	long replied;				/* Replies received */
+	int failed;
+}loadgenConn_t;
+
+
+/**
+ * @brief Microseconds on the monotonic clock
+ * @return returns the microseconds
+*/
+static double loadgenNow(void)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+
+/**
+ * @brief Reads the event lines of a file, skipping comments and empty lines
+ * @return returns 1 on success, 0 if the file can't be read or has no event line
+*/
+static int loadgenRead(loadgenLines_t *lines, const char *path)
+{
+	FILE *fin = fopen(path, "r");
+	char buff[LOADGEN_LINE_SIZE];
+	int size = 0;
+
+	lines->lines = NULL;
+	lines->lengths = NULL;
+	lines->n = 0;
+	if ( fin == NULL )
+		return 0;
+	while ( fgets(buff, LOADGEN_LINE_SIZE, fin) ) {
+		size_t length = strlen(buff);
+		if ( buff[0] == '#' || buff[0] == '\n' || buff[length - 1] != '\n' )
+			continue;
+		if ( lines->n == size ) {
+			size = size == 0 ? 1024 : 2 * size;
+			lines->lines = (char**)realloc(lines->lines, size * sizeof(char*));
+			lines->lengths = (size_t*)realloc(lines->lengths, size * sizeof(size_t));
+			if ( lines->lines == NULL || lines->lengths == NULL ) {
+				fclose(fin);
+				return 0;
+			}
+		}
+		lines->lines[lines->n] = strdup(buff);
+		lines->lengths[lines->n++] = length;
+	}
+	fclose(fin);
+	return lines->n > 0;
+}
+
+
+/**
+ * @brief Connects to the Unix domain socket at path
+ * @return returns the socket, -1 on failure
+*/
+static int loadgenConnect(const char *path)
+{
+	struct sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if ( strlen(path) >= sizeof(address.sun_path) )
+		return -1;
+	strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if ( fd < 0 )
+		return -1;
+	if ( connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+/**
+ * @brief Sends length bytes, however many writes it takes
+ * @return returns 1 on success, 0 if the server is gone
+*/
+static int loadgenSend(int fd, const char *buffer, size_t length)
+{
+	while ( length > 0 ) {
+		ssize_t sent = send(fd, buffer, length, MSG_NOSIGNAL);
+		if ( sent < 0 ) {
+			if ( errno == EINTR )
+				continue;
+			return 0;
+		}
+		buffer += sent;
+		length -= sent;
+	}
+	return 1;
+}
+
+
+/**
+ * @brief Thread of a connection: keeps depth lines in flight until requests of them are answered
+ * @return returns NULL
+*/
+static void *loadgenRun(void *arg)
+{
+	loadgenConn_t *conn = (loadgenConn_t*)arg;
+	const loadgenLines_t *lines = conn->lines;
+	double *sentAt = (double*)malloc(conn->depth * sizeof(double));
+	char *out = (char*)malloc((size_t)conn->depth * LOADGEN_LINE_SIZE);
+	char *in = (char*)malloc(LOADGEN_READ_SIZE);
+	int fd = loadgenConnect(conn->path);
+	long sent = 0;
+	int next = conn->first;
+
+	conn->failed = fd < 0 || sentAt == NULL || out == NULL || in == NULL;
+	while ( !conn->failed && conn->replied < conn->requests ) {
+
+		/* Top the pipeline up with one write */
+		size_t length = 0;
+		double now = loadgenNow();
+		while ( sent < conn->requests && sent - conn->replied < conn->depth ) {
+			memcpy(out + length, lines->lines[next], lines->lengths[next]);
+			length += lines->lengths[next];
+			sentAt[sent++ % conn->depth] = now;
+			next = (next + 1) % lines->n;
+		}
+		if ( length > 0 && !loadgenSend(fd, out, length) ) {
+			conn->failed = 1;
+			break;
+		}
+
+		/* Every '\0' ends the reply of the oldest line in flight */
+		ssize_t n = read(fd, in, LOADGEN_READ_SIZE);
+		if ( n <= 0 ) {
+			if ( n < 0 && errno == EINTR )
+				continue;
+			conn->failed = 1;
+			break;
+		}
+		now = loadgenNow();
+		for ( char *p = in; (p = (char*)memchr(p, '\0', in + n - p)) != NULL; p++ ) {
+			conn->latencies[conn->replied] = now - sentAt[conn->replied % conn->depth];
+			conn->replied++;
+		}
+	}
+	if ( fd >= 0 )
+		close(fd);
+	free(sentAt);
+	free(out);
+	free(in);
+	return NULL;
+}
+
+
+/**
+ * @brief qsort comparator of latencies
+ * @return returns negative, 0 or positive as a is smaller, equal or larger
+*/
+static int loadgenCompare(const void *a, const void *b)
+{
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+
+/**
+ * @brief The latency below which a fraction of the sorted latencies fall
+ * @return returns the latency
+*/
+static double loadgenPercentile(const double *sorted, long n, double fraction)
+{
+	long i = (long)(fraction * n);
+	return sorted[i < n ? i : n - 1];
+}
+
+
+int main(int argc, char** argv)
+{
+	int connections = 4, depth = 16, arg = 1;
+	long requests = 100000;
+	loadgenLines_t lines;
+
+	/* -c connections, -d lines in flight per connection, -n lines to send per connection */
+	while ( arg + 1 < argc && argv[arg][0] == '-' ) {
+		if ( strcmp(argv[arg], "-c") == 0 )
+			connections = atoi(argv[arg + 1]);
+		else if ( strcmp(argv[arg], "-d") == 0 )
+			depth = atoi(argv[arg + 1]);
+		else if ( strcmp(argv[arg], "-n") == 0 )
+			requests = atol(argv[arg + 1]);
+		else
+			break;
+		arg += 2;
+	}
+	if ( arg != argc - 2 || connections <= 0 || depth <= 0 || requests <= 0 ) {
+		fprintf(stderr, "Usage: %s [-c <connections>] [-d <depth>] [-n <requests>] <socket> <input_file> \n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if ( !loadgenRead(&lines, argv[arg + 1]) ) {
+		fprintf(stderr, "\n Could not read events: %s\n", argv[arg + 1]);
+		return EXIT_FAILURE;
+	}
+
+	loadgenConn_t *conns = (loadgenConn_t*)calloc(connections, sizeof(loadgenConn_t));
+	double *latencies = (double*)malloc((size_t)connections * requests * sizeof(double));
+	if ( conns == NULL || latencies == NULL ) {
+		fprintf(stderr, "\n Could not allocate the latencies\n");
+		return EXIT_FAILURE;
+	}
+
+	double start = loadgenNow();
+	for ( int i = 0; i < connections; i++ ) {
+		conns[i].path = argv[arg];
+		conns[i].lines = &lines;
+		conns[i].first = (int)((long)i * lines.n / connections);
+		conns[i].requests = requests;
+		conns[i].depth = depth;
+		conns[i].latencies = latencies + (size_t)i * requests;
+		pthread_create(&conns[i].thread, NULL, loadgenRun, &conns[i]);
+	}
+
+	/* The replies of every connection are packed together before sorting */
+	long total = 0;
+	int failed = 0;
+	for ( int i = 0; i < connections; i++ ) {
+		pthread_join(conns[i].thread, NULL);
+		memmove(latencies + total, conns[i].latencies, conns[i].replied * sizeof(double));
+		total += conns[i].replied;
+		failed += conns[i].failed;
+	}
+	double elapsed = (loadgenNow() - start) / 1e6;
+
+	if ( total == 0 ) {
+		fprintf(stderr, "\n No replies from %s\n", argv[arg]);
+		return EXIT_FAILURE;
+	}
+	qsort(latencies, total, sizeof(double), loadgenCompare);
+	printf("%ld requests over %d connections, %d in flight each, in %.3fs\n", total, connections, depth, elapsed);
+	printf("   %.0f requests/s\n", total / elapsed);
+	printf("   latency us: p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+		loadgenPercentile(latencies, total, 0.50), loadgenPercentile(latencies, total, 0.90),
+		loadgenPercentile(latencies, total, 0.99), loadgenPercentile(latencies, total, 0.999), latencies[total - 1]);
+	if ( failed > 0 )
+		fprintf(stderr, "%d connections failed\n", failed);
+
+	for ( int i = 0; i < lines.n; i++ )
+		free(lines.lines[i]);
+	free(lines.lines);
+	free(lines.lengths);
+	free(latencies);
+	free(conns);
+	return failed > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -25,237 +25,555 @@
 #define DPRINT(...)
 #endif /* DEBUG */
 
-int hashtable_size; 	/** The size of the users hashtable (>0) */
-int max_users;         /** The maximum number of registrations (users) */
-int max_id;            /** The maximum user ID */
-
-// This is a very conservative progress on the hashtable. Our purpose
-// is to force many rehashes to check the stability of the code.
-int primes_g[160] = 		{  5,   7,  11,  13,  17,  19,  23,  29,  31,  37,
-                               41,  43,  47,  53,  59,  61,  67,  71,  73,  79,
-                               83,  89,  97, 101, 103, 107, 109, 113, 127, 131,
-                              137, 139, 149, 151, 157, 163, 167, 173, 179, 181,
-                              191, 193, 197, 199, 211, 223, 227, 229, 233, 239,
-                              241, 251, 257, 263, 269, 271, 277, 281, 283, 293,
-                              307, 311, 313, 317, 331, 337, 347, 349, 353, 359,
-                              367, 373, 379, 383, 389, 397, 401, 409, 419, 421,
-                              431, 433, 439, 443, 449, 457, 461, 463, 467, 479,
-                              487, 491, 499, 503, 509, 521, 523, 541, 547, 557,
-                              563, 569, 571, 577, 587, 593, 599, 601, 607, 613,
-                              617, 619, 631, 641, 643, 647, 653, 659, 661, 673,
-                              677, 683, 691, 701, 709, 719, 727, 733, 739, 743,
-                              751, 757, 761, 769, 773, 787, 797, 809, 811, 821,
-                              823, 827, 829, 839, 853, 857, 859, 863, 877, 881,
-                              883, 887, 907, 911, 919, 929, 937, 941, 947, 953};
-
-user_t **user_hashtable_p;	/* The users hashtable. This is an array of chains (pinakas katakermatismoy xrhstwn)*/
-movie_t *new_releases;     /* New releases simply-linked binary tree*/
-movieCategoryArray_t *categoryArray[6];  /* The categories array (pinakas kathgoriwn)*/
-
-int a = 3;
-int b = 7;
-int m = 101;
-int p = 31;
-
-newMoviesTree_t newMoviesTree; 
+static catalog_t *movieCatalog = NULL;	/* The catalog the events go to, made by catalogCreate() */
 
-int main(int argc, char** argv)
+static wal_t catalogWal = { .fd = -1 };	/* The write-ahead log of the mutating events, if any */
+
+static checkpoint_t catalogCheckpoint;	/* The background checkpoint taken after D events, if any */
+
+/**
+ * @brief Returns the LSN a snapshot of the current state starts the log at
+ * @return returns the LSN of the next event to log
+*/
+static uint64_t currentLsn(void)
 {
-	FILE *fin = NULL;
+	if ( catalogWal.fd >= 0 )
+		return catalogWal.lsn;
+	return catalogSnapshotLsn(movieCatalog);
+}
+
+/**
+ * @brief Logs a mutating event before it is handled
+ * @return returns void
+*/
+static void logEvent(char event, const int *args, int n)
+{
+	if ( !walAppend(&catalogWal, event, args, n) )
+		fprintf(stderr, "\n Could not log event %c\n", event);
+}
+
+#ifdef CATALOG_VERSIONS
+static int watchBatch = 0;	/* W events applied to the draft since the last published version */
+#endif
+
+static char watchLines[WATCH_BATCH][BUFFER_SIZE];	/* The run of W events read but not handled yet */
+
+/**
+ * @brief Handles a run of W events, logged and reported one by one as if each was handled on its own
+ * @return returns void
+*/
+static void handleWatches(char lines[][BUFFER_SIZE], int n)
+{
+	watchEvent_t events[WATCH_BATCH];
+	char event = 'W';
+
+	for ( int i = 0; i < n; i++ ) {
+		sscanf(lines[i], "%c %d %d %d %d", &event, &events[i].userID, &events[i].category, &events[i].movieID, &events[i].score);
+		logEvent(event, (int[]){events[i].userID, events[i].category, events[i].movieID, events[i].score}, 4);
+	}
+
+	watch_movies(movieCatalog, events, n);
+
+	for ( int i = 0; i < n; i++ ) {
+		int userID = events[i].userID, category = events[i].category, movieID = events[i].movieID, score = events[i].score;
+		DPRINT("Event: %s \n", lines[i]);
+		checkpointPoll(&catalogCheckpoint, 0);
+		DPRINT("%c %d %d %d %d\n", event, userID, category, movieID, score);
+		if ( events[i].result ) {
+			DPRINT("%c %d %d %d %d succeeded\n", event, userID, category, movieID, score);
+		} else {
+			fprintf(stderr, "%c %d %d %d failed\n", event, userID, movieID, score);
+		}
+#ifdef CATALOG_VERSIONS
+		/* WATCH_BATCH divides VERSION_WATCH_BATCH, so a version still ends with a whole run */
+		if ( ++watchBatch == VERSION_WATCH_BATCH ) {
+			catalogPublish(movieCatalog);
+			watchBatch = 0;
+		}
+#endif
+	}
+}
+
+/**
+ * @brief Applies the W events of a ratings file in bulk (see watch_bulk), logged and reported one by one
+ * @return returns 1 on success, 0 if the file can't be read or the ratings don't fit in memory
+*/
+static int handleRatings(const char *path)
+{
+	FILE *fratings = fopen(path, "r");
 	char buff[BUFFER_SIZE], event;
+	watchEvent_t *events = NULL;
+	int n = 0, size = 0, applied = 0;
+
+	if ( fratings == NULL )
+		return 0;
+	while ( fgets(buff, BUFFER_SIZE, fratings) ) {
+		if ( buff[0] != 'W' )
+			continue;
+		if ( n == size ) {
+			size = size == 0 ? 1024 : 2 * size;
+			watchEvent_t *grown = (watchEvent_t*)realloc(events, size * sizeof(watchEvent_t));
+			if ( grown == NULL ) {
+				free(events);
+				fclose(fratings);
+				return 0;
+			}
+			events = grown;
+		}
+		watchEvent_t *rating = &events[n++];
+		sscanf(buff, "%c %d %d %d %d", &event, &rating->userID, &rating->category, &rating->movieID, &rating->score);
+		logEvent(event, (int[]){rating->userID, rating->category, rating->movieID, rating->score}, 4);
+	}
+	fclose(fratings);
 
-	/* Check command buff arguments */
-	if ( argc != 2 ) {
-		fprintf(stderr, "Usage: %s <input_file> \n", argv[0]);
-		return EXIT_FAILURE;
+	if ( !watch_bulk(movieCatalog, events, n) ) {
+		free(events);
+		return 0;
 	}
+	for ( int i = 0; i < n; i++ ) {
+		if ( events[i].result == 1 )
+			applied++;
+		else
+			fprintf(stderr, "W %d %d %d failed\n", events[i].userID, events[i].movieID, events[i].score);
+	}
+	DPRINT("Applied %d of %d ratings from %s\n", applied, n, path);
+#ifdef CATALOG_VERSIONS
+	catalogPublish(movieCatalog);
+#endif
+	free(events);
+	return 1;
+}
 
-	/* Open input file */
-	if (( fin = fopen(argv[1], "r") ) == NULL ) {
-		fprintf(stderr, "\n Could not open file: %s\n", argv[1]);
-		perror("Opening test file\n");
-		return EXIT_FAILURE;
+/**
+ * @brief Handles an event line other than W, printing its output to stdout
+ * @return returns void
+*/
+static void handleEvent(char *buff, const char *checkpointPath)
+{
+	char event;
+
+	DPRINT("Event: %s \n", buff);
+
+	/* Report a background checkpoint as soon as it is done */
+	checkpointPoll(&catalogCheckpoint, 0);
+
+#ifdef CATALOG_VERSIONS
+	/* A run of W events is published as one version as soon as any other event follows it */
+	if ( buff[0] != 'W' && watchBatch > 0 ) {
+		catalogPublish(movieCatalog);
+		watchBatch = 0;
 	}
+#endif
+
+	switch(buff[0]) {
+
+	/* Comment */
+	case '#':
+		break;
+	/* max_users */
+	case '0': {
+		int maxUsers;
+
+		sscanf(buff, "%c %u", &event, &maxUsers);
+		DPRINT("max users: %u\n", maxUsers);
+		logEvent(event, &maxUsers, 1);
+		if ( !catalogSetMaxUsers(movieCatalog, maxUsers) )
+			fprintf(stderr, "\n Could not preallocate %d users\n", maxUsers);
+		break;
+	}
+	/* max_id */
+	case '1': {
+		int maxID;
+
+		sscanf(buff, "%c %u", &event, &maxID);
+		DPRINT("max id: %u\n", maxID);
+		logEvent(event, &maxID, 1);
+		catalogSetMaxID(movieCatalog, maxID);
+		break;
+	}		
+	/* Event R : R <userID> - Register user. */
+	case 'R':
+	{
+		int userID;
+		sscanf(buff, "%c %d", &event, &userID);
+		DPRINT("%c %d\n", event, userID);
+		logEvent(event, &userID, 1);
+		if ( register_user(movieCatalog, userID) ) {
+			DPRINT("%c succeeded\n", event);
+		} else {
+			fprintf(stderr, "%c failed\n", event);
+		}
 
-	/* Read input file buff-by-buff and handle the events */
-	while ( fgets(buff, BUFFER_SIZE, fin) ) {
+		break;
+	}
+	/* Event U : U <userID> - Unregister user. */
+	case 'U':
+	{
+		int userID;
+		sscanf(buff, "%c %d", &event, &userID);
+		DPRINT("%c %d\n", event, userID);
+		logEvent(event, &userID, 1);
+
+		if ( unregister_user(movieCatalog, userID) ) {
+			DPRINT("%c %d succeeded\n", event, userID);
+		} else {
+			fprintf(stderr, "%c %d failed\n", event, userID);
+		}
 
-		DPRINT("Event: %s \n", buff);
+		break;
+	}
+	/* Event A : A <movieID> <category> <year> - Add new movie. */
+	case 'A':
+	{
+		int movieID,category, year;
+		sscanf(buff, "%c %d %d %d", &event, &movieID, &category, &year);
+		DPRINT("%c %d %d %d\n", event, movieID, category, year);
+		logEvent(event, (int[]){movieID, category, year}, 3);
+
+		if ( add_new_movie(movieCatalog, movieID, category, year) ) {
+			DPRINT("%c %d %d %d succeeded\n", event, movieID, category, year);
+		} else {
+			fprintf(stderr, "%c %d %d %d failed\n", event, movieID, category, year);
+		}
 
-		switch(buff[0]) {
+		break;
+	}
+	/* Event D : D  - Distribute movies. */
+	case 'D':
+	{
+		sscanf(buff, "%c", &event);
+		DPRINT("%c\n", event);
+		logEvent(event, NULL, 0);
+
+		if ( distribute_movies(movieCatalog) ) {
+			DPRINT("%c succeeded\n", event);
+		} else {
+			fprintf(stderr, "%c failed\n", event);
+		}
 
-		/* Comment */
-		case '#':
-			break;
-		/* max_users */
-		case '0': {
-			sscanf(buff, "%c %u", &event, &max_users);
-			DPRINT("max users: %u\n", max_users);
-			break;
+		/* Right after a D the catalog is consistent, so the child gets a consistent image */
+		if ( checkpointPath != NULL && !checkpointBegin(&catalogCheckpoint, checkpointPath, currentLsn()) )
+			DPRINT("Checkpoint skipped\n");
+
+		break;
+	}
+	/* Event –	F  <userID> <score> [categories] [fromYear toYear] Filter movies */
+	/* Event –	X  <userID> <score> [categories] [fromYear toYear] Filter movies the user has not watched */
+	case 'F':
+	case 'X':
+	{
+		int userID, score, args[3];
+		int categories = ALL_CATEGORIES, fromYear = INT_MIN, toYear = INT_MAX;
+		int n_args = sscanf(buff, "%c %d %d %d %d %d\n", &event, &userID,&score, &args[0], &args[1], &args[2]);
+		DPRINT("%c %d %d\n", event, userID,score);
+
+		// An odd number of extra arguments starts with the category bitmask, the last two are the years
+		if (n_args == 4 || n_args == 6) categories = args[0];
+		if (n_args >= 5) {
+			fromYear = args[n_args - 5];
+			toYear = args[n_args - 4];
 		}
-		/* max_id */
-		case '1': {
-			sscanf(buff, "%c %u", &event, &max_id);
-			DPRINT("max id: %u\n", max_id);
-			break;
-		}		
-		/* Event R : R <userID> - Register user. */
-		case 'R':
-		{
-			int userID;
-			sscanf(buff, "%c %d", &event, &userID);
-			DPRINT("%c %d\n", event, userID);
-			if ( register_user(userID) ) {
-				DPRINT("%c succeeded\n", event);
-			} else {
-				fprintf(stderr, "%c failed\n", event);
-			}
 
-			break;
+		if (n_args > 3 || event == 'X' ? filter_movies_in(movieCatalog, userID, score, categories, fromYear, toYear, event == 'X') : filter_movies(movieCatalog, userID,score) ) {
+			DPRINT("%c %d %d succeeded\n", event, userID,score);
+		} else {
+			fprintf(stderr, "%c %d %d failed\n", event, userID,score);
 		}
-		/* Event U : U <userID> - Unregister user. */
-		case 'U':
-		{
-			int userID;
-			sscanf(buff, "%c %d", &event, &userID);
-			DPRINT("%c %d\n", event, userID);
-
-			if ( unregister_user(userID) ) {
-				DPRINT("%c %d succeeded\n", event, userID);
-			} else {
-				fprintf(stderr, "%c %d failed\n", event, userID);
-			}
 
-			break;
+		break;
+	}
+	/* Event Q : Q <userID> - User statistics */
+	case 'Q':
+	{
+		int userID;
+		sscanf(buff, "%c %d\n", &event, &userID);
+		DPRINT("%c %d\n", event, userID);
+
+		if ( user_stats(movieCatalog, userID) ) {
+			DPRINT("%c %d succeeded\n", event, userID);
+		} else {
+			fprintf(stderr, "%c %d failed\n", event, userID);
 		}
-		/* Event A : A <movieID> <category> <year> - Add new movie. */
-		case 'A':
-		{
-			int movieID,category, year;
-			sscanf(buff, "%c %d %d %d", &event, &movieID, &category, &year);
-			DPRINT("%c %d %d %d\n", event, movieID, category, year);
-
-			if ( add_new_movie(movieID, category, year) ) {
-				DPRINT("%c %d %d %d succeeded\n", event, movieID, category, year);
-			} else {
-				fprintf(stderr, "%c %d %d %d failed\n", event, movieID, category, year);
-			}
 
-			break;
+		break;
+	}
+	/* Event I : I <movieID> <category> - Search movie */
+	case 'I':
+	{
+		int movieID,category;
+		sscanf(buff, "%c %d %d\n", &event, &movieID, &category);
+		DPRINT("%c %d %d\n", event, movieID, category);
+
+		if ( search_movie(movieCatalog, movieID, category) ) {
+			DPRINT("%c %d %d succeeded\n", event, movieID, category);
+		} else {
+			fprintf(stderr, "%c %d %d failed\n", event, movieID, category);
 		}
-		/* Event D : D  - Distribute movies. */
-		case 'D':
-		{
-			sscanf(buff, "%c", &event);
-			DPRINT("%c\n", event);
-
-			if ( distribute_movies() ) {
-				DPRINT("%c succeeded\n", event);
-			} else {
-				fprintf(stderr, "%c failed\n", event);
-			}
 
-			break;
+		break;
+	}
+	/* Event S : S - Result cache statistics */
+	case 'S':
+	{
+		sscanf(buff, "%c", &event);
+		DPRINT("%c\n", event);
+
+		if ( cache_stats(movieCatalog) ) {
+			DPRINT("%c succeeded\n", event);
+		} else {
+			fprintf(stderr, "%c failed\n", event);
 		}
-		/* Event W : W <userID ><category><movieID><score> - Watch movie */
-		case 'W':
-		{
-			int userID, movieID,category,score;
-
-			sscanf(buff, "%c %d %d %d %d", &event,&category, &userID, &movieID, &score);
-			DPRINT("%c %d %d %d %d\n", event,category, userID, movieID, score);
-
-			if ( watch_movie(userID,category, movieID, score) ) {
-				DPRINT("%c %d %d %d %d succeeded\n", event,category, userID, movieID, score);
-			} else {
-				fprintf(stderr, "%c %d %d %d failed\n", event, userID, movieID, score);
-			}
 
-			break;
+		break;
+	}
+	/* Event Y : Y <category> <fromYear> <toYear> - Movies by release year */
+	case 'Y':
+	{
+		int category, fromYear, toYear;
+		sscanf(buff, "%c %d %d %d", &event, &category, &fromYear, &toYear);
+		DPRINT("%c %d %d %d\n", event, category, fromYear, toYear);
+
+		if ( year_movies(movieCatalog, category, fromYear, toYear) ) {
+			DPRINT("%c %d %d %d succeeded\n", event, category, fromYear, toYear);
+		} else {
+			fprintf(stderr, "%c %d %d %d failed\n", event, category, fromYear, toYear);
 		}
-		/* Event –	F  <userID ><category1><category2><score> Filter movies */
-		case 'F':
-		{
-			int userID, score;
-			sscanf(buff, "%c %d %d\n", &event, &userID,&score);
-			DPRINT("%c %d %d\n", event, userID,score);
-
-			if (filter_movies(userID,score) ) {
-				DPRINT("%c %d %d succeeded\n", event, userID,score);
-			} else {
-				fprintf(stderr, "%c %d %d failed\n", event, userID,score);
-			}
 
-			break;
+		break;
+	}
+	/* Event K : K <category> <fromYear> <toYear> [width] - Movie counts by release year */
+	case 'K':
+	{
+		int category, fromYear, toYear, width = 0;
+		sscanf(buff, "%c %d %d %d %d", &event, &category, &fromYear, &toYear, &width);
+		DPRINT("%c %d %d %d %d\n", event, category, fromYear, toYear, width);
+
+		if ( count_movies_by_year(movieCatalog, category, fromYear, toYear, width) ) {
+			DPRINT("%c %d %d %d %d succeeded\n", event, category, fromYear, toYear, width);
+		} else {
+			fprintf(stderr, "%c %d %d %d %d failed\n", event, category, fromYear, toYear, width);
 		}
-		/* Event Q : Q <userID> - User statistics */
-		case 'Q':
-		{
-			int userID;
-			sscanf(buff, "%c %d\n", &event, &userID);
-			DPRINT("%c %d\n", event, userID);
-
-			if ( user_stats(userID) ) {
-				DPRINT("%c %d succeeded\n", event, userID);
-			} else {
-				fprintf(stderr, "%c %d failed\n", event, userID);
-			}
 
-			break;
+		break;
+	}
+	/* Event N : N <category> <lo> <hi> [limit] - Range of movies */
+	case 'N':
+	{
+		int category, lo, hi, limit = 0;
+		sscanf(buff, "%c %d %d %d %d", &event, &category, &lo, &hi, &limit);
+		DPRINT("%c %d %d %d %d\n", event, category, lo, hi, limit);
+
+		if ( range_movies(movieCatalog, category, lo, hi, limit) ) {
+			DPRINT("%c %d %d %d %d succeeded\n", event, category, lo, hi, limit);
+		} else {
+			fprintf(stderr, "%c %d %d %d %d failed\n", event, category, lo, hi, limit);
 		}
-		/* Event I : I <movieID> <category> - Search movie */
-		case 'I':
-		{
-			int movieID,category;
-			sscanf(buff, "%c %d %d\n", &event, &movieID, &category);
-			DPRINT("%c %d %d\n", event, movieID, category);
-
-			if ( search_movie(movieID, category) ) {
-				DPRINT("%c %d %d succeeded\n", event, movieID, category);
-			} else {
-				fprintf(stderr, "%c %d %d failed\n", event, movieID, category);
-			}
 
-			break;
+		break;
+	}
+	/* Event M : M  - Print movies */
+	case 'M':
+	{
+		sscanf(buff, "%c", &event);
+		DPRINT("%c\n", event);
+
+		if ( print_movies(movieCatalog) ) {
+			DPRINT("%c succeeded\n", event);
+		} else {
+			fprintf(stderr, "%c failed\n", event);
+		}
+
+		break;
+	}
+	/* Event P : P  - Print users */
+	case 'P':
+	{
+		sscanf(buff, "%c", &event);
+		DPRINT("%c\n", event);
+
+		if ( print_users(movieCatalog) ) {
+			DPRINT("%c succeeded\n", event);
+		} else {
+			fprintf(stderr, "%c failed\n", event);
 		}
-		/* Event M : M  - Print movies */
-		case 'M':
-		{
-			sscanf(buff, "%c", &event);
-			DPRINT("%c\n", event);
-
-			if ( print_movies() ) {
-				DPRINT("%c succeeded\n", event);
-			} else {
-				fprintf(stderr, "%c failed\n", event);
-			}
 
+		break;
+	}
+	/* Empty line */
+	case '\n':
+		break;
+
+	/* Ignore everything else */
+	default:
+		DPRINT("Ignoring buff: %s \n", buff);
+		break;
+	}
+}
+
+static volatile sig_atomic_t serverStop = 0;	/* Set by SIGINT and SIGTERM in server mode */
+
+/**
+ * @brief SIGINT and SIGTERM handler of the server mode
+ * @return returns void
+*/
+static void stopServing(int signo)
+{
+	(void)signo;
+	serverStop = 1;
+}
+
+/**
+ * @brief Handles an event line sent by a client of the server, W included, printing its output to stdout
+ * @return returns void
+*/
+static void serveEvent(char *line, void *checkpointPath)
+{
+	/* Each line is answered before the next is handled, so W runs are not batched here */
+	if ( line[0] == 'W' ) {
+		memcpy(watchLines[0], line, strlen(line) + 1);
+		handleWatches(watchLines, 1);
+		return;
+	}
+	handleEvent(line, (const char*)checkpointPath);
+}
+
+int main(int argc, char** argv)
+{
+	FILE *fin = NULL;
+	char buff[BUFFER_SIZE];
+	const char *loadPath = NULL, *savePath = NULL, *logPath = NULL, *checkpointPath = NULL, *ratingsPath = NULL;
+	long window = WAL_DEFAULT_WINDOW_MS;
+	int arg = 1;
+	int watchCount = 0;	/* W events queued in watchLines */
+	const char *socketPath = NULL;
+
+	/* Check command buff arguments: -l loads a snapshot before the events, -s saves one after them,
+	 * -j logs the events and replays the log on startup, -w sets the durability window of the log,
+	 * -c writes a checkpoint in the background after every D, -r applies the W events of a file in bulk before the events,
+	 * -u serves the events of local clients on a Unix domain socket after the input file, which is then optional */
+	while ( arg + 1 < argc && argv[arg][0] == '-' ) {
+		if ( strcmp(argv[arg], "-l") == 0 )
+			loadPath = argv[arg + 1];
+		else if ( strcmp(argv[arg], "-s") == 0 )
+			savePath = argv[arg + 1];
+		else if ( strcmp(argv[arg], "-j") == 0 )
+			logPath = argv[arg + 1];
+		else if ( strcmp(argv[arg], "-w") == 0 )
+			window = atol(argv[arg + 1]);
+		else if ( strcmp(argv[arg], "-c") == 0 )
+			checkpointPath = argv[arg + 1];
+		else if ( strcmp(argv[arg], "-r") == 0 )
+			ratingsPath = argv[arg + 1];
+		else if ( strcmp(argv[arg], "-u") == 0 )
+			socketPath = argv[arg + 1];
+		else
 			break;
+		arg += 2;
+	}
+	if ( (arg != argc - 1 && !(socketPath != NULL && arg == argc)) || window < 0 ) {
+		fprintf(stderr, "Usage: %s [-l <snapshot>] [-s <snapshot>] [-j <log> [-w <window_ms>]] [-c <checkpoint>] [-r <ratings>] <input_file> \n", argv[0]);
+		fprintf(stderr, "       %s [-l <snapshot>] [-s <snapshot>] [-j <log> [-w <window_ms>]] [-c <checkpoint>] [-r <ratings>] -u <socket> [input_file] \n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/* Open input file */
+	if ( arg < argc && ( fin = fopen(argv[arg], "r") ) == NULL ) {
+		fprintf(stderr, "\n Could not open file: %s\n", argv[arg]);
+		perror("Opening test file\n");
+		return EXIT_FAILURE;
+	}
+
+	/* Create the catalog the events go to, restored from the snapshot if there is one */
+	if ( ( movieCatalog = catalogCreate(loadPath) ) == NULL )
+		return EXIT_FAILURE;
+
+	/* Replay the events logged after the snapshot, then keep logging after them */
+	if ( logPath != NULL ) {
+		uint64_t from = catalogSnapshotLsn(movieCatalog);
+		if ( !walOpen(&catalogWal, logPath, window) ) {
+			fprintf(stderr, "\n Could not open log: %s\n", logPath);
+			return EXIT_FAILURE;
+		}
+		if ( from < catalogWal.base ) {
+			fprintf(stderr, "\n Log %s starts at event %llu, after the snapshot\n", logPath, (unsigned long long)catalogWal.base);
+			return EXIT_FAILURE;
 		}
-		/* Event P : P  - Print users */
-		case 'P':
-		{
-			sscanf(buff, "%c", &event);
-			DPRINT("%c\n", event);
-
-			if ( print_users() ) {
-				DPRINT("%c succeeded\n", event);
-			} else {
-				fprintf(stderr, "%c failed\n", event);
+		if ( catalogWal.lsn < from ) {
+			/* The snapshot is newer than everything logged, so the log has nothing to add */
+			walReset(&catalogWal, from);
+		}
+		DPRINT("Replayed %llu logged events\n", (unsigned long long)walReplay(&catalogWal, from));
+	}
+
+	/* Backfill the ratings on top of the restored state, logged like the W events they stand for */
+	if ( ratingsPath != NULL && !handleRatings(ratingsPath) ) {
+		fprintf(stderr, "\n Could not apply ratings: %s\n", ratingsPath);
+		return EXIT_FAILURE;
+	}
+
+	/* Read input file buff-by-buff and handle the events */
+	while ( fin != NULL && fgets(buff, BUFFER_SIZE, fin) ) {
+
+		/* Event W : W <userID> <category> <movieID> <score> - Watch movie. Runs of them are handled together,
+		 * so that their lookups overlap (see watch_movies) */
+		if ( buff[0] == 'W' ) {
+			memcpy(watchLines[watchCount++], buff, BUFFER_SIZE);
+			if ( watchCount == WATCH_BATCH ) {
+				handleWatches(watchLines, watchCount);
+				watchCount = 0;
 			}
+			continue;
+		}
+		if ( watchCount > 0 ) {
+			handleWatches(watchLines, watchCount);
+			watchCount = 0;
+		}
 
-			break;
+		handleEvent(buff, checkpointPath);
+	}
+	if ( watchCount > 0 )
+		handleWatches(watchLines, watchCount);
+
+	/* Serve the clients until SIGINT or SIGTERM, then finish like the input file ended */
+	if ( socketPath != NULL ) {
+		server_t server;
+		struct sigaction action;
+		if ( !serverOpen(&server, socketPath, serveEvent, (void*)checkpointPath) ) {
+			fprintf(stderr, "\n Could not serve socket: %s\n", socketPath);
+			return EXIT_FAILURE;
 		}
-		/* Empty line */
-		case '\n':
-			break;
+		memset(&action, 0, sizeof(action));
+		action.sa_handler = stopServing;
+		sigemptyset(&action.sa_mask);
+		sigaction(SIGINT, &action, NULL);
+		sigaction(SIGTERM, &action, NULL);
+		DPRINT("Serving %s\n", socketPath);
+		if ( !serverRun(&server, &serverStop) )
+			perror("Serving socket");
+		DPRINT("Served %llu events over %llu connections\n", server.requests, server.connections);
+		serverClose(&server);
+	}
 
-		/* Ignore everything else */
-		default:
-			DPRINT("Ignoring buff: %s \n", buff);
-			break;
+#ifdef CATALOG_VERSIONS
+	if ( watchBatch > 0 )
+		catalogPublish(movieCatalog);
+#endif
+
+	checkpointPoll(&catalogCheckpoint, 1);
+
+	/* The snapshot holds every logged event, so the log starts over after it */
+	if ( savePath != NULL ) {
+		uint64_t lsn = currentLsn();
+		if ( !snapshotWrite(savePath, lsn) ) {
+			fprintf(stderr, "\n Could not save snapshot: %s\n", savePath);
+			return EXIT_FAILURE;
 		}
+		if ( !walReset(&catalogWal, lsn) )
+			fprintf(stderr, "\n Could not reset log: %s\n", logPath);
 	}
+	walClose(&catalogWal);
+
+	catalogDestroy(movieCatalog);
 
 	return (EXIT_SUCCESS);
 }